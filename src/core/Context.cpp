@@ -26,15 +26,21 @@
 #include "Kernel.h"
 #include "KernelInvocation.h"
 #include "Memory.h"
+#include "PluginPipeline.h"
 #include "Program.h"
 #include "WorkGroup.h"
 #include "WorkItem.h"
 
+#include "plugins/BranchDivergence.h"
+#include "plugins/CacheSimulator.h"
 #include "plugins/InstructionCounter.h"
 #include "plugins/InteractiveDebugger.h"
 #include "plugins/Logger.h"
 #include "plugins/MemCheck.h"
+#include "plugins/MemoryTrace.h"
+#include "plugins/PerformanceModel.h"
 #include "plugins/RaceDetector.h"
+#include "plugins/Roofline.h"
 #include "plugins/Uninitialized.h"
 
 using namespace oclgrind;
@@ -47,18 +53,30 @@ Context::Context()
   m_globalMemory =
     new Memory(AddrSpaceGlobal, sizeof(size_t) == 8 ? 16 : 8, this);
   m_kernelInvocation = NULL;
+  m_syncPlugins.resize(PluginEvent::WORK_GROUP_COMPLETE + 1);
+  m_pipeline = NULL;
+  m_recordedEvents = 0;
 
   loadPlugins();
 }
 
 Context::~Context()
 {
+  delete m_pipeline;
   delete m_llvmContext;
   delete m_globalMemory;
 
   unloadPlugins();
 }
 
+bool Context::isRunningKernel() const
+{
+  // Only accesses made by the thread running a work-item or work-group
+  // belong to the kernel
+  return m_kernelInvocation && (m_kernelInvocation->getCurrentWorkItem() ||
+                                m_kernelInvocation->getCurrentWorkGroup());
+}
+
 bool Context::isThreadSafe() const
 {
   for (const PluginEntry& p : m_plugins)
@@ -74,6 +92,11 @@ Memory* Context::getGlobalMemory() const
   return m_globalMemory;
 }
 
+std::mutex& Context::getKernelMutex() const
+{
+  return m_kernelMutex;
+}
+
 llvm::LLVMContext* Context::getLLVMContext() const
 {
   return m_llvmContext;
@@ -85,12 +108,27 @@ void Context::loadPlugins()
   m_plugins.push_back(make_pair(new Logger(this), true));
   m_plugins.push_back(make_pair(new MemCheck(this), true));
 
+  if (checkEnv("OCLGRIND_DIVERGENCE"))
+    m_plugins.push_back(make_pair(new BranchDivergence(this), true));
+
   if (checkEnv("OCLGRIND_INST_COUNTS"))
     m_plugins.push_back(make_pair(new InstructionCounter(this), true));
 
+  if (checkEnv("OCLGRIND_CACHE_SIM"))
+    m_plugins.push_back(make_pair(new CacheSimulator(this), true));
+
   if (checkEnv("OCLGRIND_DATA_RACES"))
     m_plugins.push_back(make_pair(new RaceDetector(this), true));
 
+  if (getenv("OCLGRIND_MEM_TRACE"))
+    m_plugins.push_back(make_pair(new MemoryTrace(this), true));
+
+  if (checkEnv("OCLGRIND_PERF_MODEL"))
+    m_plugins.push_back(make_pair(new PerformanceModel(this), true));
+
+  if (checkEnv("OCLGRIND_ROOFLINE"))
+    m_plugins.push_back(make_pair(new Roofline(this), true));
+
   if (checkEnv("OCLGRIND_UNINITIALIZED"))
     m_plugins.push_back(make_pair(new Uninitialized(this), true));
 
@@ -209,11 +247,65 @@ void Context::logError(const char* error) const
     }                                                                          \
   }
 
+// Notify plugins that handle a kernel event on the worker threads
+#define NOTIFY_SYNC(type, function, ...)                                       \
+  {                                                                            \
+    const PluginList& plugins = m_syncPlugins[PluginEvent::type];              \
+    PluginList::const_iterator pluginItr;                                      \
+    for (pluginItr = plugins.begin(); pluginItr != plugins.end(); pluginItr++) \
+    {                                                                          \
+      pluginItr->first->function(__VA_ARGS__);                                 \
+    }                                                                          \
+  }
+
+// Check whether a decoupled plugin needs an event type
+#define RECORDED(type) (m_recordedEvents & (1 << PluginEvent::type))
+
+// Create events for decoupled plugins
+static PluginEvent workItemEvent(PluginEvent::Type type,
+                                 const WorkItem* workItem,
+                                 const Memory* memory, size_t address,
+                                 size_t size)
+{
+  PluginEvent event = {type,
+                       workItem->getCurrentInstruction(),
+                       workItem->getGlobalIndex(),
+                       workItem->getWorkGroup()->getGroupIndex(),
+                       memory ? memory->getAddressSpace() : 0,
+                       address,
+                       size};
+  return event;
+}
+
+static PluginEvent workGroupEvent(PluginEvent::Type type,
+                                  const WorkGroup* workGroup,
+                                  const Memory* memory, size_t address,
+                                  size_t size)
+{
+  PluginEvent event = {type,
+                       NULL,
+                       (size_t)-1,
+                       workGroup->getGroupIndex(),
+                       memory ? memory->getAddressSpace() : 0,
+                       address,
+                       size};
+  return event;
+}
+
 void Context::notifyInstructionExecuted(const WorkItem* workItem,
                                         const llvm::Instruction* instruction,
                                         const TypedValue& result) const
 {
-  NOTIFY(instructionExecuted, workItem, instruction, result);
+  NOTIFY_SYNC(INSTRUCTION_EXECUTED, instructionExecuted, workItem, instruction,
+              result);
+
+  if (RECORDED(INSTRUCTION_EXECUTED))
+  {
+    PluginEvent event = workItemEvent(PluginEvent::INSTRUCTION_EXECUTED,
+                                      workItem, NULL, 0, 0);
+    event.instruction = instruction;
+    m_pipeline->record(m_kernelInvocation->getWorkerID(), event);
+  }
 }
 
 void Context::notifyKernelBegin(const KernelInvocation* kernelInvocation) const
@@ -221,11 +313,53 @@ void Context::notifyKernelBegin(const KernelInvocation* kernelInvocation) const
   assert(m_kernelInvocation == NULL);
   m_kernelInvocation = kernelInvocation;
 
+  // Separate decoupled plugins from those notified on the worker threads
+  // Synchronous plugins are only notified of the events they asked for
+  list<Plugin*> decoupled;
+  m_syncPlugins.assign(PluginEvent::WORK_GROUP_COMPLETE + 1, PluginList());
+  m_recordedEvents = 0;
+  for (const PluginEntry& p : m_plugins)
+  {
+    unsigned events = p.first->getRecordedEvents();
+    if (p.first->isDecoupled())
+    {
+      decoupled.push_back(p.first);
+      m_recordedEvents |= events;
+      continue;
+    }
+    for (unsigned type = 0; type < m_syncPlugins.size(); type++)
+    {
+      if (events & (1 << type))
+        m_syncPlugins[type].push_back(p);
+    }
+  }
+
+  // Reuse the pipeline (and its analysis threads) from the previous kernel
+  // unless the decoupled plugins or number of workers have changed
+  if (m_pipeline && (m_pipeline->getPlugins() != decoupled ||
+                     m_pipeline->getNumWorkers() <
+                       kernelInvocation->getNumWorkers()))
+  {
+    delete m_pipeline;
+    m_pipeline = NULL;
+  }
+  if (!m_pipeline && m_recordedEvents)
+  {
+    m_pipeline =
+      new PluginPipeline(decoupled, kernelInvocation->getNumWorkers(),
+                         getEnvInt("OCLGRIND_ANALYSIS_THREADS", 1));
+  }
+
   NOTIFY(kernelBegin, kernelInvocation);
 }
 
 void Context::notifyKernelEnd(const KernelInvocation* kernelInvocation) const
 {
+  // Wait for decoupled plugins to process every event
+  if (m_pipeline)
+    m_pipeline->wait();
+  m_recordedEvents = 0;
+
   NOTIFY(kernelEnd, kernelInvocation);
 
   assert(m_kernelInvocation == kernelInvocation);
@@ -244,8 +378,16 @@ void Context::notifyMemoryAtomicLoad(const Memory* memory, AtomicOp op,
 {
   if (m_kernelInvocation && m_kernelInvocation->getCurrentWorkItem())
   {
-    NOTIFY(memoryAtomicLoad, memory, m_kernelInvocation->getCurrentWorkItem(),
-           op, address, size);
+    const WorkItem* workItem = m_kernelInvocation->getCurrentWorkItem();
+    NOTIFY_SYNC(MEMORY_ATOMIC_LOAD, memoryAtomicLoad, memory, workItem, op,
+                address, size);
+
+    if (RECORDED(MEMORY_ATOMIC_LOAD))
+    {
+      PluginEvent event = workItemEvent(PluginEvent::MEMORY_ATOMIC_LOAD,
+                                        workItem, memory, address, size);
+      m_pipeline->record(m_kernelInvocation->getWorkerID(), event);
+    }
   }
 }
 
@@ -254,8 +396,16 @@ void Context::notifyMemoryAtomicStore(const Memory* memory, AtomicOp op,
 {
   if (m_kernelInvocation && m_kernelInvocation->getCurrentWorkItem())
   {
-    NOTIFY(memoryAtomicStore, memory, m_kernelInvocation->getCurrentWorkItem(),
-           op, address, size);
+    const WorkItem* workItem = m_kernelInvocation->getCurrentWorkItem();
+    NOTIFY_SYNC(MEMORY_ATOMIC_STORE, memoryAtomicStore, memory, workItem, op,
+                address, size);
+
+    if (RECORDED(MEMORY_ATOMIC_STORE))
+    {
+      PluginEvent event = workItemEvent(PluginEvent::MEMORY_ATOMIC_STORE,
+                                        workItem, memory, address, size);
+      m_pipeline->record(m_kernelInvocation->getWorkerID(), event);
+    }
   }
 }
 
@@ -270,15 +420,28 @@ void Context::notifyMemoryLoad(const Memory* memory, size_t address,
 {
   if (m_kernelInvocation)
   {
-    if (m_kernelInvocation->getCurrentWorkItem())
+    if (const WorkItem* workItem = m_kernelInvocation->getCurrentWorkItem())
     {
-      NOTIFY(memoryLoad, memory, m_kernelInvocation->getCurrentWorkItem(),
-             address, size);
+      NOTIFY_SYNC(MEMORY_LOAD, memoryLoad, memory, workItem, address, size);
+
+      if (RECORDED(MEMORY_LOAD))
+      {
+        m_pipeline->record(m_kernelInvocation->getWorkerID(),
+                           workItemEvent(PluginEvent::MEMORY_LOAD, workItem,
+                                         memory, address, size));
+      }
     }
-    else if (m_kernelInvocation->getCurrentWorkGroup())
+    else if (const WorkGroup* workGroup =
+               m_kernelInvocation->getCurrentWorkGroup())
     {
-      NOTIFY(memoryLoad, memory, m_kernelInvocation->getCurrentWorkGroup(),
-             address, size);
+      NOTIFY_SYNC(MEMORY_LOAD, memoryLoad, memory, workGroup, address, size);
+
+      if (RECORDED(MEMORY_LOAD))
+      {
+        m_pipeline->record(m_kernelInvocation->getWorkerID(),
+                           workGroupEvent(PluginEvent::MEMORY_LOAD, workGroup,
+                                          memory, address, size));
+      }
     }
   }
   else
@@ -299,15 +462,30 @@ void Context::notifyMemoryStore(const Memory* memory, size_t address,
 {
   if (m_kernelInvocation)
   {
-    if (m_kernelInvocation->getCurrentWorkItem())
+    if (const WorkItem* workItem = m_kernelInvocation->getCurrentWorkItem())
     {
-      NOTIFY(memoryStore, memory, m_kernelInvocation->getCurrentWorkItem(),
-             address, size, storeData);
+      NOTIFY_SYNC(MEMORY_STORE, memoryStore, memory, workItem, address, size,
+                  storeData);
+
+      if (RECORDED(MEMORY_STORE))
+      {
+        m_pipeline->record(m_kernelInvocation->getWorkerID(),
+                           workItemEvent(PluginEvent::MEMORY_STORE, workItem,
+                                         memory, address, size));
+      }
     }
-    else if (m_kernelInvocation->getCurrentWorkGroup())
+    else if (const WorkGroup* workGroup =
+               m_kernelInvocation->getCurrentWorkGroup())
     {
-      NOTIFY(memoryStore, memory, m_kernelInvocation->getCurrentWorkGroup(),
-             address, size, storeData);
+      NOTIFY_SYNC(MEMORY_STORE, memoryStore, memory, workGroup, address, size,
+                  storeData);
+
+      if (RECORDED(MEMORY_STORE))
+      {
+        m_pipeline->record(m_kernelInvocation->getWorkerID(),
+                           workGroupEvent(PluginEvent::MEMORY_STORE, workGroup,
+                                          memory, address, size));
+      }
     }
   }
   else
@@ -327,6 +505,13 @@ void Context::notifyMemoryUnmap(const Memory* memory, size_t address,
   NOTIFY(memoryUnmap, memory, address, ptr);
 }
 
+void Context::notifySubGroupBarrier(const WorkGroup* workGroup,
+                                    const vector<WorkItem*>& workItems,
+                                    uint32_t flags) const
+{
+  NOTIFY(subGroupBarrier, workGroup, workItems, flags);
+}
+
 void Context::notifyWorkGroupBarrier(const WorkGroup* workGroup,
                                      uint32_t flags) const
 {
@@ -340,7 +525,17 @@ void Context::notifyWorkGroupBegin(const WorkGroup* workGroup) const
 
 void Context::notifyWorkGroupComplete(const WorkGroup* workGroup) const
 {
-  NOTIFY(workGroupComplete, workGroup);
+  NOTIFY_SYNC(WORK_GROUP_COMPLETE, workGroupComplete, workGroup);
+
+  // Deliver completion to decoupled plugins after the work-group's events
+  if (RECORDED(WORK_GROUP_COMPLETE))
+  {
+    m_pipeline->record(m_kernelInvocation->getWorkerID(),
+                       workGroupEvent(PluginEvent::WORK_GROUP_COMPLETE,
+                                      workGroup, NULL, 0, 0));
+  }
+  if (m_pipeline)
+    m_pipeline->flush();
 }
 
 void Context::notifyWorkItemBegin(const WorkItem* workItem) const
@@ -354,6 +549,8 @@ void Context::notifyWorkItemComplete(const WorkItem* workItem) const
 }
 
 #undef NOTIFY
+#undef NOTIFY_SYNC
+#undef RECORDED
 
 Context::Message::Message(MessageType type, const Context* context)
 {
@@ -8,6 +8,8 @@
 
 #include "common.h"
 
+#include <mutex>
+
 namespace llvm
 {
 class LLVMContext;
@@ -18,6 +20,7 @@ namespace oclgrind
 class KernelInvocation;
 class Memory;
 class Plugin;
+class PluginPipeline;
 class WorkGroup;
 class WorkItem;
 
@@ -31,7 +34,9 @@ public:
   virtual ~Context();
 
   Memory* getGlobalMemory() const;
+  std::mutex& getKernelMutex() const;
   llvm::LLVMContext* getLLVMContext() const;
+  bool isRunningKernel() const;
   bool isThreadSafe() const;
   void logError(const char* error) const;
 
@@ -57,6 +62,9 @@ public:
   void notifyMessage(MessageType type, const char* message) const;
   void notifyMemoryUnmap(const Memory* memory, size_t address,
                          const void* ptr) const;
+  void notifySubGroupBarrier(const WorkGroup* workGroup,
+                             const std::vector<WorkItem*>& workItems,
+                             uint32_t flags) const;
   void notifyWorkGroupBarrier(const WorkGroup* workGroup, uint32_t flags) const;
   void notifyWorkGroupBegin(const WorkGroup* workGroup) const;
   void notifyWorkGroupComplete(const WorkGroup* workGroup) const;
@@ -69,6 +77,7 @@ public:
 
 private:
   mutable const KernelInvocation* m_kernelInvocation;
+  mutable std::mutex m_kernelMutex;
   Memory* m_globalMemory;
 
   PluginList m_plugins;
@@ -76,6 +85,12 @@ private:
   void loadPlugins();
   void unloadPlugins();
 
+  // Plugins notified of each type of kernel event on the worker threads,
+  // and the pipeline that delivers recorded events to decoupled plugins
+  mutable std::vector<PluginList> m_syncPlugins;
+  mutable PluginPipeline* m_pipeline;
+  mutable unsigned m_recordedEvents;
+
   llvm::LLVMContext* m_llvmContext;
 
 public:
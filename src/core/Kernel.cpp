@@ -24,8 +24,11 @@ using namespace std;
 
 Kernel::Kernel(const Program* program, const llvm::Function* function,
                const llvm::Module* module)
-    : m_program(program), m_function(function), m_name(function->getName())
+    : m_program(program), m_function(function), m_name(function->getName()),
+      m_values(new ValueSet)
 {
+  TypedValueMap& values = m_values->values;
+
   // Set-up global variables
   llvm::Module::const_global_iterator itr;
   for (itr = module->global_begin(); itr != module->global_end(); itr++)
@@ -40,13 +43,13 @@ Kernel::Kernel(const Program* program, const llvm::Function* function,
       unsigned size = getTypeSize(init->getType());
       TypedValue value = {size, 1, new uint8_t[size]};
       getConstantData(value.data, init);
-      m_values[&*itr] = value;
+      values[&*itr] = value;
 
       break;
     }
     case AddrSpaceGlobal:
     case AddrSpaceConstant:
-      m_values[&*itr] = program->getProgramScopeVar(&*itr).clone();
+      values[&*itr] = program->getProgramScopeVar(&*itr).clone();
       break;
     case AddrSpaceLocal:
     {
@@ -57,7 +60,7 @@ Kernel::Kernel(const Program* program, const llvm::Function* function,
       // Get size of allocation
       TypedValue allocSize = {getTypeSize(itr->getInitializer()->getType()), 1,
                               NULL};
-      m_values[&*itr] = allocSize;
+      values[&*itr] = allocSize;
 
       break;
     }
@@ -111,16 +114,24 @@ Kernel::Kernel(const Kernel& kernel) : m_program(kernel.m_program)
   m_metadata = kernel.m_metadata;
   m_requiresUniformWorkGroups = kernel.m_requiresUniformWorkGroups;
 
-  for (auto itr = kernel.m_values.begin(); itr != kernel.m_values.end(); itr++)
+  // Share argument values until one of the kernels is modified
+  m_values = kernel.m_values;
+}
+
+Kernel::~Kernel() {}
+
+Kernel::ValueSet::ValueSet(const ValueSet& set)
+{
+  for (auto itr = set.values.begin(); itr != set.values.end(); itr++)
   {
-    m_values[itr->first] = itr->second.clone();
+    values[itr->first] = itr->second.clone();
   }
 }
 
-Kernel::~Kernel()
+Kernel::ValueSet::~ValueSet()
 {
   TypedValueMap::iterator itr;
-  for (itr = m_values.begin(); itr != m_values.end(); itr++)
+  for (itr = values.begin(); itr != values.end(); itr++)
   {
     delete[] itr->second.data;
   }
@@ -131,7 +142,7 @@ bool Kernel::allArgumentsSet() const
   llvm::Function::const_arg_iterator itr;
   for (itr = m_function->arg_begin(); itr != m_function->arg_end(); itr++)
   {
-    if (!m_values.count(&*itr))
+    if (!m_values->values.count(&*itr))
     {
       return false;
     }
@@ -299,6 +310,10 @@ unsigned int Kernel::getArgumentTypeQualifier(unsigned int index) const
     {
       result |= CL_KERNEL_ARG_TYPE_VOLATILE;
     }
+    else if (tok == "pipe")
+    {
+      result |= CL_KERNEL_ARG_TYPE_PIPE;
+    }
   }
 
   return result;
@@ -375,7 +390,8 @@ const llvm::Function* Kernel::getFunction() const
 size_t Kernel::getLocalMemorySize() const
 {
   size_t sz = 0;
-  for (auto value = m_values.begin(); value != m_values.end(); value++)
+  for (auto value = m_values->values.begin(); value != m_values->values.end();
+       value++)
   {
     const llvm::Type* type = value->first->getType();
     if (type->isPointerTy() && type->getPointerAddressSpace() == AddrSpaceLocal)
@@ -386,6 +402,16 @@ size_t Kernel::getLocalMemorySize() const
   return sz;
 }
 
+TypedValueMap& Kernel::getMutableValues()
+{
+  // Take a private copy of the values if they are shared with a snapshot
+  if (m_values.use_count() > 1)
+  {
+    m_values = std::make_shared<ValueSet>(*m_values);
+  }
+  return m_values->values;
+}
+
 const std::string& Kernel::getName() const
 {
   return m_name;
@@ -422,11 +448,12 @@ void Kernel::setArgument(unsigned int index, TypedValue value)
   assert(index < m_function->arg_size());
 
   const llvm::Value* argument = getArgument(index);
+  TypedValueMap& values = getMutableValues();
 
   // Deallocate existing argument
-  if (m_values.count(argument))
+  if (values.count(argument))
   {
-    delete[] m_values[argument].data;
+    delete[] values[argument].data;
   }
 
   if (getArgumentTypeName(index).str() == "sampler_t")
@@ -442,20 +469,26 @@ void Kernel::setArgument(unsigned int index, TypedValue value)
     sampler.data = new unsigned char[sizeof(size_t)];
     sampler.setPointer((size_t)samplerValue);
 
-    m_values[argument] = sampler;
+    values[argument] = sampler;
   }
   else
   {
-    m_values[argument] = value.clone();
+    values[argument] = value.clone();
   }
 }
 
 TypedValueMap::const_iterator Kernel::values_begin() const
 {
-  return m_values.begin();
+  return m_values->values.begin();
 }
 
 TypedValueMap::const_iterator Kernel::values_end() const
 {
-  return m_values.end();
+  return m_values->values.end();
+}
+
+TypedValueMap::const_iterator Kernel::values_find(
+  const llvm::Value* value) const
+{
+  return m_values->values.find(value);
 }
@@ -36,6 +36,7 @@ public:
 
   TypedValueMap::const_iterator values_begin() const;
   TypedValueMap::const_iterator values_end() const;
+  TypedValueMap::const_iterator values_find(const llvm::Value* value) const;
   bool allArgumentsSet() const;
   unsigned int getArgumentAccessQualifier(unsigned int index) const;
   unsigned int getArgumentAddressQualifier(unsigned int index) const;
@@ -59,11 +60,21 @@ private:
   const llvm::MDNode* m_metadata;
   std::string m_name;
 
-  TypedValueMap m_values;
+  // Global variables, arguments and local memory sizes, shared between copies
+  // of the kernel until one of them changes an argument (copy-on-write)
+  struct ValueSet
+  {
+    TypedValueMap values;
+    ValueSet() {}
+    ValueSet(const ValueSet& set);
+    ~ValueSet();
+  };
+  std::shared_ptr<ValueSet> m_values;
 
   bool m_requiresUniformWorkGroups;
 
   const llvm::Argument* getArgument(unsigned int index) const;
+  TypedValueMap& getMutableValues();
   const llvm::Metadata* getArgumentMetadata(std::string name,
                                             unsigned int index) const;
 };
@@ -7,11 +7,22 @@
 // source code.
 
 #include "common.h"
+#include "config.h"
 
+#include <algorithm>
 #include <atomic>
+#include <exception>
+#include <mutex>
 #include <sstream>
 #include <thread>
 
+#if HAVE_UCONTEXT
+#include <ucontext.h>
+#endif
+
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
 #include "Context.h"
 #include "Kernel.h"
 #include "KernelInvocation.h"
@@ -23,14 +34,116 @@
 using namespace oclgrind;
 using namespace std;
 
+// Largest magnitude of a value range used by the launch-time access
+// analysis, which keeps range arithmetic well clear of overflow
+#define RANGE_LIMIT ((int64_t)1 << 48)
+
+#if HAVE_UCONTEXT
+// Size of the stack used by each work-item fiber
+#define FIBER_STACK_SIZE (256 * 1024)
+
+// User-space context used to run a single work-item
+struct Fiber
+{
+  ucontext_t context;
+  unsigned char* stack;
+  WorkItem* workItem;
+};
+#endif
+
 struct
 {
   int id;
   WorkGroup* workGroup;
   WorkItem* workItem;
+#if HAVE_UCONTEXT
+  ucontext_t scheduler;
+  Fiber* fiber;
+  vector<Fiber*>* fiberPool;
+  exception_ptr* fiberError;
+#endif
 } static THREAD_LOCAL workerState;
 
-static atomic<unsigned> nextGroupIndex;
+// Check if a value is a call to a work-item function with a constant
+// dimension below workDim, returning its unmangled name and dimension
+static bool getWorkItemCall(const llvm::Value* value, unsigned workDim,
+                            string& name, unsigned& dim)
+{
+  auto call = llvm::dyn_cast<llvm::CallInst>(value);
+  if (!call || !call->getCalledFunction() || call->arg_size() != 1)
+    return false;
+  auto dimArg = llvm::dyn_cast<llvm::ConstantInt>(call->getArgOperand(0));
+  if (!dimArg || dimArg->getZExtValue() >= workDim)
+    return false;
+  dim = dimArg->getZExtValue();
+
+  name = getUnmangledName(call->getCalledFunction()->getName().str());
+  return true;
+}
+
+// Find every load and store through a pointer, returning false if the
+// pointer is used in any other way (e.g. passed to a function or stored)
+static bool findAccesses(const llvm::Value* pointer,
+                         vector<const llvm::Instruction*>& accesses)
+{
+  for (auto U = pointer->user_begin(); U != pointer->user_end(); U++)
+  {
+    if (auto load = llvm::dyn_cast<llvm::LoadInst>(*U))
+    {
+      accesses.push_back(load);
+    }
+    else if (auto store = llvm::dyn_cast<llvm::StoreInst>(*U))
+    {
+      if (store->getValueOperand() == pointer)
+        return false;
+      accesses.push_back(store);
+    }
+    else if (llvm::isa<llvm::GetElementPtrInst>(*U) ||
+             llvm::isa<llvm::BitCastInst>(*U) ||
+             llvm::isa<llvm::AddrSpaceCastInst>(*U))
+    {
+      if (!findAccesses(*U, accesses))
+        return false;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Get the pointer operand and accessed type of a load or store
+static const llvm::Value* getAccessPointer(const llvm::Instruction* access,
+                                           const llvm::Type*& type)
+{
+  if (auto load = llvm::dyn_cast<llvm::LoadInst>(access))
+  {
+    type = load->getType();
+    return load->getPointerOperand();
+  }
+  else if (auto store = llvm::dyn_cast<llvm::StoreInst>(access))
+  {
+    type = store->getValueOperand()->getType();
+    return store->getPointerOperand();
+  }
+  return NULL;
+}
+
+// Multiply a linear function of the work-item ID by a constant
+static bool scaleLinear(int64_t coeffs[3], int64_t& constant, int64_t factor)
+{
+  int64_t magnitude = std::max(constant, -constant);
+  for (unsigned i = 0; i < 3; i++)
+    magnitude = std::max(magnitude, std::max(coeffs[i], -coeffs[i]));
+  if (magnitude && std::max(factor, -factor) > RANGE_LIMIT / magnitude)
+    return false;
+
+  for (unsigned i = 0; i < 3; i++)
+    coeffs[i] *= factor;
+  constant *= factor;
+  return true;
+}
 
 KernelInvocation::KernelInvocation(const Context* context, const Kernel* kernel,
                                    unsigned int workDim, Size3 globalOffset,
@@ -41,6 +154,7 @@ KernelInvocation::KernelInvocation(const Context* context, const Kernel* kernel,
   m_globalOffset = globalOffset;
   m_globalSize = globalSize;
   m_localSize = localSize;
+  m_deviceTime = -1;
 
   m_numGroups.x = m_globalSize.x / m_localSize.x;
   m_numGroups.y = m_globalSize.y / m_localSize.y;
@@ -58,6 +172,18 @@ KernelInvocation::KernelInvocation(const Context* context, const Kernel* kernel,
   if (!m_numWorkers || !m_context->isThreadSafe())
     m_numWorkers = 1;
 
+  // Check for fiber-based execution (not supported in interactive mode)
+#if HAVE_UCONTEXT
+  m_useFibers =
+    checkEnv("OCLGRIND_FIBERS") && !checkEnv("OCLGRIND_INTERACTIVE");
+#else
+  m_useFibers = false;
+#endif
+
+  // Lay out local memory, keeping the first instance for worker 0
+  m_localMemories.resize(m_numWorkers);
+  m_localMemories[0].push_back(createLocalMemory(m_localAddresses));
+
   // Check for quick-mode environment variable
   if (checkEnv("OCLGRIND_QUICK"))
   {
@@ -91,6 +217,207 @@ KernelInvocation::~KernelInvocation()
     delete m_runningGroups.front();
     m_runningGroups.pop_front();
   }
+
+  // Destroy local memory pools
+  for (auto& pool : m_localMemories)
+  {
+    for (auto memory : pool)
+    {
+      delete memory;
+    }
+  }
+}
+
+Memory* KernelInvocation::acquireLocalMemory() const
+{
+  // Reuse a local memory previously released by this worker if possible
+  list<Memory*>& pool = m_localMemories[workerState.id];
+  if (pool.empty())
+  {
+    map<const llvm::Value*, size_t> addresses;
+    Memory* memory = createLocalMemory(addresses);
+    assert(addresses == m_localAddresses);
+    return memory;
+  }
+
+  Memory* memory = pool.back();
+  pool.pop_back();
+  return memory;
+}
+
+void KernelInvocation::analyzeMemoryAccesses() const
+{
+  Memory* globalMemory = m_context->getGlobalMemory();
+
+  // Find the buffers passed to the kernel's global and constant pointers
+  map<const llvm::Value*, size_t> buffers;
+  for (auto value = m_kernel->values_begin(); value != m_kernel->values_end();
+       value++)
+  {
+    const llvm::Type* type = value->first->getType();
+    if (llvm::isa<llvm::Argument>(value->first) && type->isPointerTy() &&
+        (type->getPointerAddressSpace() == AddrSpaceGlobal ||
+         type->getPointerAddressSpace() == AddrSpaceConstant))
+    {
+      buffers[value->first] = value->second.getPointer();
+    }
+  }
+  if (buffers.empty())
+    return;
+
+  // Try to prove that each load and store through one of those pointers
+  // stays within its buffer for every work-item in the NDRange
+  const llvm::Function* function = m_kernel->getFunction();
+  for (auto B = function->begin(); B != function->end(); B++)
+  {
+    for (auto I = B->begin(); I != B->end(); I++)
+    {
+      const llvm::Type* type;
+      const llvm::Value* pointer = getAccessPointer(&*I, type);
+      if (!pointer)
+        continue;
+
+      const llvm::Argument* base;
+      int64_t min, max;
+      if (!getPointerRange(pointer, base, min, max))
+        continue;
+
+      auto buffer = buffers.find(base);
+      if (buffer == buffers.end() ||
+          !globalMemory->isAddressValid(buffer->second))
+        continue;
+
+      int64_t size = globalMemory->getBuffer(buffer->second)->size;
+      int64_t offset = globalMemory->extractOffset(buffer->second);
+      if (offset + min >= 0 && offset + max + getTypeSize(type) <= size)
+      {
+        m_inBoundsAccesses.insert(&*I);
+      }
+    }
+  }
+}
+
+void KernelInvocation::analyzeRaceFreeAccesses() const
+{
+  // Count the global pointer arguments that point into each buffer
+  Memory* globalMemory = m_context->getGlobalMemory();
+  map<const llvm::Value*, size_t> buffers;
+  map<size_t, unsigned> bufferArgs;
+  for (auto value = m_kernel->values_begin(); value != m_kernel->values_end();
+       value++)
+  {
+    const llvm::Type* type = value->first->getType();
+    if (llvm::isa<llvm::Argument>(value->first) && type->isPointerTy() &&
+        type->getPointerAddressSpace() == AddrSpaceGlobal)
+    {
+      size_t buffer = globalMemory->extractBuffer(value->second.getPointer());
+      buffers[value->first] = buffer;
+      bufferArgs[buffer]++;
+    }
+  }
+
+  const llvm::Function* function = m_kernel->getFunction();
+  for (auto arg = function->arg_begin(); arg != function->arg_end(); arg++)
+  {
+    // Global buffers are partitioned by global ID, and local buffers by
+    // local ID, as long as no other argument aliases the buffer
+    const llvm::Type* type = arg->getType();
+    if (!type->isPointerTy())
+      continue;
+    bool local = type->getPointerAddressSpace() == AddrSpaceLocal;
+    if (!local)
+    {
+      auto buffer = buffers.find(&*arg);
+      if (buffer == buffers.end() || !buffer->second ||
+          bufferArgs[buffer->second] != 1)
+        continue;
+    }
+
+    vector<const llvm::Instruction*> accesses;
+    if (!findAccesses(&*arg, accesses) || accesses.empty())
+      continue;
+
+    // Every access must use the same function of the work-item ID, plus a
+    // constant offset
+    int64_t coeffs[3], lo, hi;
+    bool valid = true;
+    for (unsigned i = 0; i < accesses.size() && valid; i++)
+    {
+      const llvm::Type* type;
+      const llvm::Value* pointer = getAccessPointer(accesses[i], type);
+
+      int64_t c[3] = {0, 0, 0}, constant = 0;
+      if (!getLinearOffset(pointer, local, c, constant))
+      {
+        valid = false;
+      }
+      else if (i == 0)
+      {
+        copy(c, c + 3, coeffs);
+        lo = constant;
+        hi = constant + getTypeSize(type);
+      }
+      else if (!equal(c, c + 3, coeffs))
+      {
+        valid = false;
+      }
+      else
+      {
+        lo = std::min(lo, constant);
+        hi = std::max(hi, constant + (int64_t)getTypeSize(type));
+      }
+    }
+    if (!valid)
+      continue;
+
+    // The bytes accessed by each work-item must not overlap with any other
+    // work-item, so every dimension with more than one work-item must be
+    // used, and each must step over the span of the dimensions before it
+    const Size3& extent = local ? m_localSize : m_globalSize;
+    vector<pair<int64_t, int64_t>> dims;
+    for (unsigned d = 0; d < m_workDim && valid; d++)
+    {
+      if (extent[d] > 1)
+      {
+        valid = coeffs[d] != 0;
+        dims.push_back(make_pair(std::max(coeffs[d], -coeffs[d]), extent[d]));
+      }
+    }
+    sort(dims.begin(), dims.end());
+
+    int64_t span = hi - lo;
+    for (auto dim = dims.begin(); dim != dims.end() && valid; dim++)
+    {
+      valid = dim->first >= span;
+      span += dim->first * (dim->second - 1);
+      valid = valid && span <= RANGE_LIMIT;
+    }
+    if (!valid)
+      continue;
+
+    m_raceFreeAccesses.insert(accesses.begin(), accesses.end());
+  }
+}
+
+Memory* KernelInvocation::createLocalMemory(
+  map<const llvm::Value*, size_t>& addresses) const
+{
+  Memory* memory =
+    new Memory(AddrSpaceLocal, sizeof(size_t) == 8 ? 16 : 8, m_context);
+
+  // Allocate local memory buffers in a fixed order, so that every instance
+  // has the same layout
+  for (auto value = m_kernel->values_begin(); value != m_kernel->values_end();
+       value++)
+  {
+    const llvm::Type* type = value->first->getType();
+    if (type->isPointerTy() && type->getPointerAddressSpace() == AddrSpaceLocal)
+    {
+      addresses[value->first] = memory->allocateBuffer(value->second.size);
+    }
+  }
+
+  return memory;
 }
 
 const Context* KernelInvocation::getContext() const
@@ -118,6 +445,11 @@ Size3 KernelInvocation::getGlobalSize() const
   return m_globalSize;
 }
 
+double KernelInvocation::getDeviceTime() const
+{
+  return m_deviceTime;
+}
+
 const Kernel* KernelInvocation::getKernel() const
 {
   return m_kernel;
@@ -128,19 +460,434 @@ Size3 KernelInvocation::getLocalSize() const
   return m_localSize;
 }
 
+size_t KernelInvocation::getLocalMemoryAddress(const llvm::Value* value) const
+{
+  return m_localAddresses.at(value);
+}
+
 Size3 KernelInvocation::getNumGroups() const
 {
   return m_numGroups;
 }
 
+unsigned KernelInvocation::getNumWorkers() const
+{
+  return m_numWorkers;
+}
+
+bool KernelInvocation::getLinearIndex(const llvm::Value* value, bool local,
+                                      int64_t coeffs[3], int64_t& constant,
+                                      unsigned depth) const
+{
+  // Values that are the same for every work-item are constant
+  int64_t min, max;
+  if (depth > 16 || !getValueRange(value, min, max))
+    return false;
+  if (min == max)
+  {
+    constant = min;
+    return true;
+  }
+
+  string name;
+  unsigned dim;
+  if (getWorkItemCall(value, m_workDim, name, dim))
+  {
+    if (name != (local ? "get_local_id" : "get_global_id"))
+      return false;
+    coeffs[dim] = 1;
+    return true;
+  }
+  else if (auto cast = llvm::dyn_cast<llvm::CastInst>(value))
+  {
+    // The range check above rules out any casts that change the value
+    return getLinearIndex(cast->getOperand(0), local, coeffs, constant,
+                          depth + 1);
+  }
+  else if (auto binOp = llvm::dyn_cast<llvm::BinaryOperator>(value))
+  {
+    int64_t a[3] = {0, 0, 0}, b[3] = {0, 0, 0}, aConst = 0, bConst = 0;
+    if (!getLinearIndex(binOp->getOperand(0), local, a, aConst, depth + 1) ||
+        !getLinearIndex(binOp->getOperand(1), local, b, bConst, depth + 1))
+      return false;
+    bool aUniform = !a[0] && !a[1] && !a[2];
+    bool bUniform = !b[0] && !b[1] && !b[2];
+
+    switch (binOp->getOpcode())
+    {
+    case llvm::Instruction::Add:
+    case llvm::Instruction::Sub:
+    {
+      int64_t sign = binOp->getOpcode() == llvm::Instruction::Add ? 1 : -1;
+      for (unsigned i = 0; i < 3; i++)
+        coeffs[i] = a[i] + sign * b[i];
+      constant = aConst + sign * bConst;
+      break;
+    }
+    case llvm::Instruction::Mul:
+      if (bUniform)
+      {
+        copy(a, a + 3, coeffs);
+        constant = aConst;
+        return scaleLinear(coeffs, constant, bConst);
+      }
+      else if (aUniform)
+      {
+        copy(b, b + 3, coeffs);
+        constant = bConst;
+        return scaleLinear(coeffs, constant, aConst);
+      }
+      return false;
+    case llvm::Instruction::Shl:
+      if (!bUniform || bConst < 0 || bConst >= 48)
+        return false;
+      copy(a, a + 3, coeffs);
+      constant = aConst;
+      return scaleLinear(coeffs, constant, (int64_t)1 << bConst);
+    default:
+      return false;
+    }
+    for (unsigned i = 0; i < 3; i++)
+    {
+      if (std::max(coeffs[i], -coeffs[i]) > RANGE_LIMIT)
+        return false;
+    }
+    return std::max(constant, -constant) <= RANGE_LIMIT;
+  }
+
+  return false;
+}
+
+bool KernelInvocation::getLinearOffset(const llvm::Value* pointer, bool local,
+                                       int64_t coeffs[3],
+                                       int64_t& constant) const
+{
+  pointer = pointer->stripPointerCasts();
+  if (llvm::isa<llvm::Argument>(pointer))
+    return true;
+
+  auto gep = llvm::dyn_cast<llvm::GetElementPtrInst>(pointer);
+  if (!gep || !getLinearOffset(gep->getPointerOperand(), local, coeffs,
+                               constant))
+    return false;
+
+  // Add each index multiplied by the same strides as the interpreter
+  const llvm::Type* type = gep->getPointerOperandType();
+  for (auto opItr = gep->idx_begin(); opItr != gep->idx_end(); opItr++)
+  {
+    int64_t c[3] = {0, 0, 0}, k = 0;
+    if (!getLinearIndex(opItr->get(), local, c, k))
+      return false;
+
+    if (type->isStructTy())
+    {
+      constant += getStructMemberOffset((const llvm::StructType*)type, k);
+      type = type->getStructElementType(k);
+      continue;
+    }
+
+    if (type->isPointerTy())
+      type = type->getPointerElementType();
+    else if (type->isArrayTy())
+      type = type->getArrayElementType();
+    else if (type->isVectorTy())
+      type = llvm::cast<llvm::FixedVectorType>(type)->getElementType();
+    else
+      return false;
+
+    if (!scaleLinear(c, k, getTypeSize(type)))
+      return false;
+    for (unsigned i = 0; i < 3; i++)
+    {
+      coeffs[i] += c[i];
+      if (std::max(coeffs[i], -coeffs[i]) > RANGE_LIMIT)
+        return false;
+    }
+    constant += k;
+    if (std::max(constant, -constant) > RANGE_LIMIT)
+      return false;
+  }
+
+  return true;
+}
+
+bool KernelInvocation::getPointerRange(const llvm::Value* pointer,
+                                       const llvm::Argument*& base,
+                                       int64_t& min, int64_t& max) const
+{
+  pointer = pointer->stripPointerCasts();
+  if (auto arg = llvm::dyn_cast<llvm::Argument>(pointer))
+  {
+    base = arg;
+    min = max = 0;
+    return true;
+  }
+
+  auto gep = llvm::dyn_cast<llvm::GetElementPtrInst>(pointer);
+  if (!gep || !getPointerRange(gep->getPointerOperand(), base, min, max))
+    return false;
+
+  // Add the range of byte offsets produced by each index, using the same
+  // strides as the interpreter
+  const llvm::Type* type = gep->getPointerOperandType();
+  for (auto opItr = gep->idx_begin(); opItr != gep->idx_end(); opItr++)
+  {
+    int64_t lo, hi;
+    if (!getValueRange(opItr->get(), lo, hi))
+      return false;
+
+    if (type->isStructTy())
+    {
+      min += getStructMemberOffset((const llvm::StructType*)type, lo);
+      max += getStructMemberOffset((const llvm::StructType*)type, lo);
+      type = type->getStructElementType(lo);
+      continue;
+    }
+
+    // Indices into arrays and vectors must also stay within those types
+    if (type->isPointerTy())
+    {
+      type = type->getPointerElementType();
+    }
+    else if (type->isArrayTy())
+    {
+      if (lo < 0 || (uint64_t)hi >= type->getArrayNumElements())
+        return false;
+      type = type->getArrayElementType();
+    }
+    else if (type->isVectorTy())
+    {
+      auto vecType = llvm::cast<llvm::FixedVectorType>(type);
+      if (lo < 0 || (uint64_t)hi >= vecType->getNumElements())
+        return false;
+      type = vecType->getElementType();
+    }
+    else
+    {
+      return false;
+    }
+
+    int64_t stride = getTypeSize(type);
+    if (!stride)
+      continue;
+    if (hi > RANGE_LIMIT / stride || lo < -RANGE_LIMIT / stride)
+      return false;
+    min += lo * stride;
+    max += hi * stride;
+    if (min < -RANGE_LIMIT || max > RANGE_LIMIT)
+      return false;
+  }
+
+  return true;
+}
+
+bool KernelInvocation::getValueRange(const llvm::Value* value, int64_t& min,
+                                     int64_t& max, unsigned depth) const
+{
+  if (depth > 16 || !value->getType()->isIntegerTy() ||
+      value->getType()->getIntegerBitWidth() > 64)
+    return false;
+
+  if (auto constInt = llvm::dyn_cast<llvm::ConstantInt>(value))
+  {
+    min = max = constInt->getSExtValue();
+  }
+  else if (llvm::isa<llvm::Argument>(value))
+  {
+    // Scalar arguments are fixed for the whole launch
+    auto arg = m_kernel->values_find(value);
+    if (arg == m_kernel->values_end())
+      return false;
+    min = max = arg->second.getSInt();
+  }
+  else if (llvm::isa<llvm::CallInst>(value))
+  {
+    // Work-item functions are bounded by the NDRange
+    string name;
+    unsigned dim;
+    if (!getWorkItemCall(value, m_workDim, name, dim))
+      return false;
+
+    if (name == "get_global_id")
+    {
+      min = m_globalOffset[dim];
+      max = m_globalOffset[dim] + m_globalSize[dim] - 1;
+    }
+    else if (name == "get_local_id")
+    {
+      min = 0;
+      max = m_localSize[dim] - 1;
+    }
+    else if (name == "get_group_id")
+    {
+      min = 0;
+      max = m_numGroups[dim] - 1;
+    }
+    else if (name == "get_global_offset")
+    {
+      min = max = m_globalOffset[dim];
+    }
+    else if (name == "get_global_size")
+    {
+      min = max = m_globalSize[dim];
+    }
+    else if (name == "get_enqueued_local_size")
+    {
+      min = max = m_localSize[dim];
+    }
+    else if (name == "get_local_size")
+    {
+      min = 1;
+      max = m_localSize[dim];
+    }
+    else if (name == "get_num_groups")
+    {
+      min = max = m_numGroups[dim];
+    }
+    else
+    {
+      return false;
+    }
+  }
+  else if (auto cast = llvm::dyn_cast<llvm::CastInst>(value))
+  {
+    if (!getValueRange(cast->getOperand(0), min, max, depth + 1))
+      return false;
+
+    // Values are tracked as signed, so zero-extension needs a sign bit of 0
+    switch (cast->getOpcode())
+    {
+    case llvm::Instruction::SExt:
+    case llvm::Instruction::Trunc:
+      break;
+    case llvm::Instruction::ZExt:
+      if (min < 0)
+        return false;
+      break;
+    default:
+      return false;
+    }
+  }
+  else if (auto select = llvm::dyn_cast<llvm::SelectInst>(value))
+  {
+    int64_t lo, hi;
+    if (!getValueRange(select->getTrueValue(), min, max, depth + 1) ||
+        !getValueRange(select->getFalseValue(), lo, hi, depth + 1))
+      return false;
+    min = std::min(min, lo);
+    max = std::max(max, hi);
+  }
+  else if (auto binOp = llvm::dyn_cast<llvm::BinaryOperator>(value))
+  {
+    int64_t aMin, aMax, bMin, bMax;
+    if (!getValueRange(binOp->getOperand(0), aMin, aMax, depth + 1) ||
+        !getValueRange(binOp->getOperand(1), bMin, bMax, depth + 1))
+      return false;
+
+    switch (binOp->getOpcode())
+    {
+    case llvm::Instruction::Add:
+      min = aMin + bMin;
+      max = aMax + bMax;
+      break;
+    case llvm::Instruction::Sub:
+      min = aMin - bMax;
+      max = aMax - bMin;
+      break;
+    case llvm::Instruction::Mul:
+    {
+      // Operands are bounded by RANGE_LIMIT, so only allow products of
+      // values that can't overflow
+      int64_t a = std::max(-aMin, aMax);
+      int64_t b = std::max(-bMin, bMax);
+      if (a > 0 && b > RANGE_LIMIT / a)
+        return false;
+      int64_t products[] = {aMin * bMin, aMin * bMax, aMax * bMin,
+                            aMax * bMax};
+      min = *std::min_element(products, products + 4);
+      max = *std::max_element(products, products + 4);
+      break;
+    }
+    case llvm::Instruction::Shl:
+      if (bMin != bMax || bMin < 0 || bMin >= 48 ||
+          std::max(-aMin, aMax) > (RANGE_LIMIT >> bMin))
+        return false;
+      min = aMin * ((int64_t)1 << bMin);
+      max = aMax * ((int64_t)1 << bMin);
+      break;
+    case llvm::Instruction::LShr:
+    case llvm::Instruction::AShr:
+      if (bMin != bMax || bMin < 0 || bMin >= 64 || aMin < 0)
+        return false;
+      min = aMin >> bMin;
+      max = aMax >> bMin;
+      break;
+    case llvm::Instruction::UDiv:
+    case llvm::Instruction::SDiv:
+      if (bMin != bMax || bMin <= 0 || aMin < 0)
+        return false;
+      min = aMin / bMin;
+      max = aMax / bMin;
+      break;
+    case llvm::Instruction::URem:
+    case llvm::Instruction::SRem:
+      if (bMin != bMax || bMin <= 0 || aMin < 0)
+        return false;
+      min = 0;
+      max = std::min(aMax, bMin - 1);
+      break;
+    case llvm::Instruction::And:
+      // Masking with a non-negative constant bounds the result
+      if (bMin != bMax || bMin < 0)
+        return false;
+      min = 0;
+      max = bMin;
+      break;
+    default:
+      return false;
+    }
+  }
+  else
+  {
+    return false;
+  }
+
+  // The value must be representable by its type, so that no wrapping
+  // occurred, and small enough for later arithmetic
+  unsigned bits = value->getType()->getIntegerBitWidth();
+  if (bits < 64 && (min < -((int64_t)1 << (bits - 1)) ||
+                    max >= ((int64_t)1 << (bits - 1))))
+    return false;
+  return min <= max && min >= -RANGE_LIMIT && max <= RANGE_LIMIT;
+}
+
 size_t KernelInvocation::getWorkDim() const
 {
   return m_workDim;
 }
 
-void KernelInvocation::run(const Context* context, Kernel* kernel,
-                           unsigned int workDim, Size3 globalOffset,
-                           Size3 globalSize, Size3 localSize)
+bool KernelInvocation::isAccessInBounds(
+  const llvm::Instruction* instruction) const
+{
+  call_once(m_inBoundsAnalyzed, [this] { analyzeMemoryAccesses(); });
+  return m_inBoundsAccesses.count(instruction);
+}
+
+bool KernelInvocation::isAccessRaceFree(
+  const llvm::Instruction* instruction) const
+{
+  call_once(m_raceFreeAnalyzed, [this] { analyzeRaceFreeAccesses(); });
+  return m_raceFreeAccesses.count(instruction);
+}
+
+void KernelInvocation::setDeviceTime(double time) const
+{
+  m_deviceTime = time;
+}
+
+double KernelInvocation::run(const Context* context, Kernel* kernel,
+                             unsigned int workDim, Size3 globalOffset,
+                             Size3 globalSize, Size3 localSize)
 {
   // Create kernel invocation
   KernelInvocation* ki = new KernelInvocation(
@@ -151,12 +898,80 @@ void KernelInvocation::run(const Context* context, Kernel* kernel,
   ki->run();
   context->notifyKernelEnd(ki);
 
+  // Run any kernels that were enqueued by this kernel before it is
+  // considered complete
+  list<ChildKernel> children;
+  children.swap(ki->m_childKernels);
+  double childTime = ki->runChildKernels(children);
+
+  double deviceTime = ki->m_deviceTime;
+  if (deviceTime >= 0 && childTime > 0)
+    deviceTime += childTime;
+
   delete ki;
+
+  return deviceTime;
+}
+
+void KernelInvocation::enqueueChildKernel(
+  const llvm::Function* function, unsigned workDim, Size3 globalOffset,
+  Size3 globalSize, Size3 localSize, vector<uint8_t> block,
+  vector<size_t> localArgSizes) const
+{
+  ChildKernel child = {function,   workDim, globalOffset,
+                       globalSize, localSize, block,
+                       localArgSizes};
+
+  lock_guard<mutex> lock(m_childKernelMutex);
+  m_childKernels.push_back(child);
+}
+
+double KernelInvocation::runChildKernels(list<ChildKernel>& children) const
+{
+  double deviceTime = 0;
+  Memory* globalMemory = m_context->getGlobalMemory();
+  for (auto& child : children)
+  {
+    Kernel* kernel = m_kernel->getProgram()->createKernel(child.function);
+
+    // Copy the block literal to global memory
+    size_t block =
+      globalMemory->allocateBuffer(child.block.size(), 0, child.block.data());
+    if (!block)
+    {
+      m_context->logError("Failed to allocate block for enqueued kernel");
+      delete kernel;
+      continue;
+    }
+
+    // The first argument is the block literal, followed by any local memory
+    // pointers
+    TypedValue blockArg = {sizeof(size_t), 1, new uint8_t[sizeof(size_t)]};
+    blockArg.setPointer(block);
+    kernel->setArgument(0, blockArg);
+    delete[] blockArg.data;
+    for (unsigned i = 0; i < child.localArgSizes.size(); i++)
+    {
+      TypedValue localArg = {(unsigned)child.localArgSizes[i], 1, NULL};
+      kernel->setArgument(i + 1, localArg);
+    }
+
+    double childTime = run(m_context, kernel, child.workDim,
+                           child.globalOffset, child.globalSize,
+                           child.localSize);
+    if (childTime > 0)
+      deviceTime += childTime;
+
+    globalMemory->deallocateBuffer(block);
+    delete kernel;
+  }
+
+  return deviceTime;
 }
 
 void KernelInvocation::run()
 {
-  nextGroupIndex = 0;
+  m_nextGroupIndex = 0;
 
   // Create worker threads
   // TODO: Run in main thread if only 1 worker
@@ -178,11 +993,33 @@ int KernelInvocation::getWorkerID() const
   return workerState.id;
 }
 
+void KernelInvocation::suspendWorkItem() const
+{
+#if HAVE_UCONTEXT
+  // Switch back to the scheduler until the work-item is resumed
+  if (workerState.fiber)
+  {
+    Fiber* fiber = workerState.fiber;
+    swapcontext(&fiber->context, &workerState.scheduler);
+  }
+#endif
+}
+
+void KernelInvocation::releaseLocalMemory(Memory* memory) const
+{
+  m_localMemories[workerState.id].push_back(memory);
+}
+
 void KernelInvocation::runWorker(int id)
 {
   workerState.workGroup = NULL;
   workerState.workItem = NULL;
   workerState.id = id;
+#if HAVE_UCONTEXT
+  workerState.fiber = NULL;
+  workerState.fiberPool = new vector<Fiber*>;
+  workerState.fiberError = NULL;
+#endif
   try
   {
     while (true)
@@ -197,7 +1034,7 @@ void KernelInvocation::runWorker(int id)
       else
       {
         // Take next work-group from pending pool
-        unsigned index = nextGroupIndex++;
+        unsigned index = m_nextGroupIndex++;
         if (index >= m_workGroups.size())
           // No more work to do
           break;
@@ -217,27 +1054,34 @@ void KernelInvocation::runWorker(int id)
       }
 
       // Execute work-group
-      workerState.workItem = workerState.workGroup->getNextWorkItem();
-      while (workerState.workItem)
+      if (m_useFibers)
+      {
+        runWorkGroupFibers();
+      }
+      else
       {
-        // Run work-item until complete or at barrier
-        while (workerState.workItem->getState() == WorkItem::READY)
-        {
-          workerState.workItem->step();
-        }
-
-        // Move to next work-item
         workerState.workItem = workerState.workGroup->getNextWorkItem();
-        if (workerState.workItem)
-          continue;
-
-        // No more work-items in READY state
-        // Check if there are work-items at a barrier
-        if (workerState.workGroup->hasBarrier())
+        while (workerState.workItem)
         {
-          // Resume execution
-          workerState.workGroup->clearBarrier();
+          // Run work-item until complete or at barrier
+          while (workerState.workItem->getState() == WorkItem::READY)
+          {
+            workerState.workItem->step();
+          }
+
+          // Move to next work-item
           workerState.workItem = workerState.workGroup->getNextWorkItem();
+          if (workerState.workItem)
+            continue;
+
+          // No more work-items in READY state
+          // Check if there are work-items at a barrier
+          if (workerState.workGroup->hasBarrier())
+          {
+            // Resume execution
+            workerState.workGroup->clearBarrier();
+            workerState.workItem = workerState.workGroup->getNextWorkItem();
+          }
         }
       }
 
@@ -258,6 +1102,121 @@ void KernelInvocation::runWorker(int id)
     if (workerState.workGroup)
       delete workerState.workGroup;
   }
+
+#if HAVE_UCONTEXT
+  // Destroy fibers
+  for (auto fiber : *workerState.fiberPool)
+  {
+    delete[] fiber->stack;
+    delete fiber;
+  }
+  delete workerState.fiberPool;
+#endif
+}
+
+#if HAVE_UCONTEXT
+static void runFiber()
+{
+  // Fibers are reused, so keep running whichever work-item is assigned
+  while (true)
+  {
+    Fiber* fiber = workerState.fiber;
+    try
+    {
+      while (fiber->workItem->getState() == WorkItem::READY)
+      {
+        fiber->workItem->step();
+      }
+    }
+    catch (...)
+    {
+      // Exceptions cannot unwind past the start of the fiber's stack
+      workerState.fiberError = new exception_ptr(current_exception());
+    }
+
+    // Return to the scheduler
+    swapcontext(&fiber->context, &workerState.scheduler);
+  }
+}
+#endif
+
+void KernelInvocation::runWorkGroupFibers()
+{
+#if HAVE_UCONTEXT
+  // Work-items that are suspended at a barrier keep their fiber
+  unordered_map<WorkItem*, Fiber*> fibers;
+
+  WorkGroup* workGroup = workerState.workGroup;
+  WorkItem* workItem = workGroup->getNextWorkItem();
+  while (workItem)
+  {
+    // Get fiber for work-item
+    Fiber* fiber;
+    auto fItr = fibers.find(workItem);
+    if (fItr != fibers.end())
+    {
+      fiber = fItr->second;
+    }
+    else if (!workerState.fiberPool->empty())
+    {
+      fiber = workerState.fiberPool->back();
+      workerState.fiberPool->pop_back();
+      fiber->workItem = workItem;
+      fibers[workItem] = fiber;
+    }
+    else
+    {
+      fiber = new Fiber;
+      fiber->stack = new unsigned char[FIBER_STACK_SIZE];
+      fiber->workItem = workItem;
+      getcontext(&fiber->context);
+      fiber->context.uc_stack.ss_sp = fiber->stack;
+      fiber->context.uc_stack.ss_size = FIBER_STACK_SIZE;
+      fiber->context.uc_link = NULL;
+      makecontext(&fiber->context, runFiber, 0);
+      fibers[workItem] = fiber;
+    }
+
+    // Run work-item until it finishes or reaches a barrier
+    workerState.workItem = workItem;
+    workerState.fiber = fiber;
+    swapcontext(&workerState.scheduler, &fiber->context);
+    workerState.fiber = NULL;
+
+    if (workerState.fiberError)
+    {
+      // Fibers of unfinished work-items cannot be reused
+      for (auto& f : fibers)
+      {
+        delete[] f.second->stack;
+        delete f.second;
+      }
+
+      // Rethrow errors from the fiber on the worker's own stack
+      exception_ptr err = *workerState.fiberError;
+      delete workerState.fiberError;
+      workerState.fiberError = NULL;
+      rethrow_exception(err);
+    }
+
+    // Return fiber to pool once work-item has finished
+    if (workItem->getState() == WorkItem::FINISHED)
+    {
+      fibers.erase(workItem);
+      workerState.fiberPool->push_back(fiber);
+    }
+
+    // Move to next work-item, resuming any at a barrier once all have
+    // finished or reached it
+    workItem = workGroup->getNextWorkItem();
+    if (!workItem && workGroup->hasBarrier())
+    {
+      workGroup->clearBarrier();
+      workItem = workGroup->getNextWorkItem();
+    }
+  }
+  workerState.workItem = NULL;
+#endif
 }
 
 bool KernelInvocation::switchWorkItem(const Size3 gid)
@@ -297,7 +1256,7 @@ bool KernelInvocation::switchWorkItem(const Size3 gid)
   if (!found)
   {
     std::vector<Size3>::iterator pItr;
-    for (pItr = m_workGroups.begin() + nextGroupIndex;
+    for (pItr = m_workGroups.begin() + m_nextGroupIndex;
          pItr != m_workGroups.end(); pItr++)
     {
       if (group == *pItr)
@@ -309,8 +1268,8 @@ bool KernelInvocation::switchWorkItem(const Size3 gid)
         // Re-order list of groups accordingly
         // Safe since this is not in a multi-threaded context
         m_workGroups.erase(pItr);
-        m_workGroups.insert(m_workGroups.begin() + nextGroupIndex, group);
-        nextGroupIndex++;
+        m_workGroups.insert(m_workGroups.begin() + m_nextGroupIndex, group);
+        m_nextGroupIndex++;
 
         break;
       }
@@ -8,18 +8,33 @@
 
 #include "common.h"
 
+#include <atomic>
+#include <mutex>
+
+namespace llvm
+{
+class Argument;
+class Function;
+class Instruction;
+class Value;
+} // namespace llvm
+
 namespace oclgrind
 {
 class Context;
 class Kernel;
+class Memory;
 class WorkGroup;
 class WorkItem;
 
 class KernelInvocation
 {
 public:
-  static void run(const Context* context, Kernel* kernel, unsigned int workDim,
-                  Size3 globalOffset, Size3 globalSize, Size3 localSize);
+  // Returns the device execution time (in nanoseconds) estimated by a plugin,
+  // or a negative value if no estimate was provided
+  static double run(const Context* context, Kernel* kernel,
+                    unsigned int workDim, Size3 globalOffset, Size3 globalSize,
+                    Size3 localSize);
 
   const Context* getContext() const;
   const WorkGroup* getCurrentWorkGroup() const;
@@ -27,12 +42,27 @@ public:
   Size3 getGlobalOffset() const;
   Size3 getGlobalSize() const;
   Size3 getLocalSize() const;
+  double getDeviceTime() const;
   const Kernel* getKernel() const;
+  size_t getLocalMemoryAddress(const llvm::Value* value) const;
   Size3 getNumGroups() const;
+  unsigned getNumWorkers() const;
   size_t getWorkDim() const;
+  bool isAccessInBounds(const llvm::Instruction* instruction) const;
+  bool isAccessRaceFree(const llvm::Instruction* instruction) const;
+  void setDeviceTime(double time) const;
   bool switchWorkItem(const Size3 gid);
 
   int getWorkerID() const;
+  void suspendWorkItem() const;
+
+  Memory* acquireLocalMemory() const;
+  void releaseLocalMemory(Memory* memory) const;
+
+  void enqueueChildKernel(const llvm::Function* function, unsigned workDim,
+                          Size3 globalOffset, Size3 globalSize,
+                          Size3 localSize, std::vector<uint8_t> block,
+                          std::vector<size_t> localArgSizes) const;
 
 private:
   KernelInvocation(const Context* context, const Kernel* kernel,
@@ -50,12 +80,63 @@ private:
   Size3 m_localSize;
   Size3 m_numGroups;
 
+  // Loads and stores in the kernel function that are proven to stay within
+  // their buffer for every work-item in the NDRange. The analysis only runs
+  // the first time a plugin queries isAccessInBounds().
+  mutable std::set<const llvm::Instruction*> m_inBoundsAccesses;
+  mutable std::once_flag m_inBoundsAnalyzed;
+  void analyzeMemoryAccesses() const;
+  bool getPointerRange(const llvm::Value* pointer, const llvm::Argument*& base,
+                       int64_t& min, int64_t& max) const;
+  bool getValueRange(const llvm::Value* value, int64_t& min, int64_t& max,
+                     unsigned depth = 0) const;
+
+  // Loads and stores through a pointer argument whose address is an
+  // injective function of the work-item ID, where no other instruction can
+  // touch the same buffer, so that no two work-items access the same bytes.
+  // The analysis only runs the first time a plugin queries isAccessRaceFree().
+  mutable std::set<const llvm::Instruction*> m_raceFreeAccesses;
+  mutable std::once_flag m_raceFreeAnalyzed;
+  void analyzeRaceFreeAccesses() const;
+  bool getLinearIndex(const llvm::Value* value, bool local, int64_t coeffs[3],
+                      int64_t& constant, unsigned depth = 0) const;
+  bool getLinearOffset(const llvm::Value* pointer, bool local,
+                       int64_t coeffs[3], int64_t& constant) const;
+
+  // Device execution time estimated by a performance model plugin
+  mutable double m_deviceTime;
+
   // Current execution state
   std::vector<Size3> m_workGroups;
+  std::atomic<unsigned> m_nextGroupIndex;
   std::list<WorkGroup*> m_runningGroups;
 
   // Worker threads
   void runWorker(int id);
+  void runWorkGroupFibers();
   unsigned m_numWorkers;
+  bool m_useFibers;
+
+  // Local memory layout shared by all work-groups, and a pool of local
+  // memories for each worker that are reused across work-groups
+  std::map<const llvm::Value*, size_t> m_localAddresses;
+  mutable std::vector<std::list<Memory*>> m_localMemories;
+  Memory*
+  createLocalMemory(std::map<const llvm::Value*, size_t>& addresses) const;
+
+  // Kernels enqueued from the device, which run once this kernel completes
+  struct ChildKernel
+  {
+    const llvm::Function* function;
+    unsigned workDim;
+    Size3 globalOffset;
+    Size3 globalSize;
+    Size3 localSize;
+    std::vector<uint8_t> block;
+    std::vector<size_t> localArgSizes;
+  };
+  mutable std::list<ChildKernel> m_childKernels;
+  mutable std::mutex m_childKernelMutex;
+  double runChildKernels(std::list<ChildKernel>& children) const;
 };
 } // namespace oclgrind
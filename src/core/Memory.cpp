@@ -27,6 +27,34 @@ mutex atomicMutex[NUM_ATOMIC_MUTEXES];
 #define ATOMIC_MUTEX(offset)                                                   \
   atomicMutex[(((offset) >> 2) & (NUM_ATOMIC_MUTEXES - 1))]
 
+// Copy data using fixed-size copies for common scalar and vector sizes, which
+// the compiler turns into single moves instead of calls to memcpy
+static inline void copyData(unsigned char* dst, const unsigned char* src,
+                            size_t size)
+{
+  switch (size)
+  {
+  case 1:
+    *dst = *src;
+    break;
+  case 2:
+    memcpy(dst, src, 2);
+    break;
+  case 4:
+    memcpy(dst, src, 4);
+    break;
+  case 8:
+    memcpy(dst, src, 8);
+    break;
+  case 16:
+    memcpy(dst, src, 16);
+    break;
+  default:
+    memcpy(dst, src, size);
+    break;
+  }
+}
+
 Memory::Memory(unsigned addrSpace, unsigned bufferBits, const Context* context)
 {
   m_context = context;
@@ -34,8 +62,17 @@ Memory::Memory(unsigned addrSpace, unsigned bufferBits, const Context* context)
 
   m_numBitsBuffer = bufferBits;
   m_numBitsAddress = ((sizeof(size_t) << 3) - m_numBitsBuffer);
+  m_offsetMask = (((size_t)-1) >> m_numBitsBuffer);
   m_maxNumBuffers = ((size_t)1 << m_numBitsBuffer) - 1; // 0 reserved for NULL
   m_maxBufferSize = ((size_t)1 << m_numBitsAddress);
+  m_numMapRegions = 0;
+  m_numSVMRegions = 0;
+  m_numBuffers = 0;
+
+  // Kernels read the global buffer table without taking m_mutex, so reserve
+  // every slot up front to stop allocations from reallocating it under them
+  if (m_addressSpace == AddrSpaceGlobal)
+    m_memory.reserve(m_maxNumBuffers + 1);
 
   clear();
 }
@@ -45,6 +82,24 @@ Memory::~Memory()
   clear();
 }
 
+void Memory::addMapRegion(size_t address, size_t offset, size_t size,
+                          cl_map_flags flags)
+{
+  MapRegion map = {address, offset, size, getPointer(address + offset),
+                   (flags == CL_MAP_READ ? MapRegion::READ : MapRegion::WRITE)};
+
+  lock_guard<mutex> lock(m_mapMutex);
+  m_mapRegions.push_back(map);
+  m_numMapRegions = m_mapRegions.size();
+}
+
+void Memory::addSVMRegion(const void* ptr, size_t size, size_t address)
+{
+  lock_guard<mutex> lock(m_svmMutex);
+  m_svmRegions[(size_t)ptr] = {size, address};
+  m_numSVMRegions = m_svmRegions.size();
+}
+
 size_t Memory::allocateBuffer(size_t size, cl_mem_flags flags,
                               const uint8_t* initData)
 {
@@ -54,6 +109,11 @@ size_t Memory::allocateBuffer(size_t size, cl_mem_flags flags,
     return 0;
   }
 
+  // Global memory may be allocated from several host threads at once
+  unique_lock<mutex> lock(m_mutex, defer_lock);
+  if (m_addressSpace == AddrSpaceGlobal)
+    lock.lock();
+
   // Find first unallocated buffer slot
   unsigned b = getNextBuffer();
   if (b >= m_maxNumBuffers)
@@ -70,10 +130,11 @@ size_t Memory::allocateBuffer(size_t size, cl_mem_flags flags,
   if (b >= m_memory.size())
   {
     m_memory.push_back(buffer);
+    m_numBuffers.store(m_memory.size(), memory_order_release);
   }
   else
   {
-    m_memory[b] = buffer;
+    m_memory[b].store(buffer, memory_order_release);
   }
 
   m_totalAllocated += size;
@@ -98,19 +159,19 @@ template int32_t Memory::atomic(AtomicOp op, size_t address, int32_t value);
 
 template <typename T> T Memory::atomic(AtomicOp op, size_t address, T value)
 {
-  m_context->notifyMemoryAtomicLoad(this, op, address, sizeof(T));
-  m_context->notifyMemoryAtomicStore(this, op, address, sizeof(T));
+  address = translateSVMAddress(address);
 
   // Bounds check
-  if (!isAddressValid(address, sizeof(T)))
+  T* ptr = (T*)checkAccess(true, address, sizeof(T));
+  m_context->notifyMemoryAtomicLoad(this, op, address, sizeof(T));
+  checkAccess(false, address, sizeof(T));
+  m_context->notifyMemoryAtomicStore(this, op, address, sizeof(T));
+  if (!ptr)
   {
     return 0;
   }
 
-  // Get buffer
   size_t offset = extractOffset(address);
-  Buffer* buffer = m_memory[extractBuffer(address)];
-  T* ptr = (T*)(buffer->data + offset);
 
   if (m_addressSpace == AddrSpaceGlobal)
     ATOMIC_MUTEX(offset).lock();
@@ -166,18 +227,17 @@ template uint64_t Memory::atomicCmpxchg(size_t address, uint64_t cmp,
 
 template <typename T> T Memory::atomicCmpxchg(size_t address, T cmp, T value)
 {
-  m_context->notifyMemoryAtomicLoad(this, AtomicCmpXchg, address, sizeof(T));
+  address = translateSVMAddress(address);
 
   // Bounds check
-  if (!isAddressValid(address, sizeof(T)))
+  T* ptr = (T*)checkAccess(true, address, sizeof(T));
+  m_context->notifyMemoryAtomicLoad(this, AtomicCmpXchg, address, sizeof(T));
+  if (!ptr)
   {
     return 0;
   }
 
-  // Get buffer
   size_t offset = extractOffset(address);
-  Buffer* buffer = m_memory[extractBuffer(address)];
-  T* ptr = (T*)(buffer->data + offset);
 
   if (m_addressSpace == AddrSpaceGlobal)
     ATOMIC_MUTEX(offset).lock();
@@ -197,25 +257,74 @@ template <typename T> T Memory::atomicCmpxchg(size_t address, T cmp, T value)
   return old;
 }
 
+unsigned char* Memory::checkAccess(bool read, size_t address,
+                                   size_t size) const
+{
+  size_t offset;
+  const Buffer* buffer = resolveAddress(address, size, offset);
+  if (!buffer)
+  {
+    logInvalidAccess(read, address, size);
+    return NULL;
+  }
+
+  // Check the buffer's access qualifiers
+  if ((buffer->flags & (read ? CL_MEM_WRITE_ONLY : CL_MEM_READ_ONLY)) &&
+      m_context->isRunningKernel())
+  {
+    m_context->logError(read ? "Invalid read from write-only buffer"
+                             : "Invalid write to read-only buffer");
+  }
+
+  if (m_numMapRegions)
+  {
+    checkMapRegions(read, address, size);
+  }
+
+  return buffer->data + offset;
+}
+
+void Memory::checkMapRegions(bool read, size_t address, size_t size) const
+{
+  if (!m_context->isRunningKernel())
+  {
+    return;
+  }
+
+  // Check if memory location is currently mapped (for writing, if reading)
+  lock_guard<mutex> lock(m_mapMutex);
+  for (auto region = m_mapRegions.begin(); region != m_mapRegions.end();
+       region++)
+  {
+    if ((!read || region->type == MapRegion::WRITE) &&
+        address < region->address + region->size &&
+        address + size >= region->address)
+    {
+      m_context->logError(read ? "Invalid read from buffer mapped for writing"
+                               : "Invalid write to mapped buffer");
+    }
+  }
+}
+
 void Memory::clear()
 {
-  vector<Buffer*>::iterator itr;
-  for (itr = m_memory.begin(); itr != m_memory.end(); itr++)
+  for (auto itr = m_memory.begin(); itr != m_memory.end(); itr++)
   {
-    if (*itr)
+    if (Buffer* buffer = *itr)
     {
-      if (!((*itr)->flags & CL_MEM_USE_HOST_PTR))
+      if (!(buffer->flags & CL_MEM_USE_HOST_PTR))
       {
-        delete[](*itr)->data;
+        delete[] buffer->data;
       }
-      delete *itr;
+      delete buffer;
 
       size_t address = (itr - m_memory.begin()) << m_numBitsAddress;
       m_context->notifyMemoryDeallocated(this, address);
     }
   }
   m_memory.resize(1);
-  m_memory[0] = NULL;
+  m_memory[0].store(NULL);
+  m_numBuffers = 1;
   m_freeBuffers = queue<unsigned>();
   m_totalAllocated = 0;
 }
@@ -228,6 +337,11 @@ size_t Memory::createHostBuffer(size_t size, void* ptr, cl_mem_flags flags)
     return 0;
   }
 
+  // Global memory may be allocated from several host threads at once
+  unique_lock<mutex> lock(m_mutex, defer_lock);
+  if (m_addressSpace == AddrSpaceGlobal)
+    lock.lock();
+
   // Find first unallocated buffer slot
   unsigned b = getNextBuffer();
   if (b >= m_maxNumBuffers)
@@ -244,10 +358,11 @@ size_t Memory::createHostBuffer(size_t size, void* ptr, cl_mem_flags flags)
   if (b >= m_memory.size())
   {
     m_memory.push_back(buffer);
+    m_numBuffers.store(m_memory.size(), memory_order_release);
   }
   else
   {
-    m_memory[b] = buffer;
+    m_memory[b].store(buffer, memory_order_release);
   }
 
   m_totalAllocated += size;
@@ -261,47 +376,52 @@ size_t Memory::createHostBuffer(size_t size, void* ptr, cl_mem_flags flags)
 
 bool Memory::copy(size_t dst, size_t src, size_t size)
 {
-  m_context->notifyMemoryLoad(this, src, size);
+  dst = translateSVMAddress(dst);
+  src = translateSVMAddress(src);
 
   // Check source address
-  if (!isAddressValid(src, size))
+  unsigned char* src_data = checkAccess(true, src, size);
+  m_context->notifyMemoryLoad(this, src, size);
+  if (!src_data)
   {
     return false;
   }
-  size_t src_offset = extractOffset(src);
-  Buffer* src_buffer = m_memory.at(extractBuffer(src));
-
-  m_context->notifyMemoryStore(this, dst, size, src_buffer->data + src_offset);
 
   // Check destination address
-  if (!isAddressValid(dst, size))
+  unsigned char* dst_data = checkAccess(false, dst, size);
+  m_context->notifyMemoryStore(this, dst, size, src_data);
+  if (!dst_data)
   {
     return false;
   }
-  size_t dst_offset = extractOffset(dst);
-  Buffer* dst_buffer = m_memory.at(extractBuffer(dst));
 
   // Copy data
-  memcpy(dst_buffer->data + dst_offset, src_buffer->data + src_offset, size);
+  memcpy(dst_data, src_data, size);
 
   return true;
 }
 
 void Memory::deallocateBuffer(size_t address)
 {
-  unsigned buffer = extractBuffer(address);
-  assert(buffer < m_memory.size() && m_memory[buffer]);
+  unique_lock<mutex> lock(m_mutex, defer_lock);
+  if (m_addressSpace == AddrSpaceGlobal)
+    lock.lock();
+
+  unsigned b = extractBuffer(address);
+  assert(b < m_memory.size() && m_memory[b]);
 
-  if (!(m_memory[buffer]->flags & CL_MEM_USE_HOST_PTR))
+  Buffer* buffer = m_memory[b];
+  m_memory[b].store(NULL);
+
+  if (!(buffer->flags & CL_MEM_USE_HOST_PTR))
   {
-    delete[] m_memory[buffer]->data;
+    delete[] buffer->data;
   }
 
-  m_totalAllocated -= m_memory[buffer]->size;
-  m_freeBuffers.push(buffer);
+  m_totalAllocated -= buffer->size;
+  m_freeBuffers.push(b);
 
-  delete m_memory[buffer];
-  m_memory[buffer] = NULL;
+  delete buffer;
 
   m_context->notifyMemoryDeallocated(this, address);
 }
@@ -310,12 +430,13 @@ void Memory::dump() const
 {
   for (unsigned b = 1; b < m_memory.size(); b++)
   {
-    if (!m_memory[b] || !m_memory[b]->data)
+    const Buffer* buffer = m_memory[b];
+    if (!buffer || !buffer->data)
     {
       continue;
     }
 
-    for (unsigned i = 0; i < m_memory[b]->size; i++)
+    for (unsigned i = 0; i < buffer->size; i++)
     {
       if (i % 4 == 0)
       {
@@ -324,7 +445,7 @@ void Memory::dump() const
              << ((((size_t)b) << m_numBitsAddress) | i) << ":";
       }
       cout << " " << hex << uppercase << setw(2) << setfill('0')
-           << (int)m_memory[b]->data[i];
+           << (int)buffer->data[i];
     }
   }
   cout << endl;
@@ -337,7 +458,7 @@ size_t Memory::extractBuffer(size_t address) const
 
 size_t Memory::extractOffset(size_t address) const
 {
-  return (address & (((size_t)-1) >> m_numBitsBuffer));
+  return (address & m_offsetMask);
 }
 
 unsigned int Memory::getAddressSpace() const
@@ -348,12 +469,17 @@ unsigned int Memory::getAddressSpace() const
 const Memory::Buffer* Memory::getBuffer(size_t address) const
 {
   size_t buf = extractBuffer(address);
-  if (buf == 0 || buf >= m_memory.size() || !m_memory[buf]->data)
+  if (buf == 0 || buf >= m_numBuffers.load(memory_order_acquire))
   {
     return NULL;
   }
 
-  return m_memory[buf];
+  const Buffer* buffer = m_memory[buf].load(memory_order_acquire);
+  if (!buffer || !buffer->data)
+  {
+    return NULL;
+  }
+  return buffer;
 }
 
 size_t Memory::getMaxAllocSize()
@@ -377,15 +503,32 @@ unsigned Memory::getNextBuffer()
 
 void* Memory::getPointer(size_t address) const
 {
-  size_t buffer = extractBuffer(address);
-
   // Bounds check
-  if (!isAddressValid(address))
+  size_t offset;
+  const Buffer* buffer = resolveAddress(address, 1, offset);
+  if (!buffer)
   {
     return NULL;
   }
 
-  return m_memory[buffer]->data + extractOffset(address);
+  return buffer->data + offset;
+}
+
+void Memory::logInvalidAccess(bool read, size_t address, size_t size) const
+{
+  if (!m_context->isRunningKernel())
+  {
+    return;
+  }
+
+  Context::Message msg(ERROR, m_context);
+  msg << "Invalid " << (read ? "read" : "write") << " of size " << size
+      << " at " << getAddressSpaceName(m_addressSpace)
+      << " memory address 0x" << hex << address << endl
+      << msg.INDENT << "Kernel: " << msg.CURRENT_KERNEL << endl
+      << "Entity: " << msg.CURRENT_ENTITY << endl
+      << msg.CURRENT_LOCATION << endl;
+  msg.send();
 }
 
 size_t Memory::getTotalAllocated() const
@@ -395,65 +538,123 @@ size_t Memory::getTotalAllocated() const
 
 bool Memory::isAddressValid(size_t address, size_t size) const
 {
-  size_t buffer = extractBuffer(address);
-  size_t offset = extractOffset(address);
-  if (buffer == 0 || buffer >= m_memory.size() || !m_memory[buffer] ||
-      offset + size > m_memory[buffer]->size)
-  {
-    return false;
-  }
-  return true;
+  size_t offset;
+  return resolveAddress(address, size, offset) != NULL;
 }
 
 bool Memory::load(unsigned char* dest, size_t address, size_t size) const
 {
-  m_context->notifyMemoryLoad(this, address, size);
+  address = translateSVMAddress(address);
 
   // Bounds check
-  if (!isAddressValid(address, size))
+  unsigned char* src = checkAccess(true, address, size);
+  m_context->notifyMemoryLoad(this, address, size);
+  if (!src)
   {
     return false;
   }
 
-  // Get buffer
-  size_t offset = extractOffset(address);
-  Buffer* src = m_memory[extractBuffer(address)];
-
   // Load data
-  memcpy(dest, src->data + offset, size);
+  copyData(dest, src, size);
 
   return true;
 }
 
 void* Memory::mapBuffer(size_t address, size_t offset, size_t size)
 {
-  size_t buffer = extractBuffer(address);
-
   // Bounds check
-  if (!isAddressValid(address, size))
+  size_t addressOffset;
+  const Buffer* buffer = resolveAddress(address, size, addressOffset);
+  if (!buffer)
   {
     return NULL;
   }
 
-  return m_memory[buffer]->data + offset + extractOffset(address);
+  return buffer->data + offset + addressOffset;
+}
+
+void Memory::removeMapRegion(size_t address, const void* ptr)
+{
+  lock_guard<mutex> lock(m_mapMutex);
+  for (auto region = m_mapRegions.begin(); region != m_mapRegions.end();
+       region++)
+  {
+    if (region->ptr == ptr)
+    {
+      m_mapRegions.erase(region);
+      break;
+    }
+  }
+  m_numMapRegions = m_mapRegions.size();
+}
+
+void Memory::removeSVMRegion(const void* ptr)
+{
+  lock_guard<mutex> lock(m_svmMutex);
+  m_svmRegions.erase((size_t)ptr);
+  m_numSVMRegions = m_svmRegions.size();
+}
+
+const Memory::Buffer* Memory::resolveAddress(size_t address, size_t size,
+                                             size_t& offset) const
+{
+  // Decode the address once and bounds check it against its buffer
+  size_t buffer = address >> m_numBitsAddress;
+  offset = address & m_offsetMask;
+  if (buffer == 0 || buffer >= m_numBuffers.load(memory_order_acquire))
+  {
+    return NULL;
+  }
+
+  const Buffer* b = m_memory[buffer].load(memory_order_acquire);
+  if (!b || size > b->size || offset > b->size - size)
+  {
+    return NULL;
+  }
+
+  return b;
 }
 
 bool Memory::store(const unsigned char* source, size_t address, size_t size)
 {
-  m_context->notifyMemoryStore(this, address, size, source);
+  address = translateSVMAddress(address);
 
   // Bounds check
-  if (!isAddressValid(address, size))
+  unsigned char* dst = checkAccess(false, address, size);
+  m_context->notifyMemoryStore(this, address, size, source);
+  if (!dst)
   {
     return false;
   }
 
-  // Get buffer
-  size_t offset = extractOffset(address);
-  Buffer* dst = m_memory[extractBuffer(address)];
-
   // Store data
-  memcpy(dst->data + offset, source, size);
+  copyData(dst, source, size);
 
   return true;
 }
+
+size_t Memory::translateSVMAddress(size_t address) const
+{
+  // SVM pointers stored in memory by the host are host addresses, so map
+  // any address that isn't a valid device address onto its SVM allocation
+  size_t offset;
+  if (!m_numSVMRegions || resolveAddress(address, 1, offset))
+  {
+    return address;
+  }
+
+  lock_guard<mutex> lock(m_svmMutex);
+  auto itr = m_svmRegions.upper_bound(address);
+  if (itr == m_svmRegions.begin())
+  {
+    return address;
+  }
+  itr--;
+
+  offset = address - itr->first;
+  if (offset >= itr->second.size)
+  {
+    return address;
+  }
+  return itr->second.address + offset;
+}
@@ -8,6 +8,9 @@
 
 #include "common.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace oclgrind
 {
 class Context;
@@ -26,6 +29,9 @@ public:
   Memory(unsigned addrSpace, unsigned bufferBits, const Context* context);
   virtual ~Memory();
 
+  void addMapRegion(size_t address, size_t offset, size_t size,
+                    cl_map_flags flags);
+  void addSVMRegion(const void* ptr, size_t size, size_t address);
   size_t allocateBuffer(size_t size, cl_mem_flags flags = 0,
                         const uint8_t* initData = NULL);
   template <typename T> T atomic(AtomicOp op, size_t address, T value = 0);
@@ -42,6 +48,8 @@ public:
   bool isAddressValid(size_t address, size_t size = 1) const;
   bool load(unsigned char* dst, size_t address, size_t size = 1) const;
   void* mapBuffer(size_t address, size_t offset, size_t size);
+  void removeMapRegion(size_t address, const void* ptr);
+  void removeSVMRegion(const void* ptr);
   bool store(const unsigned char* source, size_t address, size_t size = 1);
 
   size_t extractBuffer(size_t address) const;
@@ -52,15 +60,59 @@ public:
 private:
   const Context* m_context;
   std::queue<unsigned> m_freeBuffers;
-  std::vector<Buffer*> m_memory;
+
+  // Kernels resolve global addresses without taking m_mutex, so slots and
+  // the number of slots in use are published atomically
+  struct BufferSlot : std::atomic<Buffer*>
+  {
+    BufferSlot(Buffer* buffer = NULL) : std::atomic<Buffer*>(buffer) {}
+    BufferSlot(const BufferSlot& slot) : std::atomic<Buffer*>(slot.load()) {}
+  };
+  std::vector<BufferSlot> m_memory;
+  std::atomic<size_t> m_numBuffers;
   unsigned int m_addressSpace;
   size_t m_totalAllocated;
+  std::mutex m_mutex;
 
   unsigned m_numBitsBuffer;
   unsigned m_numBitsAddress;
+  size_t m_offsetMask;
   size_t m_maxNumBuffers;
   size_t m_maxBufferSize;
 
+  // Regions of buffers currently mapped by the host
+  struct MapRegion
+  {
+    size_t address;
+    size_t offset;
+    size_t size;
+    const void* ptr;
+    enum
+    {
+      READ,
+      WRITE
+    } type;
+  };
+  std::list<MapRegion> m_mapRegions;
+  std::atomic<size_t> m_numMapRegions;
+  mutable std::mutex m_mapMutex;
+
+  // Host allocations shared with kernels, keyed by host address
+  struct SVMRegion
+  {
+    size_t size;
+    size_t address;
+  };
+  std::map<size_t, SVMRegion> m_svmRegions;
+  std::atomic<size_t> m_numSVMRegions;
+  mutable std::mutex m_svmMutex;
+
   unsigned getNextBuffer();
+  unsigned char* checkAccess(bool read, size_t address, size_t size) const;
+  void checkMapRegions(bool read, size_t address, size_t size) const;
+  void logInvalidAccess(bool read, size_t address, size_t size) const;
+  const Buffer* resolveAddress(size_t address, size_t size,
+                               size_t& offset) const;
+  size_t translateSVMAddress(size_t address) const;
 };
 } // namespace oclgrind
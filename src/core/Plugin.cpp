@@ -14,6 +14,16 @@ Plugin::Plugin(const Context* context) : m_context(context) {}
 
 Plugin::~Plugin() {}
 
+unsigned Plugin::getRecordedEvents() const
+{
+  return ~0U;
+}
+
+bool Plugin::isDecoupled() const
+{
+  return false;
+}
+
 bool Plugin::isThreadSafe() const
 {
   return true;
@@ -19,6 +19,27 @@ class Memory;
 class WorkGroup;
 class WorkItem;
 
+// An instruction, kernel memory access or work-group completion, recorded
+// for decoupled plugins
+struct PluginEvent
+{
+  enum Type
+  {
+    INSTRUCTION_EXECUTED,
+    MEMORY_LOAD,
+    MEMORY_STORE,
+    MEMORY_ATOMIC_LOAD,
+    MEMORY_ATOMIC_STORE,
+    WORK_GROUP_COMPLETE,
+  } type;
+  const llvm::Instruction* instruction; // NULL for work-group events
+  size_t workItem;  // Global index, or -1 for work-group events
+  size_t workGroup; // Group index
+  unsigned addrSpace;
+  size_t address;
+  size_t size;
+};
+
 class Plugin
 {
 public:
@@ -80,12 +101,30 @@ public:
                            const void* ptr)
   {
   }
+  virtual void subGroupBarrier(const WorkGroup* workGroup,
+                               const std::vector<WorkItem*>& workItems,
+                               uint32_t flags)
+  {
+  }
   virtual void workGroupBarrier(const WorkGroup* workGroup, uint32_t flags) {}
   virtual void workGroupBegin(const WorkGroup* workGroup) {}
   virtual void workGroupComplete(const WorkGroup* workGroup) {}
   virtual void workItemBegin(const WorkItem* workItem) {}
   virtual void workItemComplete(const WorkItem* workItem) {}
 
+  // Decoupled plugins receive instruction, kernel memory access and
+  // work-group completion events in batches through eventsRecorded() on an
+  // analysis thread, instead of through the corresponding callbacks on the
+  // thread running the kernel. Events from a work-group are delivered in
+  // order, and all events are delivered before kernelEnd().
+  // getRecordedEvents() returns a mask of (1 << PluginEvent::Type) bits for
+  // the events the plugin needs. Synchronous plugins only receive the
+  // callbacks for those events. For decoupled plugins, only events needed by
+  // at least one plugin are recorded, so they must ignore other event types.
+  virtual void eventsRecorded(const PluginEvent* events, size_t num) {}
+  virtual unsigned getRecordedEvents() const;
+  virtual bool isDecoupled() const;
+
   virtual bool isThreadSafe() const;
 
 protected:
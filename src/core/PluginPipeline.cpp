@@ -0,0 +1,207 @@
+// PluginPipeline.cpp (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#include "common.h"
+
+#include "PluginPipeline.h"
+
+using namespace oclgrind;
+using namespace std;
+
+// Number of events a worker records before handing them off
+#define BATCH_SIZE 4096
+
+// Maximum number of batches waiting in a worker's ring before the worker
+// blocks (must be a power of two)
+#define MAX_PENDING_BATCHES 16
+
+THREAD_LOCAL PluginPipeline::WorkerState PluginPipeline::m_state = {0, 0,
+                                                                    NULL};
+
+static atomic<unsigned long> nextPipelineID(1);
+
+PluginPipeline::PluginPipeline(const list<Plugin*>& plugins,
+                               unsigned numWorkers, unsigned numThreads)
+    : m_plugins(plugins), m_id(nextPipelineID++)
+{
+  for (unsigned i = 0; i < numWorkers; i++)
+  {
+    BatchRing* ring = new BatchRing;
+    ring->slots = new Batch*[MAX_PENDING_BATCHES];
+    ring->head = 0;
+    ring->tail = 0;
+    m_rings.push_back(ring);
+  }
+
+  // Assign each worker's ring to a single analysis thread
+  numThreads = min(numThreads, numWorkers);
+  for (unsigned i = 0; i < numThreads; i++)
+  {
+    AnalysisThread* thread = new AnalysisThread;
+    for (unsigned w = i; w < numWorkers; w += numThreads)
+      thread->rings.push_back(m_rings[w]);
+    thread->pending = 0;
+    thread->idle = false;
+    thread->finished = false;
+    m_threads.push_back(thread);
+  }
+  for (auto thread : m_threads)
+    thread->thread = std::thread(&PluginPipeline::processBatches, this, thread);
+}
+
+PluginPipeline::~PluginPipeline()
+{
+  // Wait for the analysis threads to process every batch
+  for (auto thread : m_threads)
+  {
+    {
+      lock_guard<mutex> lock(thread->mutex);
+      thread->finished = true;
+    }
+    thread->condition.notify_all();
+    thread->thread.join();
+    delete thread;
+  }
+
+  for (auto ring : m_rings)
+  {
+    delete[] ring->slots;
+    delete ring;
+  }
+}
+
+void PluginPipeline::deliver(const PluginEvent* events, size_t num) const
+{
+  for (auto plugin : m_plugins)
+    plugin->eventsRecorded(events, num);
+}
+
+void PluginPipeline::flush()
+{
+  // Hand the calling worker's batch to its analysis thread
+  if (m_state.pipeline != m_id || !m_state.batch)
+    return;
+
+  unsigned worker = m_state.worker % m_rings.size();
+  BatchRing* ring = m_rings[worker];
+  AnalysisThread* thread = m_threads[worker % m_threads.size()];
+
+  // Wait for space in the ring if the analysis thread is falling behind
+  size_t tail = ring->tail.load(memory_order_relaxed);
+  while (tail - ring->head.load(memory_order_acquire) >= MAX_PENDING_BATCHES)
+    this_thread::yield();
+
+  // Count the batch before publishing it, so that the analysis thread never
+  // sees more batches than are pending
+  thread->pending++;
+  ring->slots[tail & (MAX_PENDING_BATCHES - 1)] = m_state.batch;
+  ring->tail.store(tail + 1, memory_order_release);
+  m_state.batch = NULL;
+
+  // Only wake the analysis thread if it has run out of batches
+  if (thread->idle)
+  {
+    {
+      lock_guard<mutex> lock(thread->mutex);
+    }
+    thread->condition.notify_all();
+  }
+}
+
+const list<Plugin*>& PluginPipeline::getPlugins() const
+{
+  return m_plugins;
+}
+
+unsigned PluginPipeline::getNumWorkers() const
+{
+  return m_rings.size();
+}
+
+void PluginPipeline::processBatches(AnalysisThread* thread) const
+{
+  while (true)
+  {
+    // Deliver every batch available in this thread's rings
+    size_t processed = 0;
+    for (auto ring : thread->rings)
+    {
+      size_t head = ring->head.load(memory_order_relaxed);
+      while (head != ring->tail.load(memory_order_acquire))
+      {
+        Batch* batch = ring->slots[head & (MAX_PENDING_BATCHES - 1)];
+        ring->head.store(++head, memory_order_release);
+
+        deliver(batch->data(), batch->size());
+        delete batch;
+        processed++;
+      }
+    }
+
+    if (processed)
+    {
+      // Wake anything waiting for the pipeline to drain
+      if ((thread->pending -= processed) == 0)
+      {
+        {
+          lock_guard<mutex> lock(thread->mutex);
+        }
+        thread->drained.notify_all();
+      }
+      continue;
+    }
+
+    // Sleep until a worker hands off another batch
+    unique_lock<mutex> lock(thread->mutex);
+    thread->idle = true;
+    thread->condition.wait(
+      lock, [thread] { return thread->finished || thread->pending > 0; });
+    thread->idle = false;
+    if (thread->finished && thread->pending == 0)
+      break;
+  }
+}
+
+void PluginPipeline::record(int worker, const PluginEvent& event)
+{
+  // Deliver events immediately if there are no analysis threads
+  if (m_threads.empty())
+  {
+    deliver(&event, 1);
+    return;
+  }
+
+  if (m_state.pipeline != m_id || !m_state.batch)
+  {
+    // Discard a batch left behind by a kernel that was aborted
+    if (m_state.pipeline != m_id)
+      delete m_state.batch;
+
+    m_state.pipeline = m_id;
+    m_state.worker = worker;
+    m_state.batch = new Batch;
+    m_state.batch->reserve(BATCH_SIZE);
+  }
+
+  m_state.batch->push_back(event);
+  if (m_state.batch->size() >= BATCH_SIZE)
+    flush();
+}
+
+void PluginPipeline::wait()
+{
+  // Wait for the analysis threads to process every batch handed off so far
+  for (auto thread : m_threads)
+  {
+    unique_lock<mutex> lock(thread->mutex);
+    thread->drained.wait(lock, [thread] { return thread->pending == 0; });
+  }
+
+  // Batches still held by workers belong to a kernel that was aborted
+  m_id = nextPipelineID++;
+}
@@ -0,0 +1,79 @@
+// PluginPipeline.h (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#pragma once
+
+#include "common.h"
+#include "Plugin.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace oclgrind
+{
+// Delivers events to decoupled plugins from a pool of analysis threads.
+// Each worker appends events to its own batch, and hands full batches to a
+// single-producer, single-consumer ring that is only read by the analysis
+// thread assigned to that worker. Events from a worker (and therefore from
+// a work-group) are delivered in order, and no locks are taken unless an
+// analysis thread is idle.
+class PluginPipeline
+{
+public:
+  PluginPipeline(const std::list<Plugin*>& plugins, unsigned numWorkers,
+                 unsigned numThreads);
+  virtual ~PluginPipeline();
+
+  void flush();
+  const std::list<Plugin*>& getPlugins() const;
+  unsigned getNumWorkers() const;
+  void record(int worker, const PluginEvent& event);
+  void wait();
+
+private:
+  typedef std::vector<PluginEvent> Batch;
+
+  std::list<Plugin*> m_plugins;
+  std::atomic<unsigned long> m_id;
+
+  // Batches handed off by one worker
+  struct BatchRing
+  {
+    Batch** slots;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+  };
+  std::vector<BatchRing*> m_rings;
+
+  struct AnalysisThread
+  {
+    std::thread thread;
+    std::vector<BatchRing*> rings;
+    std::atomic<size_t> pending;
+    std::atomic<bool> idle;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::condition_variable drained;
+    bool finished;
+  };
+  std::vector<AnalysisThread*> m_threads;
+
+  struct WorkerState
+  {
+    unsigned long pipeline;
+    int worker;
+    Batch* batch;
+  };
+  static THREAD_LOCAL WorkerState m_state;
+
+  void deliver(const PluginEvent* events, size_t num) const;
+  void processBatches(AnalysisThread* thread) const;
+};
+} // namespace oclgrind
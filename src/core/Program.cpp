@@ -25,7 +25,13 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Linker/Linker.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/IPO/AlwaysInliner.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Scalar/GVN.h"
+#include "llvm/Transforms/Utils.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 
 #if defined(_WIN32) && !defined(__MINGW32__)
@@ -41,6 +47,7 @@
 #include "WorkItem.h"
 
 #define ENV_DUMP_SPIR "OCLGRIND_DUMP_SPIR"
+#define ENV_INTERPRETER_OPT "OCLGRIND_INTERPRETER_OPT"
 #define CL_DUMP_NAME "/tmp/oclgrind_%lX.cl"
 #define IR_DUMP_NAME "/tmp/oclgrind_%lX.s"
 #define BC_DUMP_NAME "/tmp/oclgrind_%lX.bc"
@@ -65,6 +72,7 @@ const char* EXTENSIONS[] = {
   "cl_khr_int64_base_atomics",
   "cl_khr_int64_extended_atomics",
   "cl_khr_byte_addressable_store",
+  "cl_khr_subgroups",
 };
 
 #define OCLGRIND_BINARY_TYPE "oclgrind_binary_type"
@@ -74,6 +82,19 @@ using namespace std;
 
 namespace
 {
+// Check whether a function is a kernel generated for an enqueued block
+bool isBlockKernel(const llvm::Function* function)
+{
+  if (function->getCallingConv() != llvm::CallingConv::SPIR_KERNEL ||
+      function->arg_empty())
+    return false;
+
+  llvm::Type* type = function->getArg(0)->getType();
+  return type->isPointerTy() &&
+         type->getPointerAddressSpace() == AddrSpaceGeneric &&
+         function->getName().find("_block_invoke") != llvm::StringRef::npos;
+}
+
 void setBinaryType(llvm::Module& mod, cl_program_binary_type type)
 {
   llvm::LLVMContext& ctx = mod.getContext();
@@ -533,8 +554,16 @@ bool Program::build(BuildType buildType, const char* options,
     if (!checkEnv("OCLGRIND_INTERACTIVE"))
     {
       stripDebugIntrinsics();
+
+      // Run optional passes that reduce interpreter dispatch overhead
+      if (checkEnv(ENV_INTERPRETER_OPT))
+      {
+        optimizeForInterpreter();
+      }
     }
 
+    resolveGenericAddressSpaces();
+
     removeLValueLoads();
 
     allocateProgramScopeVars();
@@ -717,14 +746,7 @@ Kernel* Program::createKernel(const string name)
 
   try
   {
-    // Create cache if none already
-    InterpreterCacheMap::iterator itr = m_interpreterCache.find(function);
-    if (itr == m_interpreterCache.end())
-    {
-      m_interpreterCache[function] = new InterpreterCache(function);
-    }
-
-    return new Kernel(this, function, m_module.get());
+    return createKernel(function);
   }
   catch (FatalError& err)
   {
@@ -737,6 +759,19 @@ Kernel* Program::createKernel(const string name)
   }
 }
 
+Kernel* Program::createKernel(const llvm::Function* function) const
+{
+  // Create cache if none already
+  InterpreterCacheMap::iterator itr = m_interpreterCache.find(function);
+  if (itr == m_interpreterCache.end())
+  {
+    m_interpreterCache[function] =
+      new InterpreterCache((llvm::Function*)function);
+  }
+
+  return new Kernel(this, function, m_module.get());
+}
+
 void Program::deallocateProgramScopeVars()
 {
   for (auto psv = m_programScopeVars.begin(); psv != m_programScopeVars.end();
@@ -818,7 +853,8 @@ list<string> Program::getKernelNames() const
   list<string> names;
   for (auto F = m_module->begin(); F != m_module->end(); F++)
   {
-    if (F->getCallingConv() == llvm::CallingConv::SPIR_KERNEL)
+    if (F->getCallingConv() == llvm::CallingConv::SPIR_KERNEL &&
+        !isBlockKernel(&*F))
     {
       names.push_back(F->getName().str());
     }
@@ -838,7 +874,8 @@ unsigned int Program::getNumKernels() const
   unsigned int num = 0;
   for (auto F = m_module->begin(); F != m_module->end(); F++)
   {
-    if (F->getCallingConv() == llvm::CallingConv::SPIR_KERNEL)
+    if (F->getCallingConv() == llvm::CallingConv::SPIR_KERNEL &&
+        !isBlockKernel(&*F))
     {
       num++;
     }
@@ -879,6 +916,65 @@ unsigned long Program::getUID() const
   return m_uid;
 }
 
+void Program::optimizeForInterpreter()
+{
+  // Work-item functions return the same value every time a work-item calls
+  // them, so they can be treated as pure, non-convergent and speculatable.
+  // This allows LICM and GVN to hoist and merge calls to them.
+  static const set<string> invariantBuiltins = {
+    "get_global_id",
+    "get_global_offset",
+    "get_global_size",
+    "get_group_id",
+    "get_local_id",
+    "get_local_size",
+    "get_num_groups",
+    "get_work_dim",
+    "get_enqueued_num_sub_groups",
+    "get_max_sub_group_size",
+    "get_num_sub_groups",
+    "get_sub_group_id",
+    "get_sub_group_local_id",
+    "get_sub_group_size",
+  };
+  for (llvm::Module::iterator F = m_module->begin(); F != m_module->end(); F++)
+  {
+    if (!F->isDeclaration())
+      continue;
+
+    string name = getUnmangledName(F->getName().str());
+    if (!invariantBuiltins.count(name))
+      continue;
+
+    F->removeFnAttr(llvm::Attribute::Convergent);
+    F->setDoesNotAccessMemory();
+    F->setDoesNotThrow();
+    F->addFnAttr(llvm::Attribute::WillReturn);
+    F->addFnAttr(llvm::Attribute::Speculatable);
+
+    for (auto U = F->user_begin(); U != F->user_end(); U++)
+    {
+      if (auto call = llvm::dyn_cast<llvm::CallInst>(*U))
+      {
+        call->removeFnAttr(llvm::Attribute::Convergent);
+        call->setDoesNotAccessMemory();
+      }
+    }
+  }
+
+  // Passes chosen to reduce the number of instructions dispatched, rather
+  // than code size. All of these preserve or update debug locations.
+  llvm::legacy::PassManager passes;
+  passes.add(llvm::createEarlyCSEPass());
+  passes.add(llvm::createLoopSimplifyPass());
+  passes.add(llvm::createLICMPass());
+  passes.add(llvm::createInstructionCombiningPass());
+  passes.add(llvm::createGVNPass());
+  passes.add(llvm::createCFGSimplificationPass());
+  passes.add(llvm::createDeadCodeEliminationPass());
+  passes.run(*m_module);
+}
+
 void Program::pruneDeadCode(llvm::Instruction* instruction)
 {
   // Remove instructions that have no uses
@@ -929,6 +1025,59 @@ void Program::removeLValueLoads()
   }
 }
 
+void Program::resolveGenericAddressSpaces()
+{
+  // Kernels created for blocks enqueued from the device take a generic
+  // pointer to the block literal, which is always copied to global memory
+  bool hasBlockKernels = false;
+  for (auto F = m_module->begin(); F != m_module->end(); F++)
+  {
+    if (!isBlockKernel(&*F))
+      continue;
+
+    llvm::Argument* block = F->getArg(0);
+    llvm::Type* type = block->getType();
+
+    // Cast the block literal to a global pointer and back again, so that
+    // the address space can be propagated to its uses
+    llvm::Instruction* insertPt = &*F->getEntryBlock().getFirstInsertionPt();
+    llvm::Type* globalType =
+      type->getPointerElementType()->getPointerTo(AddrSpaceGlobal);
+    llvm::AddrSpaceCastInst* global =
+      new llvm::AddrSpaceCastInst(block, globalType, "", insertPt);
+    llvm::AddrSpaceCastInst* generic =
+      new llvm::AddrSpaceCastInst(global, type, "", insertPt);
+    block->replaceAllUsesWith(generic);
+    global->setOperand(0, block);
+
+    // Inline the block invoke function so that its loads are covered too
+    F->removeFnAttr(llvm::Attribute::OptimizeNone);
+    for (llvm::inst_iterator I = inst_begin(&*F), E = inst_end(&*F); I != E;
+         I++)
+    {
+      auto call = llvm::dyn_cast<llvm::CallInst>(&*I);
+      llvm::Function* callee = call ? call->getCalledFunction() : NULL;
+      if (!callee || callee->isDeclaration())
+        continue;
+
+      callee->removeFnAttr(llvm::Attribute::OptimizeNone);
+      callee->removeFnAttr(llvm::Attribute::NoInline);
+      callee->addFnAttr(llvm::Attribute::AlwaysInline);
+    }
+    hasBlockKernels = true;
+  }
+
+  if (!hasBlockKernels)
+    return;
+
+  // Rewrite the generic pointers to block literals, since the interpreter
+  // cannot access memory through them
+  llvm::legacy::PassManager passes;
+  passes.add(llvm::createAlwaysInlinerLegacyPass());
+  passes.add(llvm::createInferAddressSpacesPass(AddrSpaceGeneric));
+  passes.run(*m_module);
+}
+
 void Program::scalarizeAggregateStore(llvm::StoreInst* store)
 {
   llvm::IntegerType* gepIndexType =
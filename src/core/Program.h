@@ -49,6 +49,7 @@ public:
   bool build(BuildType buildType, const char* options,
              std::list<Header> headers = std::list<Header>());
   Kernel* createKernel(const std::string name);
+  Kernel* createKernel(const llvm::Function* function) const;
   const std::string& getBuildLog() const;
   const std::string& getBuildOptions() const;
   void getBinary(unsigned char* binary) const;
@@ -89,8 +90,10 @@ private:
 
   void allocateProgramScopeVars();
   void deallocateProgramScopeVars();
+  void optimizeForInterpreter();
   void pruneDeadCode(llvm::Instruction*);
   void removeLValueLoads();
+  void resolveGenericAddressSpaces();
   void scalarizeAggregateStore(llvm::StoreInst* store);
   void stripDebugIntrinsics();
 
@@ -10,6 +10,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <thread>
 
 #include "Context.h"
 #include "KernelInvocation.h"
@@ -22,6 +23,7 @@ using namespace std;
 Queue::Queue(const Context* context, bool out_of_order)
     : m_context(context), m_out_of_order(out_of_order)
 {
+  m_lastEndTime = 0;
 }
 
 Queue::~Queue() {}
@@ -39,6 +41,8 @@ Event* Queue::enqueue(Command* cmd)
   cmd->event = event;
   event->command = cmd;
   event->queue = this;
+
+  lock_guard<recursive_mutex> lock(m_mutex);
   m_queue.push_back(cmd);
   return event;
 }
@@ -99,13 +103,24 @@ void Queue::executeFillImage(FillImageCommand* cmd)
 
 void Queue::executeKernel(KernelCommand* cmd)
 {
+  // Kernel invocations in a context share its plugins and current kernel
+  // state, so only one kernel can run in each context at a time
+  lock_guard<mutex> lock(m_context->getKernelMutex());
+
   // Run kernel
-  KernelInvocation::run(m_context, cmd->kernel, cmd->work_dim,
-                        cmd->globalOffset, cmd->globalSize, cmd->localSize);
+  double deviceTime =
+    KernelInvocation::run(m_context, cmd->kernel, cmd->work_dim,
+                          cmd->globalOffset, cmd->globalSize, cmd->localSize);
+
+  // Report the estimated device time rather than the simulation time
+  if (deviceTime >= 0)
+    cmd->event->endTime = cmd->event->startTime + deviceTime;
 }
 
 void Queue::executeMap(MapCommand* cmd)
 {
+  m_context->getGlobalMemory()->addMapRegion(cmd->address, cmd->offset,
+                                             cmd->size, cmd->flags);
   m_context->notifyMemoryMap(m_context->getGlobalMemory(), cmd->address,
                              cmd->offset, cmd->size, cmd->flags);
 }
@@ -139,6 +154,7 @@ void Queue::executeReadBufferRect(BufferRectCommand* cmd)
 
 void Queue::executeUnmap(UnmapCommand* cmd)
 {
+  m_context->getGlobalMemory()->removeMapRegion(cmd->address, cmd->ptr);
   m_context->notifyMemoryUnmap(m_context->getGlobalMemory(), cmd->address,
                                cmd->ptr);
 }
@@ -168,24 +184,37 @@ void Queue::executeWriteBufferRect(BufferRectCommand* cmd)
 
 bool Queue::isEmpty() const
 {
+  lock_guard<recursive_mutex> lock(m_mutex);
   return m_queue.empty();
 }
 
-void Queue::execute(Command* command, bool flush)
+bool Queue::execute(Command* command, bool flush)
 {
-  // Find command in queue
-  auto it = std::find(m_queue.begin(), m_queue.end(), command);
-
-  // If there is a previous (older) command in the queue AND either the queue
-  // is not out of order OR needs to be flushed, then add event associated with
-  // previous (older) command as a dependency
-  if (it != m_queue.begin() && (!m_out_of_order || flush))
+  list<Command*>::iterator it;
   {
-    command->waitList.push_back((*std::prev(it))->event);
+    lock_guard<recursive_mutex> lock(m_mutex);
+
+    // Find command in queue and claim it, which will fail if it has already
+    // been executed or claimed by another thread
+    it = std::find(m_queue.begin(), m_queue.end(), command);
+    if (it == m_queue.end() || command->claimed)
+    {
+      return false;
+    }
+    command->claimed = true;
+
+    // If there is a previous (older) command in the queue AND either the
+    // queue is not out of order OR needs to be flushed, then add event
+    // associated with previous (older) command as a dependency
+    if (it != m_queue.begin() && (!m_out_of_order || flush))
+    {
+      command->waitList.push_back((*std::prev(it))->event);
+    }
   }
 
   // Make sure all events in the wait list are complete before executing
-  // current command
+  // current command. The queue lock is not held here, as dependencies may be
+  // on other queues that are being flushed by other threads.
   while (!command->waitList.empty())
   {
     Event* evt = command->waitList.front();
@@ -193,29 +222,37 @@ void Queue::execute(Command* command, bool flush)
 
     if (evt->state < 0)
     {
-      command->event->state = evt->state;
+      command->event->state = evt->state.load();
+      lock_guard<recursive_mutex> lock(m_mutex);
       m_queue.erase(it);
-      return;
+      return true;
     }
     else if (evt->state != CL_COMPLETE)
     {
-      if (evt->command)
+      // If it's not a user event, execute the associated command, taking
+      // ownership of it unless another thread got there first
+      if (evt->command && evt->queue->execute(evt->command, flush))
       {
-        // If it's not a user event, execute the associated command
-        evt->queue->execute(evt->command, flush);
         command->execBefore.push_front(evt->command);
       }
       else
       {
-        // If it's a user event then place it back at the of the wait list, and
-        // check it later
+        // User events and commands being executed by another thread are
+        // placed back at the end of the wait list, and checked later
         command->waitList.push_back(evt);
+        this_thread::yield();
       }
     }
   }
 
   // Dispatch command
-  command->event->startTime = now();
+  // Commands cannot start before the previous one has finished, which matters
+  // when their end times are estimates of the device time
+  double hostStartTime = now();
+  {
+    lock_guard<recursive_mutex> lock(m_mutex);
+    command->event->startTime = std::max(hostStartTime, m_lastEndTime);
+  }
   command->event->state = CL_RUNNING;
 
   switch (command->type)
@@ -262,24 +299,42 @@ void Queue::execute(Command* command, bool flush)
     assert(false && "Unhandled command type in queue.");
   }
 
-  command->event->endTime = now();
-  command->event->state = CL_COMPLETE;
+  if (!command->event->endTime)
+  {
+    command->event->endTime =
+      command->event->startTime + (now() - hostStartTime);
+  }
 
   // Remove command from its queue
+  lock_guard<recursive_mutex> lock(m_mutex);
+  m_lastEndTime = command->event->endTime;
+  command->event->state = CL_COMPLETE;
   m_queue.erase(it);
+
+  return true;
 }
 
 Command* Queue::finish()
 {
-  if (m_queue.empty())
+  while (true)
   {
-    return NULL;
-  }
-
-  // Get most recent command in queue and execute it, triggering the execution
-  // of all previous commands even if it's an out-of-order queue
-  Command* cmd = m_queue.back();
-  execute(cmd, true);
+    Command* cmd;
+    {
+      lock_guard<recursive_mutex> lock(m_mutex);
+      if (m_queue.empty())
+      {
+        return NULL;
+      }
+      cmd = m_queue.back();
+    }
 
-  return cmd;
+    // Execute the most recent command, triggering the execution of all
+    // previous commands even if it's an out-of-order queue. If another
+    // thread is already executing it, wait for it and try again.
+    if (execute(cmd, true))
+    {
+      return cmd;
+    }
+    this_thread::yield();
+  }
 }
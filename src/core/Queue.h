@@ -9,6 +9,9 @@
 #pragma once
 #include "common.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace oclgrind
 {
 class Context;
@@ -18,7 +21,7 @@ struct Command;
 
 struct Event
 {
-  int state;
+  std::atomic<int> state;
   double queueTime, startTime, endTime;
   Command* command;
   Queue* queue;
@@ -47,9 +50,22 @@ struct Command
   CommandType type;
   std::list<Event*> waitList;
   std::list<Command*> execBefore;
+
+  // Set once a thread has started executing the command
+  bool claimed;
+
+  // API objects retained by the runtime until the command completes
+  cl_event clEvent;
+  cl_kernel clKernel;
+  std::vector<cl_mem> clMemObjects;
+  std::vector<cl_event> clWaitList;
+
   Command()
   {
     type = EMPTY;
+    claimed = false;
+    clEvent = NULL;
+    clKernel = NULL;
   }
   virtual ~Command() {}
 
@@ -206,7 +222,7 @@ public:
   virtual ~Queue();
 
   Event* enqueue(Command* command);
-  void execute(Command* command, bool flush);
+  bool execute(Command* command, bool flush);
 
   void executeCopyBuffer(CopyCommand* cmd);
   void executeCopyBufferRect(CopyRectCommand* cmd);
@@ -228,5 +244,10 @@ private:
   const Context* m_context;
   const bool m_out_of_order;
   std::list<Command*> m_queue;
+  double m_lastEndTime;
+
+  // Guards the command list, so that a queue can be used from several host
+  // threads; recursive as in-order dependencies are executed by execute()
+  mutable std::recursive_mutex m_mutex;
 };
 } // namespace oclgrind
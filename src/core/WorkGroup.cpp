@@ -10,12 +10,14 @@
 
 #include <sstream>
 
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
 
 #include "Context.h"
 #include "Kernel.h"
 #include "KernelInvocation.h"
 #include "Memory.h"
+#include "Program.h"
 #include "WorkGroup.h"
 #include "WorkItem.h"
 
@@ -29,7 +31,8 @@ WorkGroup::WorkGroup(const KernelInvocation* kernelInvocation, Size3 wgid)
 
 WorkGroup::WorkGroup(const KernelInvocation* kernelInvocation, Size3 wgid,
                      Size3 size)
-    : m_context(kernelInvocation->getContext())
+    : m_context(kernelInvocation->getContext()),
+      m_kernelInvocation(kernelInvocation)
 {
   m_groupID = wgid;
   m_groupSize = size;
@@ -39,20 +42,15 @@ WorkGroup::WorkGroup(const KernelInvocation* kernelInvocation, Size3 wgid,
      (m_groupID.y + m_groupID.z * (kernelInvocation->getNumGroups().y) *
                       kernelInvocation->getNumGroups().x));
 
-  // Allocate local memory
-  m_localMemory =
-    new Memory(AddrSpaceLocal, sizeof(size_t) == 8 ? 16 : 8, m_context);
+  // Get local memory from the invocation's pool
+  m_localMemory = kernelInvocation->acquireLocalMemory();
   const Kernel* kernel = kernelInvocation->getKernel();
-  for (auto value = kernel->values_begin(); value != kernel->values_end();
-       value++)
-  {
-    const llvm::Type* type = value->first->getType();
-    if (type->isPointerTy() && type->getPointerAddressSpace() == AddrSpaceLocal)
-    {
-      size_t ptr = m_localMemory->allocateBuffer(value->second.size);
-      m_localAddresses[value->first] = ptr;
-    }
-  }
+
+  // Prepare store for work-group uniform values
+  const InterpreterCache* cache =
+    kernel->getProgram()->getInterpreterCache(kernel->getFunction());
+  TypedValue empty = {0, 0, NULL};
+  m_uniformValues.assign(cache->getNumUniformValues(), empty);
 
   // Initialise work-items
   for (size_t k = 0; k < m_groupSize.z; k++)
@@ -81,7 +79,7 @@ WorkGroup::~WorkGroup()
     delete m_workItems[i];
   }
 
-  delete m_localMemory;
+  m_kernelInvocation->releaseLocalMemory(m_localMemory);
 }
 
 size_t WorkGroup::async_copy(const WorkItem* workItem,
@@ -90,28 +88,26 @@ size_t WorkGroup::async_copy(const WorkItem* workItem,
                              size_t size, size_t num, size_t srcStride,
                              size_t destStride, size_t event)
 {
-  AsyncCopy copy = {instruction, type, dest,      src,
-                    size,        num,  srcStride, destStride,
+  size_t index = getLocalLinearID(workItem);
 
-                    event};
+  // Find copy corresponding to this execution of the instruction
+  vector<size_t>& counts = m_asyncCopyCounts[instruction];
+  if (counts.empty())
+  {
+    counts.resize(m_workItems.size(), 0);
+  }
+  AsyncCopyKey key(instruction, counts[index]++);
 
-  // Check if copy has already been registered by another work-item
-  list<pair<AsyncCopy, set<const WorkItem*>>>::iterator itr;
-  for (itr = m_asyncCopies.begin(); itr != m_asyncCopies.end(); itr++)
+  auto itr = m_asyncCopies.find(key);
+  if (itr != m_asyncCopies.end())
   {
-    if (itr->second.count(workItem))
-    {
-      continue;
-    }
+    // Copy has already been registered by another work-item
+    AsyncCopy& copy = itr->second;
 
     // Check for divergence
-    if ((itr->first.instruction->getDebugLoc() !=
-         copy.instruction->getDebugLoc()) ||
-        (itr->first.type != copy.type) || (itr->first.dest != copy.dest) ||
-        (itr->first.src != copy.src) || (itr->first.size != copy.size) ||
-        (itr->first.num != copy.num) ||
-        (itr->first.srcStride != copy.srcStride) ||
-        (itr->first.destStride != copy.destStride))
+    if ((copy.type != type) || (copy.dest != dest) || (copy.src != src) ||
+        (copy.size != size) || (copy.num != num) ||
+        (copy.srcStride != srcStride) || (copy.destStride != destStride))
     {
       Context::Message msg(ERROR, m_context);
       msg << "Work-group divergence detected (async copy)" << endl
@@ -120,49 +116,79 @@ size_t WorkGroup::async_copy(const WorkItem* workItem,
           << endl
           << "Work-item:  " << msg.CURRENT_ENTITY << endl
           << msg.CURRENT_LOCATION << endl
+          << "dest=0x" << hex << dest << ", "
+          << "src=0x" << hex << src << endl
+          << "elem_size=" << dec << size << ", "
+          << "num_elems=" << dec << num << ", "
+          << "src_stride=" << dec << srcStride << ", "
+          << "dest_stride=" << dec << destStride << endl
+          << endl
+          << "Previous work-items executed:" << endl
+          << copy.instruction << endl
           << "dest=0x" << hex << copy.dest << ", "
           << "src=0x" << hex << copy.src << endl
           << "elem_size=" << dec << copy.size << ", "
           << "num_elems=" << dec << copy.num << ", "
           << "src_stride=" << dec << copy.srcStride << ", "
-          << "dest_stride=" << dec << copy.destStride << endl
-          << endl
-          << "Previous work-items executed:" << endl
-          << itr->first.instruction << endl
-          << "dest=0x" << hex << itr->first.dest << ", "
-          << "src=0x" << hex << itr->first.src << endl
-          << "elem_size=" << dec << itr->first.size << ", "
-          << "num_elems=" << dec << itr->first.num << ", "
-          << "src_stride=" << dec << itr->first.srcStride << ", "
-          << "dest_stride=" << dec << itr->first.destStride << endl;
+          << "dest_stride=" << dec << copy.destStride << endl;
       msg.send();
     }
 
-    itr->second.insert(workItem);
-    return itr->first.event;
+    copy.numArrived++;
+    return copy.event;
   }
 
   // Create new event if necessary
-  if (copy.event == 0)
+  if (event == 0)
   {
-    copy.event = m_nextEvent++;
+    event = m_nextEvent++;
   }
 
   // Register new copy and event
-  m_asyncCopies.push_back(make_pair(copy, set<const WorkItem*>()));
-  m_asyncCopies.back().second.insert(workItem);
-  if (!m_events.count(event))
-  {
-    m_events[copy.event] = list<AsyncCopy>();
-  }
-  m_events[copy.event].push_back(copy);
-
-  return copy.event;
+  AsyncCopy& copy = m_asyncCopies[key];
+  copy.instruction = instruction;
+  copy.type = type;
+  copy.dest = dest;
+  copy.src = src;
+  copy.size = size;
+  copy.num = num;
+  copy.srcStride = srcStride;
+  copy.destStride = destStride;
+  copy.event = event;
+  copy.numArrived = 1;
+  m_events[event].push_back(key);
+
+  return event;
 }
 
 void WorkGroup::clearBarrier()
 {
-  assert(m_barrier);
+  assert(m_barrier || !m_collectives.empty());
+
+  // Work-items can only be left waiting in a collective function if some of
+  // the work-items in their group never reached it
+  for (auto itr = m_collectives.begin(); itr != m_collectives.end(); itr++)
+  {
+    Collective& collective = itr->second;
+
+    Context::Message msg(ERROR, m_context);
+    msg << "Work-group divergence detected (collective function)" << endl
+        << msg.INDENT << "Kernel:     " << msg.CURRENT_KERNEL << endl
+        << "Work-group: " << msg.CURRENT_WORK_GROUP << endl
+        << "Only " << dec << collective.numArrived << " out of "
+        << collective.workItems.size() << " work-items executed "
+        << collective.name << endl
+        << (const llvm::Instruction*)collective.instruction << endl;
+    msg.send();
+
+    completeCollective(collective);
+  }
+  m_collectives.clear();
+
+  if (!m_barrier)
+  {
+    return;
+  }
 
   // Check for divergence
   if (m_barrier->workItems.size() != m_workItems.size())
@@ -192,62 +218,35 @@ void WorkGroup::clearBarrier()
   {
     size_t event = m_barrier->events.front();
 
-    // Perform copy
-    list<AsyncCopy> copies = m_events[event];
-    list<AsyncCopy>::iterator itr;
-    for (itr = copies.begin(); itr != copies.end(); itr++)
+    // Perform copies for this event
+    auto eItr = m_events.find(event);
+    if (eItr != m_events.end())
     {
-      Memory *destMem, *srcMem;
-      if (itr->type == GLOBAL_TO_LOCAL)
-      {
-        destMem = m_localMemory;
-        srcMem = m_context->getGlobalMemory();
-      }
-      else
+      for (auto key = eItr->second.begin(); key != eItr->second.end(); key++)
       {
-        destMem = m_context->getGlobalMemory();
-        srcMem = m_localMemory;
+        performAsyncCopy(m_asyncCopies.at(*key));
       }
 
-      size_t src = itr->src;
-      size_t dest = itr->dest;
-      unsigned char* buffer = new unsigned char[itr->size];
-      for (unsigned i = 0; i < itr->num; i++)
+      // Check that all work-items registered the copies
+      for (auto key = eItr->second.begin(); key != eItr->second.end(); key++)
       {
-        srcMem->load(buffer, src, itr->size);
-        destMem->store(buffer, dest, itr->size);
-        src += itr->srcStride * itr->size;
-        dest += itr->destStride * itr->size;
-      }
-      delete[] buffer;
-    }
-    m_events.erase(event);
-
-    // Remove copies from list for this event
-    list<pair<AsyncCopy, set<const WorkItem*>>>::iterator cItr;
-    for (cItr = m_asyncCopies.begin(); cItr != m_asyncCopies.end();)
-    {
-      if (cItr->first.event == event)
-      {
-        // Check that all work-items registered the copy
-        if (cItr->second.size() != m_workItems.size())
+        auto cItr = m_asyncCopies.find(*key);
+        const AsyncCopy& copy = cItr->second;
+        if (copy.numArrived != m_workItems.size())
         {
           Context::Message msg(ERROR, m_context);
           msg << "Work-group divergence detected (async copy)" << endl
               << msg.INDENT << "Kernel:     " << msg.CURRENT_KERNEL << endl
               << "Work-group: " << msg.CURRENT_WORK_GROUP << endl
-              << "Only " << dec << cItr->second.size() << " out of "
+              << "Only " << dec << copy.numArrived << " out of "
               << m_workItems.size() << " work-items executed copy" << endl
-              << cItr->first.instruction << endl;
+              << copy.instruction << endl;
           msg.send();
         }
 
-        cItr = m_asyncCopies.erase(cItr);
-      }
-      else
-      {
-        cItr++;
+        m_asyncCopies.erase(cItr);
       }
+      m_events.erase(eItr);
     }
 
     m_barrier->events.remove(event);
@@ -259,6 +258,26 @@ void WorkGroup::clearBarrier()
   m_barrier = NULL;
 }
 
+void WorkGroup::completeCollective(Collective& collective)
+{
+  // Compute results for the whole group at once
+  collective.function(collective.instruction, collective.name,
+                      collective.overload, collective.workItems,
+                      collective.results);
+
+  // Resume work-items
+  for (size_t lane = 0; lane < collective.workItems.size(); lane++)
+  {
+    WorkItem* workItem = collective.workItems[lane];
+    if (workItem)
+    {
+      workItem->completeCollective(collective.instruction,
+                                   collective.results[lane]);
+      m_running.insert(workItem);
+    }
+  }
+}
+
 const llvm::Instruction* WorkGroup::getCurrentBarrier() const
 {
   return m_barrier ? m_barrier->instruction : NULL;
@@ -279,6 +298,17 @@ Size3 WorkGroup::getGroupSize() const
   return m_groupSize;
 }
 
+size_t WorkGroup::getLocalLinearID(const WorkItem* workItem) const
+{
+  Size3 lid = workItem->getLocalID();
+  return lid.x + (lid.y + lid.z * m_groupSize.y) * m_groupSize.x;
+}
+
+size_t WorkGroup::getLocalLinearSize() const
+{
+  return m_groupSize.x * m_groupSize.y * m_groupSize.z;
+}
+
 Memory* WorkGroup::getLocalMemory() const
 {
   return m_localMemory;
@@ -286,7 +316,76 @@ Memory* WorkGroup::getLocalMemory() const
 
 size_t WorkGroup::getLocalMemoryAddress(const llvm::Value* value) const
 {
-  return m_localAddresses.at(value);
+  return m_kernelInvocation->getLocalMemoryAddress(value);
+}
+
+size_t WorkGroup::getNumSubGroups() const
+{
+  return (getLocalLinearSize() + SUB_GROUP_SIZE - 1) / SUB_GROUP_SIZE;
+}
+
+size_t WorkGroup::getSubGroupSize(size_t subGroupID) const
+{
+  return min<size_t>(SUB_GROUP_SIZE,
+                     getLocalLinearSize() - subGroupID * SUB_GROUP_SIZE);
+}
+
+void WorkGroup::performAsyncCopy(const AsyncCopy& copy)
+{
+  Memory *destMem, *srcMem;
+  if (copy.type == GLOBAL_TO_LOCAL)
+  {
+    destMem = m_localMemory;
+    srcMem = m_context->getGlobalMemory();
+  }
+  else
+  {
+    destMem = m_context->getGlobalMemory();
+    srcMem = m_localMemory;
+  }
+
+  // Use a single bulk transfer for each contiguous side of the copy, and
+  // fall back to per-element accesses for strided or invalid ranges so
+  // that errors are reported for individual elements
+  size_t total = copy.size * copy.num;
+  bool bulkLoad =
+    copy.srcStride == 1 && srcMem->isAddressValid(copy.src, total);
+  bool bulkStore =
+    copy.destStride == 1 && destMem->isAddressValid(copy.dest, total);
+
+  unsigned char* buffer = new unsigned char[total];
+  if (bulkLoad)
+  {
+    srcMem->load(buffer, copy.src, total);
+  }
+  else
+  {
+    size_t src = copy.src;
+    for (unsigned i = 0; i < copy.num; i++)
+    {
+      srcMem->load(buffer + i * copy.size, src, copy.size);
+      src += copy.srcStride * copy.size;
+    }
+  }
+  if (bulkStore)
+  {
+    destMem->store(buffer, copy.dest, total);
+  }
+  else
+  {
+    size_t dest = copy.dest;
+    for (unsigned i = 0; i < copy.num; i++)
+    {
+      destMem->store(buffer + i * copy.size, dest, copy.size);
+      dest += copy.destStride * copy.size;
+    }
+  }
+  delete[] buffer;
+}
+
+TypedValue WorkGroup::getUniformValue(unsigned id) const
+{
+  return m_uniformValues[id];
 }
 
 WorkItem* WorkGroup::getNextWorkItem() const
@@ -306,7 +405,7 @@ WorkItem* WorkGroup::getWorkItem(Size3 localID) const
 
 bool WorkGroup::hasBarrier() const
 {
-  return m_barrier;
+  return m_barrier || !m_collectives.empty();
 }
 
 void WorkGroup::notifyBarrier(WorkItem* workItem,
@@ -398,6 +497,56 @@ void WorkGroup::notifyBarrier(WorkItem* workItem,
 
   m_running.erase(workItem);
   m_barrier->workItems.insert(workItem);
+
+  // Suspend work-item until the barrier is cleared when running on a fiber
+  m_kernelInvocation->suspendWorkItem();
+}
+
+void WorkGroup::notifyCollective(WorkItem* workItem,
+                                 const llvm::CallInst* callInst, bool subGroup,
+                                 CollectiveFunction function,
+                                 const string& name, const string& overload,
+                                 TypedValue result)
+{
+  // Find the lane of the work-item within its group
+  size_t lane = getLocalLinearID(workItem);
+  size_t group = SIZE_MAX;
+  size_t numLanes = getLocalLinearSize();
+  if (subGroup)
+  {
+    group = lane / SUB_GROUP_SIZE;
+    lane = lane % SUB_GROUP_SIZE;
+    numLanes = getSubGroupSize(group);
+  }
+
+  CollectiveKey key(callInst, group);
+  Collective& collective = m_collectives[key];
+  if (collective.workItems.empty())
+  {
+    collective.instruction = callInst;
+    collective.function = function;
+    collective.name = name;
+    collective.overload = overload;
+    collective.workItems.resize(numLanes, NULL);
+    collective.results.resize(numLanes);
+    collective.numArrived = 0;
+  }
+  collective.workItems[lane] = workItem;
+  collective.results[lane] = result;
+  collective.numArrived++;
+
+  if (collective.numArrived == numLanes)
+  {
+    // Last work-item to arrive computes the results for the whole group
+    completeCollective(collective);
+    m_collectives.erase(key);
+  }
+  else
+  {
+    // Wait for the rest of the group
+    m_running.erase(workItem);
+    m_kernelInvocation->suspendWorkItem();
+  }
 }
 
 void WorkGroup::notifyFinished(WorkItem* workItem)
@@ -411,6 +560,17 @@ void WorkGroup::notifyFinished(WorkItem* workItem)
   }
 }
 
+void WorkGroup::setUniformValue(unsigned id, TypedValue value)
+{
+  m_uniformValues[id] = value;
+}
+
+size_t WorkGroup::AsyncCopyKeyHash::operator()(const AsyncCopyKey& key) const
+{
+  return hash<const llvm::Instruction*>()(key.first) ^
+         (hash<size_t>()(key.second) << 1);
+}
+
 bool WorkGroup::WorkItemCmp::operator()(const WorkItem* lhs,
                                         const WorkItem* rhs) const
 {
@@ -11,6 +11,11 @@
 #define CLK_LOCAL_MEM_FENCE (1 << 0)
 #define CLK_GLOBAL_MEM_FENCE (1 << 1)
 
+namespace llvm
+{
+class CallInst;
+} // namespace llvm
+
 namespace oclgrind
 {
 class Context;
@@ -28,6 +33,14 @@ public:
     LOCAL_TO_GLOBAL
   };
 
+  // Computes the result of a collective function for every participating
+  // work-item at once, given the work-items in lane order
+  typedef void (*CollectiveFunction)(const llvm::CallInst* callInst,
+                                     const std::string& name,
+                                     const std::string& overload,
+                                     const std::vector<WorkItem*>& workItems,
+                                     const std::vector<TypedValue>& results);
+
 private:
   // Comparator for ordering work-items
   struct WorkItemCmp
@@ -48,8 +61,36 @@ private:
     size_t destStride;
 
     size_t event;
+
+    // Number of work-items that have registered the copy
+    size_t numArrived;
   };
 
+  // Async copies are identified by the instruction and the number of times
+  // each work-item has previously executed that instruction
+  typedef std::pair<const llvm::Instruction*, size_t> AsyncCopyKey;
+  struct AsyncCopyKeyHash
+  {
+    size_t operator()(const AsyncCopyKey& key) const;
+  };
+
+  struct Collective
+  {
+    const llvm::CallInst* instruction;
+    CollectiveFunction function;
+    std::string name;
+    std::string overload;
+
+    // Participating work-items and their result values, indexed by lane
+    std::vector<WorkItem*> workItems;
+    std::vector<TypedValue> results;
+    size_t numArrived;
+  };
+
+  // Collectives are identified by the instruction and the sub-group that
+  // executed it (or SIZE_MAX for work-group collectives)
+  typedef std::pair<const llvm::Instruction*, size_t> CollectiveKey;
+
   struct Barrier
   {
     const llvm::Instruction* instruction;
@@ -73,15 +114,25 @@ public:
   Size3 getGroupID() const;
   size_t getGroupIndex() const;
   Size3 getGroupSize() const;
+  size_t getLocalLinearID(const WorkItem* workItem) const;
+  size_t getLocalLinearSize() const;
   Memory* getLocalMemory() const;
   size_t getLocalMemoryAddress(const llvm::Value* value) const;
+  size_t getNumSubGroups() const;
+  size_t getSubGroupSize(size_t subGroupID) const;
+  TypedValue getUniformValue(unsigned id) const;
   WorkItem* getNextWorkItem() const;
   WorkItem* getWorkItem(Size3 localID) const;
   bool hasBarrier() const;
   void notifyBarrier(WorkItem* workItem, const llvm::Instruction* instruction,
                      uint64_t fence,
                      std::list<size_t> events = std::list<size_t>());
+  void notifyCollective(WorkItem* workItem, const llvm::CallInst* callInst,
+                        bool subGroup, CollectiveFunction function,
+                        const std::string& name, const std::string& overload,
+                        TypedValue result);
   void notifyFinished(WorkItem* workItem);
+  void setUniformValue(unsigned id, TypedValue value);
 
 private:
   size_t m_groupIndex;
@@ -89,14 +140,25 @@ private:
   Size3 m_groupSize;
   const Context* m_context;
 
+  const KernelInvocation* m_kernelInvocation;
   Memory* m_localMemory;
-  std::map<const llvm::Value*, size_t> m_localAddresses;
 
   std::vector<WorkItem*> m_workItems;
 
+  // Results of work-group uniform instructions, shared by all work-items
+  std::vector<TypedValue> m_uniformValues;
+
   Barrier* m_barrier;
   size_t m_nextEvent;
-  std::list<std::pair<AsyncCopy, std::set<const WorkItem*>>> m_asyncCopies;
-  std::map<size_t, std::list<AsyncCopy>> m_events;
+  std::unordered_map<AsyncCopyKey, AsyncCopy, AsyncCopyKeyHash>
+    m_asyncCopies;
+  std::unordered_map<const llvm::Instruction*, std::vector<size_t>>
+    m_asyncCopyCounts;
+  std::unordered_map<size_t, std::vector<AsyncCopyKey>> m_events;
+
+  std::map<CollectiveKey, Collective> m_collectives;
+
+  void completeCollective(Collective& collective);
+  void performAsyncCopy(const AsyncCopy& copy);
 };
 } // namespace oclgrind
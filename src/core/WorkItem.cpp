@@ -102,6 +102,7 @@ WorkItem::WorkItem(const KernelInvocation* kernelInvocation,
 
   // Initialize interpreter state
   m_state = READY;
+  m_collectivePending = false;
   m_position = new Position;
   m_position->hasBegun = false;
   m_position->prevBlock = NULL;
@@ -124,6 +125,20 @@ void WorkItem::clearBarrier()
   }
 }
 
+void WorkItem::completeCollective(const llvm::Instruction* instruction,
+                                  const TypedValue& result)
+{
+  // Report a collective that was left waiting for the rest of its group now
+  // that its result has been computed
+  if (m_collectivePending)
+  {
+    m_collectivePending = false;
+    m_context->notifyInstructionExecuted(this, instruction, result);
+  }
+
+  clearBarrier();
+}
+
 void WorkItem::dispatch(const llvm::Instruction* instruction,
                         TypedValue& result)
 {
@@ -132,6 +147,9 @@ void WorkItem::dispatch(const llvm::Instruction* instruction,
   case llvm::Instruction::Add:
     add(instruction, result);
     break;
+  case llvm::Instruction::AddrSpaceCast:
+    bitcast(instruction, result);
+    break;
   case llvm::Instruction::Alloca:
     alloc(instruction, result);
     break;
@@ -285,15 +303,7 @@ void WorkItem::dispatch(const llvm::Instruction* instruction,
 
 void WorkItem::execute(const llvm::Instruction* instruction)
 {
-  // Prepare private variable for instruction result
-  pair<unsigned, unsigned> resultSize = getValueSize(instruction);
-
-  // Prepare result
-  TypedValue result = {resultSize.first, resultSize.second, NULL};
-  if (result.size)
-  {
-    result.data = m_pool.alloc(result.size * result.num);
-  }
+  unsigned valueID = m_cache->getValueID(instruction);
 
   if (instruction->getOpcode() != llvm::Instruction::PHI &&
       m_phiTemps.size() > 0)
@@ -306,6 +316,30 @@ void WorkItem::execute(const llvm::Instruction* instruction)
     m_phiTemps.clear();
   }
 
+  // Reuse result if another work-item has already executed this
+  // work-group uniform instruction
+  int uniformID = m_cache->getUniformID(valueID);
+  if (uniformID >= 0)
+  {
+    TypedValue result = m_workGroup->getUniformValue(uniformID);
+    if (result.data)
+    {
+      m_values[valueID] = result;
+      m_context->notifyInstructionExecuted(this, instruction, result);
+      return;
+    }
+  }
+
+  // Prepare private variable for instruction result
+  pair<unsigned, unsigned> resultSize = m_cache->getValueSize(valueID);
+
+  // Prepare result
+  TypedValue result = {resultSize.first, resultSize.second, NULL};
+  if (result.size)
+  {
+    result.data = m_pool.alloc(result.size * result.num);
+  }
+
   // Execute instruction
   dispatch(instruction, result);
 
@@ -314,7 +348,7 @@ void WorkItem::execute(const llvm::Instruction* instruction)
   {
     if (instruction->getOpcode() != llvm::Instruction::PHI)
     {
-      setValue(instruction, result);
+      m_values[valueID] = result;
     }
     else
     {
@@ -322,7 +356,15 @@ void WorkItem::execute(const llvm::Instruction* instruction)
     }
   }
 
-  m_context->notifyInstructionExecuted(this, instruction, result);
+  if (uniformID >= 0)
+  {
+    m_workGroup->setUniformValue(uniformID, result);
+  }
+
+  // Collectives still waiting for the rest of their group are reported when
+  // they complete, since their result has not been computed yet
+  if (!m_collectivePending)
+    m_context->notifyInstructionExecuted(this, instruction, result);
 }
 
 const stack<const llvm::Instruction*>& WorkItem::getCallStack() const
@@ -350,6 +392,11 @@ size_t WorkItem::getGlobalIndex() const
   return m_globalIndex;
 }
 
+const InterpreterCache* WorkItem::getInterpreterCache() const
+{
+  return m_cache;
+}
+
 Size3 WorkItem::getLocalID() const
 {
   return m_localID;
@@ -394,7 +441,8 @@ TypedValue WorkItem::getOperand(const llvm::Value* operand) const
     return result;
   }
   else if (llvm::isa<llvm::ConstantAggregate>(operand) ||
-           llvm::isa<llvm::ConstantData>(operand))
+           llvm::isa<llvm::ConstantData>(operand) ||
+           llvm::isa<llvm::Function>(operand))
   {
     return m_cache->getConstant(operand);
   }
@@ -586,7 +634,7 @@ void WorkItem::printExpression(string expr) const
 
       // Check address is valid
       auto elemType = type->getPointerElementType();
-      size_t elemSize = getTypeSize(elemType);
+      size_t elemSize = m_cache->getTypeSize(elemType);
       if (!memory->isAddressValid(address + subscript * elemSize, elemSize))
       {
         cout << "invalid memory address";
@@ -735,7 +783,7 @@ INSTRUCTION(alloc)
   const llvm::Type* type = allocInst->getAllocatedType();
 
   // Perform allocation
-  unsigned size = getTypeSize(type);
+  unsigned size = m_cache->getTypeSize(type);
   size_t address = m_privateMemory->allocateBuffer(size);
   if (!address)
     FATAL_ERROR("Insufficient private memory (alloca)");
@@ -849,7 +897,8 @@ INSTRUCTION(call)
       {
         // Make new copy of value in private memory
         void* data = m_privateMemory->getPointer(value.getPointer());
-        size_t size = getTypeSize(argItr->getType()->getPointerElementType());
+        size_t size =
+          m_cache->getTypeSize(argItr->getType()->getPointerElementType());
         size_t ptr = m_privateMemory->allocateBuffer(size, 0, (uint8_t*)data);
         m_position->allocations.top().push_back(ptr);
 
@@ -897,12 +946,12 @@ INSTRUCTION(extractval)
     if (type->isArrayTy())
     {
       type = type->getArrayElementType();
-      offset += getTypeSize(type) * indices[i];
+      offset += m_cache->getTypeSize(type) * indices[i];
     }
     else if (type->isStructTy())
     {
-      offset +=
-        getStructMemberOffset((const llvm::StructType*)type, indices[i]);
+      offset += m_cache->getStructMemberOffset((const llvm::StructType*)type,
+                                               indices[i]);
       type = type->getStructElementType(indices[i]);
     }
     else
@@ -912,7 +961,8 @@ INSTRUCTION(extractval)
   }
 
   // Copy target value to result
-  memcpy(result.data, getOperand(agg).data + offset, getTypeSize(type));
+  memcpy(result.data, getOperand(agg).data + offset,
+         m_cache->getTypeSize(type));
 }
 
 INSTRUCTION(fadd)
@@ -1077,20 +1127,19 @@ INSTRUCTION(gep)
 {
   const llvm::GetElementPtrInst* gepInst =
     (const llvm::GetElementPtrInst*)instruction;
+  const InterpreterCache::GEPInfo& gep = m_cache->getGEP(instruction);
 
-  // Get base address
-  size_t base = getOperand(gepInst->getPointerOperand()).getPointer();
-  const llvm::Type* ptrType = gepInst->getPointerOperandType();
+  // Get base address and apply constant offset
+  size_t address = getOperand(gepInst->getPointerOperand()).getPointer();
+  address += gep.offset;
 
-  // Get indices
-  std::vector<int64_t> offsets;
-  llvm::User::const_op_iterator opItr;
-  for (opItr = gepInst->idx_begin(); opItr != gepInst->idx_end(); opItr++)
+  // Apply variable indices
+  for (auto& stride : gep.strides)
   {
-    offsets.push_back(getOperand(opItr->get()).getSInt());
+    address += getOperand(stride.first).getSInt() * stride.second;
   }
 
-  result.setPointer(resolveGEP(base, ptrType, offsets));
+  result.setPointer(address);
 }
 
 INSTRUCTION(icmp)
@@ -1178,12 +1227,12 @@ INSTRUCTION(insertval)
     if (type->isArrayTy())
     {
       type = type->getArrayElementType();
-      offset += getTypeSize(type) * indices[i];
+      offset += m_cache->getTypeSize(type) * indices[i];
     }
     else if (type->isStructTy())
     {
-      offset +=
-        getStructMemberOffset((const llvm::StructType*)type, indices[i]);
+      offset += m_cache->getStructMemberOffset((const llvm::StructType*)type,
+                                               indices[i]);
       type = type->getStructElementType(indices[i]);
     }
     else
@@ -1195,7 +1244,7 @@ INSTRUCTION(insertval)
   // Copy inserted value into result
   const llvm::Value* value = insert->getInsertedValueOperand();
   memcpy(result.data + offset, getOperand(value).data,
-         getTypeSize(value->getType()));
+         m_cache->getTypeSize(value->getType()));
 }
 
 INSTRUCTION(inttoptr)
@@ -1226,7 +1275,8 @@ INSTRUCTION(load)
   // Check address is correctly aligned
   unsigned alignment = loadInst->getAlignment();
   if (!alignment)
-    alignment = getTypeAlignment(opPtr->getType()->getPointerElementType());
+    alignment =
+      m_cache->getTypeAlignment(opPtr->getType()->getPointerElementType());
   if (address & (alignment - 1))
   {
     m_context->logError("Invalid memory load - source pointer is "
@@ -1443,7 +1493,8 @@ INSTRUCTION(store)
   // Check address is correctly aligned
   unsigned alignment = storeInst->getAlignment();
   if (!alignment)
-    alignment = getTypeAlignment(opPtr->getType()->getPointerElementType());
+    alignment =
+      m_cache->getTypeAlignment(opPtr->getType()->getPointerElementType());
   if (address & (alignment - 1))
   {
     m_context->logError("Invalid memory store - source pointer is "
@@ -1544,8 +1595,35 @@ INSTRUCTION(freeze)
 // WorkItem::InterpreterCache //
 ////////////////////////////////
 
+// Append the offset and size of each non-struct member of a struct
+static void flattenStruct(const llvm::StructType* type, unsigned offset,
+                          vector<pair<unsigned, unsigned>>& scalars)
+{
+  if (type->isPacked())
+  {
+    scalars.push_back(make_pair(offset, getTypeSize(type)));
+    return;
+  }
+
+  for (unsigned i = 0; i < type->getNumElements(); i++)
+  {
+    const llvm::Type* elemType = type->getElementType(i);
+    unsigned elemOffset = offset + getStructMemberOffset(type, i);
+    if (auto structType = llvm::dyn_cast<llvm::StructType>(elemType))
+    {
+      flattenStruct(structType, elemOffset, scalars);
+    }
+    else
+    {
+      scalars.push_back(make_pair(elemOffset, getTypeSize(elemType)));
+    }
+  }
+}
+
 InterpreterCache::InterpreterCache(llvm::Function* kernel)
 {
+  m_numUniformValues = 0;
+
   // TODO: Determine this number dynamically?
   m_valueIDs.reserve(1024);
 
@@ -1583,6 +1661,12 @@ InterpreterCache::InterpreterCache(llvm::Function* kernel)
     {
       addValueID(&*I);
 
+      // Pre-compute GEP offsets and strides
+      if (I->getOpcode() == llvm::Instruction::GetElementPtr)
+      {
+        addGEP(&*I);
+      }
+
       // Check for function calls
       if (I->getOpcode() == llvm::Instruction::Call)
       {
@@ -1609,6 +1693,8 @@ InterpreterCache::InterpreterCache(llvm::Function* kernel)
       }
     }
   }
+
+  analyzeUniformity(kernel, processed);
 }
 
 InterpreterCache::~InterpreterCache()
@@ -1653,6 +1739,20 @@ void InterpreterCache::addBuiltin(const llvm::Function* function)
     overload = "";
   }
 
+  // Check for builtins that are specialised for this overload
+  BuiltinSpecializerList::iterator sItr;
+  for (sItr = workItemBuiltinSpecializers.begin();
+       sItr != workItemBuiltinSpecializers.end(); sItr++)
+  {
+    if (name.compare(0, sItr->first.length(), sItr->first) == 0)
+    {
+      const InterpreterCache::Builtin builtin = {sItr->second(name, overload),
+                                                 name, overload};
+      m_builtins[function] = builtin;
+      return;
+    }
+  }
+
   // Find builtin function in map
   BuiltinFunctionMap::iterator bItr = workItemBuiltins.find(name);
   if (bItr != workItemBuiltins.end())
@@ -1696,7 +1796,7 @@ void InterpreterCache::addConstant(const llvm::Value* value)
   }
 
   // Create constant and add to cache
-  pair<unsigned, unsigned> size = getValueSize(value);
+  pair<unsigned, unsigned> size = oclgrind::getValueSize(value);
   TypedValue constant;
   constant.size = size.first;
   constant.num = size.second;
@@ -1727,6 +1827,113 @@ InterpreterCache::getConstantExpr(const llvm::Value* expr) const
   return itr->second;
 }
 
+void InterpreterCache::addGEP(const llvm::Instruction* instruction)
+{
+  const llvm::GetElementPtrInst* gepInst =
+    (const llvm::GetElementPtrInst*)instruction;
+
+  GEPInfo gep;
+  gep.offset = 0;
+
+  // Walk the indexed types once, folding constant indices into the offset
+  const llvm::Type* type = gepInst->getPointerOperandType();
+  llvm::User::const_op_iterator opItr;
+  for (opItr = gepInst->idx_begin(); opItr != gepInst->idx_end(); opItr++)
+  {
+    const llvm::Value* index = opItr->get();
+    const llvm::ConstantInt* constIndex =
+      llvm::dyn_cast<llvm::ConstantInt>(index);
+
+    if (type->isStructTy())
+    {
+      // Struct indices are always constant
+      unsigned member = constIndex->getZExtValue();
+      gep.offset +=
+        getStructMemberOffset((const llvm::StructType*)type, member);
+      type = type->getStructElementType(member);
+      continue;
+    }
+
+    const llvm::Type* elemType;
+    if (type->isPointerTy())
+    {
+      elemType = type->getPointerElementType();
+    }
+    else if (type->isArrayTy())
+    {
+      elemType = type->getArrayElementType();
+    }
+    else if (type->isVectorTy())
+    {
+      elemType = llvm::cast<llvm::FixedVectorType>(type)->getElementType();
+    }
+    else
+    {
+      FATAL_ERROR("Unsupported GEP base type: %d", type->getTypeID());
+    }
+
+    int64_t stride = getTypeSize(elemType);
+    if (constIndex)
+    {
+      gep.offset += constIndex->getSExtValue() * stride;
+    }
+    else if (stride)
+    {
+      gep.strides.push_back(make_pair(index, stride));
+    }
+    type = elemType;
+  }
+
+  m_geps[instruction] = gep;
+}
+
+const InterpreterCache::GEPInfo&
+InterpreterCache::getGEP(const llvm::Instruction* instruction) const
+{
+  GEPMap::const_iterator itr = m_geps.find(instruction);
+  if (itr == m_geps.end())
+  {
+    FATAL_ERROR("GEP not found in cache");
+  }
+  return itr->second;
+}
+
+void InterpreterCache::addType(const llvm::Type* type)
+{
+  // Pointer sizes don't depend on the pointee, but the interpreter needs the
+  // layout of the types that it loads and stores
+  if (type->isPointerTy())
+  {
+    addType(type->getPointerElementType());
+    return;
+  }
+
+  if (!type->isAggregateType() || m_typeLayouts.count(type))
+  {
+    return;
+  }
+
+  TypeLayout& layout = m_typeLayouts[type];
+  layout.size = oclgrind::getTypeSize(type);
+  layout.alignment = oclgrind::getTypeAlignment(type);
+  if (auto structType = llvm::dyn_cast<llvm::StructType>(type))
+  {
+    for (unsigned i = 0; i < structType->getNumElements(); i++)
+    {
+      layout.offsets.push_back(
+        oclgrind::getStructMemberOffset(structType, i));
+    }
+    flattenStruct(structType, 0, layout.scalars);
+  }
+
+  // Add member types once this type has been added, so that recursive types
+  // terminate
+  for (unsigned i = 0; i < type->getNumContainedTypes(); i++)
+  {
+    addType(type->getContainedType(i));
+  }
+}
+
 unsigned InterpreterCache::addValueID(const llvm::Value* value)
 {
   ValueMap::iterator itr = m_valueIDs.find(value);
@@ -1735,10 +1942,63 @@ unsigned InterpreterCache::addValueID(const llvm::Value* value)
     // Assign next index to value
     unsigned pos = m_valueIDs.size();
     itr = m_valueIDs.insert(make_pair(value, pos)).first;
+
+    // Cache the size of the value and the layouts of the types it uses
+    m_valueSizes.push_back(oclgrind::getValueSize(value));
+    addType(value->getType());
   }
   return itr->second;
 }
 
+unsigned
+InterpreterCache::getStructMemberOffset(const llvm::StructType* type,
+                                        unsigned index) const
+{
+  TypeLayoutMap::const_iterator itr = m_typeLayouts.find(type);
+  if (itr == m_typeLayouts.end())
+  {
+    return oclgrind::getStructMemberOffset(type, index);
+  }
+  return itr->second.offsets[index];
+}
+
+unsigned InterpreterCache::getTypeAlignment(const llvm::Type* type) const
+{
+  if (type->isAggregateType())
+  {
+    TypeLayoutMap::const_iterator itr = m_typeLayouts.find(type);
+    if (itr != m_typeLayouts.end())
+    {
+      return itr->second.alignment;
+    }
+  }
+  return oclgrind::getTypeAlignment(type);
+}
+
+const InterpreterCache::TypeLayout&
+InterpreterCache::getTypeLayout(const llvm::Type* type) const
+{
+  TypeLayoutMap::const_iterator itr = m_typeLayouts.find(type);
+  if (itr == m_typeLayouts.end())
+  {
+    FATAL_ERROR("Type not found in cache (ID %d)", type->getTypeID());
+  }
+  return itr->second;
+}
+
+unsigned InterpreterCache::getTypeSize(const llvm::Type* type) const
+{
+  if (type->isAggregateType())
+  {
+    TypeLayoutMap::const_iterator itr = m_typeLayouts.find(type);
+    if (itr != m_typeLayouts.end())
+    {
+      return itr->second.size;
+    }
+  }
+  return oclgrind::getTypeSize(type);
+}
+
 unsigned InterpreterCache::getValueID(const llvm::Value* value) const
 {
   ValueMap::const_iterator itr = m_valueIDs.find(value);
@@ -1749,6 +2009,11 @@ unsigned InterpreterCache::getValueID(const llvm::Value* value) const
   return itr->second;
 }
 
+pair<unsigned, unsigned> InterpreterCache::getValueSize(unsigned valueID) const
+{
+  return m_valueSizes[valueID];
+}
+
 unsigned InterpreterCache::getNumValues() const
 {
   return m_valueIDs.size();
@@ -1759,11 +2024,169 @@ bool InterpreterCache::hasValue(const llvm::Value* value) const
   return m_valueIDs.count(value);
 }
 
+int InterpreterCache::getUniformID(unsigned valueID) const
+{
+  return m_uniformIDs[valueID];
+}
+
+unsigned InterpreterCache::getNumUniformValues() const
+{
+  return m_numUniformValues;
+}
+
+void InterpreterCache::analyzeUniformity(
+  const llvm::Function* kernel, const set<llvm::Function*>& functions)
+{
+  // Find instructions that produce the same value every time they are
+  // executed by any work-item in a work-group. Since phi nodes are never
+  // uniform there are no cycles, so iterate until no more are found.
+  set<const llvm::Value*> uniform;
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (auto F = functions.begin(); F != functions.end(); F++)
+    {
+      for (auto I = inst_begin(*F); I != inst_end(*F); I++)
+      {
+        if (!uniform.count(&*I) && isUniform(&*I, kernel, uniform))
+        {
+          uniform.insert(&*I);
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // Assign each uniform instruction a slot in the work-group value store
+  m_uniformIDs.assign(m_valueIDs.size(), -1);
+  for (auto U = uniform.begin(); U != uniform.end(); U++)
+  {
+    m_uniformIDs[getValueID(*U)] = m_numUniformValues++;
+  }
+}
+
+bool InterpreterCache::isUniform(const llvm::Instruction* instruction,
+                                 const llvm::Function* kernel,
+                                 const set<const llvm::Value*>& uniform) const
+{
+  if (instruction->getType()->isVoidTy())
+    return false;
+
+  switch (instruction->getOpcode())
+  {
+  case llvm::Instruction::Add:
+  case llvm::Instruction::AddrSpaceCast:
+  case llvm::Instruction::And:
+  case llvm::Instruction::AShr:
+  case llvm::Instruction::BitCast:
+  case llvm::Instruction::ExtractElement:
+  case llvm::Instruction::ExtractValue:
+  case llvm::Instruction::FAdd:
+  case llvm::Instruction::FCmp:
+  case llvm::Instruction::FDiv:
+  case llvm::Instruction::FMul:
+  case llvm::Instruction::FNeg:
+  case llvm::Instruction::FPExt:
+  case llvm::Instruction::FPToSI:
+  case llvm::Instruction::FPToUI:
+  case llvm::Instruction::FPTrunc:
+  case llvm::Instruction::FRem:
+  case llvm::Instruction::FSub:
+  case llvm::Instruction::GetElementPtr:
+  case llvm::Instruction::ICmp:
+  case llvm::Instruction::InsertElement:
+  case llvm::Instruction::InsertValue:
+  case llvm::Instruction::IntToPtr:
+  case llvm::Instruction::LShr:
+  case llvm::Instruction::Mul:
+  case llvm::Instruction::Or:
+  case llvm::Instruction::PtrToInt:
+  case llvm::Instruction::SDiv:
+  case llvm::Instruction::Select:
+  case llvm::Instruction::SExt:
+  case llvm::Instruction::Shl:
+  case llvm::Instruction::ShuffleVector:
+  case llvm::Instruction::SIToFP:
+  case llvm::Instruction::SRem:
+  case llvm::Instruction::Sub:
+  case llvm::Instruction::Trunc:
+  case llvm::Instruction::UDiv:
+  case llvm::Instruction::UIToFP:
+  case llvm::Instruction::URem:
+  case llvm::Instruction::Xor:
+  case llvm::Instruction::ZExt:
+    break;
+  case llvm::Instruction::Call:
+  {
+    // Only work-item functions that are constant across a work-group
+    static const set<string> uniformBuiltins = {
+      "get_global_offset",
+      "get_global_size",
+      "get_group_id",
+      "get_local_size",
+      "get_num_groups",
+      "get_work_dim",
+      "get_enqueued_num_sub_groups",
+      "get_max_sub_group_size",
+      "get_num_sub_groups",
+    };
+    const llvm::Function* callee =
+      ((const llvm::CallInst*)instruction)->getCalledFunction();
+    BuiltinMap::const_iterator bItr = m_builtins.find(callee);
+    if (bItr == m_builtins.end() ||
+        !uniformBuiltins.count(bItr->second.name))
+      return false;
+    break;
+  }
+  default:
+    return false;
+  }
+
+  // All operands must be uniform
+  for (auto O = instruction->value_op_begin(); O != instruction->value_op_end();
+       O++)
+  {
+    const llvm::Value* operand = *O;
+    if (llvm::isa<llvm::Constant>(operand) &&
+        !llvm::isa<llvm::GlobalValue>(operand))
+    {
+      continue;
+    }
+    else if (auto arg = llvm::dyn_cast<llvm::Argument>(operand))
+    {
+      // Arguments passed in private memory are allocated per work-item
+      if (arg->getParent() != kernel ||
+          (arg->getType()->isPointerTy() &&
+           arg->getType()->getPointerAddressSpace() == AddrSpacePrivate))
+        return false;
+    }
+    else if (auto global = llvm::dyn_cast<llvm::GlobalVariable>(operand))
+    {
+      if (global->getType()->getPointerAddressSpace() == AddrSpacePrivate)
+        return false;
+    }
+    else if (llvm::isa<llvm::Function>(operand))
+    {
+      continue;
+    }
+    else if (!uniform.count(operand))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 void InterpreterCache::addOperand(const llvm::Value* operand)
 {
+  addType(operand->getType());
+
   // Resolve constants
   if (llvm::isa<llvm::ConstantAggregate>(operand) ||
-      llvm::isa<llvm::ConstantData>(operand))
+      llvm::isa<llvm::ConstantData>(operand) ||
+      llvm::isa<llvm::Function>(operand))
   {
     addConstant(operand);
   }
@@ -1777,7 +2200,12 @@ void InterpreterCache::addOperand(const llvm::Value* operand)
       {
         addOperand(*O);
       }
-      m_constExpressions[expr] = getConstExprAsInstruction(expr);
+      llvm::Instruction* instruction = getConstExprAsInstruction(expr);
+      m_constExpressions[expr] = instruction;
+      if (instruction->getOpcode() == llvm::Instruction::GetElementPtr)
+      {
+        addGEP(instruction);
+      }
       // TODO: Resolve actual value?
     }
   }
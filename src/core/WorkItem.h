@@ -45,8 +45,15 @@ typedef std::unordered_map<std::string, BuiltinFunction> BuiltinFunctionMap;
 typedef std::list<std::pair<std::string, BuiltinFunction>>
   BuiltinFunctionPrefixList;
 
+// Builtins that are specialised for each overload when they are resolved
+typedef BuiltinFunction (*BuiltinSpecializer)(const std::string& name,
+                                              const std::string& overload);
+typedef std::list<std::pair<std::string, BuiltinSpecializer>>
+  BuiltinSpecializerList;
+
 extern BuiltinFunctionMap workItemBuiltins;
 extern BuiltinFunctionPrefixList workItemPrefixBuiltins;
+extern BuiltinSpecializerList workItemBuiltinSpecializers;
 
 // Per-kernel cache for various interpreter state information
 class InterpreterCache
@@ -58,6 +65,25 @@ public:
     std::string name, overload;
   };
 
+  // GEP lowered to a constant byte offset plus a list of variable indices
+  // and their strides
+  struct GEPInfo
+  {
+    int64_t offset;
+    std::vector<std::pair<const llvm::Value*, int64_t>> strides;
+  };
+
+  // Size, alignment and member offsets of an aggregate type, along with the
+  // offset and size of each non-struct member once nested structs have been
+  // flattened (packed structs are kept as a single member)
+  struct TypeLayout
+  {
+    unsigned size;
+    unsigned alignment;
+    std::vector<unsigned> offsets;
+    std::vector<std::pair<unsigned, unsigned>> scalars;
+  };
+
   InterpreterCache(llvm::Function* kernel);
   ~InterpreterCache();
 
@@ -68,24 +94,50 @@ public:
   TypedValue getConstant(const llvm::Value* operand) const;
   const llvm::Instruction* getConstantExpr(const llvm::Value* expr) const;
 
+  void addGEP(const llvm::Instruction* instruction);
+  const GEPInfo& getGEP(const llvm::Instruction* instruction) const;
+
+  void addType(const llvm::Type* type);
+  const TypeLayout& getTypeLayout(const llvm::Type* type) const;
+  unsigned getStructMemberOffset(const llvm::StructType* type,
+                                 unsigned index) const;
+  unsigned getTypeAlignment(const llvm::Type* type) const;
+  unsigned getTypeSize(const llvm::Type* type) const;
+
   unsigned addValueID(const llvm::Value* value);
   unsigned getValueID(const llvm::Value* value) const;
+  std::pair<unsigned, unsigned> getValueSize(unsigned valueID) const;
   unsigned getNumValues() const;
   bool hasValue(const llvm::Value* value) const;
 
+  int getUniformID(unsigned valueID) const;
+  unsigned getNumUniformValues() const;
+
 private:
   typedef std::unordered_map<const llvm::Value*, unsigned> ValueMap;
   typedef std::unordered_map<const llvm::Function*, Builtin> BuiltinMap;
   typedef std::unordered_map<const llvm::Value*, TypedValue> ConstantMap;
   typedef std::unordered_map<const llvm::Value*, llvm::Instruction*>
     ConstExprMap;
+  typedef std::unordered_map<const llvm::Instruction*, GEPInfo> GEPMap;
+  typedef std::unordered_map<const llvm::Type*, TypeLayout> TypeLayoutMap;
 
   BuiltinMap m_builtins;
   ConstantMap m_constants;
   ConstExprMap m_constExpressions;
+  GEPMap m_geps;
+  TypeLayoutMap m_typeLayouts;
   ValueMap m_valueIDs;
+  std::vector<std::pair<unsigned, unsigned>> m_valueSizes;
+  std::vector<int> m_uniformIDs;
+  unsigned m_numUniformValues;
 
   void addOperand(const llvm::Value* value);
+  void analyzeUniformity(const llvm::Function* kernel,
+                         const std::set<llvm::Function*>& functions);
+  bool isUniform(const llvm::Instruction* instruction,
+                 const llvm::Function* kernel,
+                 const std::set<const llvm::Value*>& uniform) const;
 };
 
 class WorkItem
@@ -106,6 +158,8 @@ public:
   virtual ~WorkItem();
 
   void clearBarrier();
+  void completeCollective(const llvm::Instruction* instruction,
+                          const TypedValue& result);
   void dispatch(const llvm::Instruction* instruction, TypedValue& result);
   void execute(const llvm::Instruction* instruction);
   const std::stack<const llvm::Instruction*>& getCallStack() const;
@@ -113,6 +167,7 @@ public:
   const llvm::Instruction* getCurrentInstruction() const;
   Size3 getGlobalID() const;
   size_t getGlobalIndex() const;
+  const InterpreterCache* getInterpreterCache() const;
   Size3 getLocalID() const;
   TypedValue getOperand(const llvm::Value* operand) const;
   const llvm::BasicBlock* getPreviousBlock() const;
@@ -196,6 +251,7 @@ private:
   mutable MemoryPool m_pool;
 
   State m_state;
+  bool m_collectivePending;
   struct Position;
   Position* m_position;
 
@@ -10,10 +10,12 @@
 #include "config.h"
 
 #include <algorithm>
-#include <fenv.h>
+#include <atomic>
 #include <float.h>
+#include <limits>
 #include <math.h>
 #include <mutex>
+#include <type_traits>
 
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/Instructions.h"
@@ -38,6 +40,261 @@ using namespace std;
 namespace oclgrind
 {
 static mutex printfMutex;
+static atomic<size_t> nextEventID;
+
+// Rounding modes for conversions
+enum ConvertRounding
+{
+  RTE,
+  RTZ,
+  RTP,
+  RTN,
+};
+
+// Half-precision value, stored as its bit pattern
+struct Half
+{
+  cl_half bits;
+};
+static_assert(sizeof(Half) == sizeof(cl_half),
+              "half values must be stored as 16-bit values");
+
+// Categories of types that need different conversion logic
+enum ConvertKind
+{
+  KindInt,
+  KindFloat,
+  KindHalf,
+};
+template <typename T> struct ConvertKindOf
+{
+  static const int value = is_integral<T>::value ? KindInt : KindFloat;
+};
+template <> struct ConvertKindOf<Half>
+{
+  static const int value = KindHalf;
+};
+
+// Round a floating point value to an integral value, without relying on the
+// floating point environment
+template <int Rnd> static double roundToIntegral(double x)
+{
+  switch (Rnd)
+  {
+  case RTZ:
+    return trunc(x);
+  case RTP:
+    return ceil(x);
+  case RTN:
+    return floor(x);
+  default:
+  {
+    // Round half to even
+    double r = floor(x);
+    double d = x - r;
+    if (d > 0.5 || (d == 0.5 && fmod(r, 2.0) != 0.0))
+      r += 1.0;
+    return r;
+  }
+  }
+}
+
+// Compare an integral floating point value that was rounded from an
+// integer with that integer, returning the sign of (r - x)
+template <typename F, typename Int> static int compareIntegral(F r, Int x)
+{
+  // Only values rounded away from x can be outside the range of Int
+  const F limit = ldexp((F)1, numeric_limits<Int>::digits);
+  if (r >= limit)
+    return 1;
+  if (r < -limit)
+    return -1;
+  Int ri = (Int)r;
+  return ri < x ? -1 : (ri > x ? 1 : 0);
+}
+
+// Adjust a value that was rounded to nearest to honour the rounding mode,
+// where cmp is the sign of the rounding error
+template <int Rnd, typename F> static F adjustRounding(F r, int cmp, bool neg)
+{
+  if (Rnd == RTP && cmp < 0)
+    return nextafter(r, numeric_limits<F>::infinity());
+  if (Rnd == RTN && cmp > 0)
+    return nextafter(r, -numeric_limits<F>::infinity());
+  if (Rnd == RTZ && (neg ? cmp < 0 : cmp > 0))
+    return nextafter(r, (F)0);
+  return r;
+}
+
+static cl_half_rounding_mode getHalfRounding(int rnd)
+{
+  switch (rnd)
+  {
+  case RTZ:
+    return CL_HALF_RTZ;
+  case RTP:
+    return CL_HALF_RTP;
+  case RTN:
+    return CL_HALF_RTN;
+  default:
+    return CL_HALF_RTE;
+  }
+}
+
+// Conversion of a single value, specialised for each kind of type
+template <typename Dst, typename Src, int Rnd, bool Sat,
+          int DstKind = ConvertKindOf<Dst>::value,
+          int SrcKind = ConvertKindOf<Src>::value>
+struct Converter;
+
+template <typename Dst, typename Src, int Rnd, bool Sat>
+struct Converter<Dst, Src, Rnd, Sat, KindInt, KindInt>
+{
+  static Dst convert(Src x)
+  {
+    if (Sat)
+    {
+      if (numeric_limits<Src>::is_signed && (int64_t)x < 0)
+      {
+        if (!numeric_limits<Dst>::is_signed)
+          return 0;
+        if ((int64_t)x < (int64_t)numeric_limits<Dst>::min())
+          return numeric_limits<Dst>::min();
+      }
+      else if ((uint64_t)x > (uint64_t)numeric_limits<Dst>::max())
+      {
+        return numeric_limits<Dst>::max();
+      }
+    }
+    return (Dst)x;
+  }
+};
+
+template <typename Dst, typename Src, int Rnd, bool Sat>
+struct Converter<Dst, Src, Rnd, Sat, KindInt, KindFloat>
+{
+  static Dst convert(Src x)
+  {
+    const int digits = numeric_limits<Dst>::digits;
+    const double hi = ldexp(1.0, digits);
+    const double lo = numeric_limits<Dst>::is_signed ? -hi : 0.0;
+
+    double r = roundToIntegral<Rnd>(x);
+    if (Sat || !(r >= -ldexp(1.0, 63) && r < ldexp(1.0, 64)))
+    {
+      if (r != r)
+        return 0;
+      if (r < lo)
+        return numeric_limits<Dst>::min();
+      if (r >= hi)
+        return numeric_limits<Dst>::max();
+    }
+
+    // Out of range values are undefined without saturation, so just
+    // truncate them to the size of the result
+    return r < 0 ? (Dst)(int64_t)r : (Dst)(uint64_t)r;
+  }
+};
+
+template <typename Dst, typename Src, int Rnd, bool Sat>
+struct Converter<Dst, Src, Rnd, Sat, KindFloat, KindInt>
+{
+  static Dst convert(Src x)
+  {
+    Dst r = (Dst)x;
+    if (Rnd != RTE)
+      r = adjustRounding<Rnd>(r, compareIntegral(r, x), x < 0);
+    return r;
+  }
+};
+
+template <typename Dst, typename Src, int Rnd, bool Sat>
+struct Converter<Dst, Src, Rnd, Sat, KindFloat, KindFloat>
+{
+  static Dst convert(Src x)
+  {
+    Dst r = (Dst)x;
+    if (Rnd != RTE && (Src)r != x && x == x)
+      r = adjustRounding<Rnd>(r, (Src)r < x ? -1 : 1, x < 0);
+    return r;
+  }
+};
+
+template <typename Src, int Rnd, bool Sat>
+struct Converter<Half, Src, Rnd, Sat, KindHalf, KindInt>
+{
+  static Half convert(Src x)
+  {
+    // Integers that are inexact as doubles are also out of range for half
+    Half r = {cl_half_from_double((double)x, getHalfRounding(Rnd))};
+    return r;
+  }
+};
+
+template <typename Src, int Rnd, bool Sat>
+struct Converter<Half, Src, Rnd, Sat, KindHalf, KindFloat>
+{
+  static Half convert(Src x)
+  {
+    Half r = {cl_half_from_double(x, getHalfRounding(Rnd))};
+    return r;
+  }
+};
+
+template <typename Dst, int Rnd, bool Sat>
+struct Converter<Dst, Half, Rnd, Sat, KindInt, KindHalf>
+{
+  static Dst convert(Half x)
+  {
+    return Converter<Dst, float, Rnd, Sat>::convert(cl_half_to_float(x.bits));
+  }
+};
+
+template <typename Dst, int Rnd, bool Sat>
+struct Converter<Dst, Half, Rnd, Sat, KindFloat, KindHalf>
+{
+  static Dst convert(Half x)
+  {
+    return cl_half_to_float(x.bits);
+  }
+};
+
+template <int Rnd, bool Sat>
+struct Converter<Half, Half, Rnd, Sat, KindHalf, KindHalf>
+{
+  static Half convert(Half x)
+  {
+    return x;
+  }
+};
+
+// Conversion of arrays of values, using batched conversions where available
+template <typename Dst, typename Src, int Rnd, bool Sat> struct ArrayConverter
+{
+  static void convert(Dst* dst, const Src* src, size_t num)
+  {
+    for (size_t i = 0; i < num; i++)
+    {
+      dst[i] = Converter<Dst, Src, Rnd, Sat>::convert(src[i]);
+    }
+  }
+};
+
+template <int Rnd, bool Sat> struct ArrayConverter<Half, float, Rnd, Sat>
+{
+  static void convert(Half* dst, const float* src, size_t num)
+  {
+    floatToHalf((cl_half*)dst, src, num, getHalfRounding(Rnd));
+  }
+};
+
+template <int Rnd, bool Sat> struct ArrayConverter<float, Half, Rnd, Sat>
+{
+  static void convert(float* dst, const Half* src, size_t num)
+  {
+    halfToFloat(dst, (const cl_half*)src, num);
+  }
+};
 
 class WorkItemBuiltins
 {
@@ -1551,6 +1808,10 @@ class WorkItemBuiltins
     // Generate channel values
     Memory* memory = workItem->getMemory(AddrSpaceGlobal);
     unsigned char* data = workItem->m_pool.alloc(channelSize * numChannels);
+    if (image->format.image_channel_data_type == CL_HALF_FLOAT)
+    {
+      floatToHalf((cl_half*)data, values, numChannels, CL_HALF_RTE);
+    }
     for (unsigned i = 0; i < numChannels; i++)
     {
       switch (image->format.image_channel_data_type)
@@ -1572,7 +1833,7 @@ class WorkItemBuiltins
         ((float*)data)[i] = values[i];
         break;
       case CL_HALF_FLOAT:
-        ((uint16_t*)data)[i] = cl_half_from_float(values[i], CL_HALF_RTE);
+        // Already converted
         break;
       default:
         FATAL_ERROR("Unsupported image channel data type: %X",
@@ -2846,121 +3107,846 @@ class WorkItemBuiltins
     // TODO: Implement?
   }
 
-  //////////////////////////////////////////
-  // Vector Data Load and Store Functions //
-  //////////////////////////////////////////
+  //////////////////////////////////////////////////
+  // Work-Group and Sub-Group Collective Functions //
+  //////////////////////////////////////////////////
 
-  DEFINE_BUILTIN(vload)
+  static void getLaneValue(const TypedValue& value, int64_t& r)
   {
-    size_t base = PARG(1);
-    unsigned int addressSpace = ARG(1)->getType()->getPointerAddressSpace();
-    uint64_t offset = UARG(0);
-
-    size_t address = base + offset * result.size * result.num;
-    size_t size = result.size * result.num;
-    workItem->getMemory(addressSpace)->load(result.data, address, size);
+    r = value.getSInt();
+  }
+  static void getLaneValue(const TypedValue& value, uint64_t& r)
+  {
+    r = value.getUInt();
+  }
+  static void getLaneValue(const TypedValue& value, double& r)
+  {
+    r = value.getFloat();
+  }
+  static void setLaneValue(TypedValue value, int64_t r)
+  {
+    value.setSInt(r);
+  }
+  static void setLaneValue(TypedValue value, uint64_t r)
+  {
+    value.setUInt(r);
+  }
+  static void setLaneValue(TypedValue value, double r)
+  {
+    value.setFloat(r);
+  }
+  static int64_t addLaneValues(int64_t a, int64_t b)
+  {
+    // Wrap on overflow
+    return (int64_t)((uint64_t)a + (uint64_t)b);
+  }
+  static uint64_t addLaneValues(uint64_t a, uint64_t b)
+  {
+    return a + b;
+  }
+  static double addLaneValues(double a, double b)
+  {
+    return a + b;
   }
 
-  DEFINE_BUILTIN(vstore)
+  // Compute a reduction or scan across the lanes of a group in a single pass
+  template <typename T>
+  static void group_scan(const llvm::CallInst* callInst, const string& op,
+                         const vector<WorkItem*>& workItems,
+                         const vector<TypedValue>& results, T minValue,
+                         T maxValue)
   {
-    const llvm::Value* value = ARG(0);
-    unsigned size = getTypeSize(value->getType());
-    if (isVector3(value))
+    string func = op.substr(op.rfind('_') + 1);
+    bool reduce = op.compare(0, 7, "reduce_") == 0;
+    bool inclusive = op.compare(0, 15, "scan_inclusive_") == 0;
+
+    T identity = 0;
+    if (func == "min")
+      identity = maxValue;
+    else if (func == "max")
+      identity = minValue;
+
+    T acc = identity;
+    for (size_t i = 0; i < workItems.size(); i++)
     {
-      // 3-element vectors are same size as 4-element vectors,
-      // but vstore address offset shouldn't use this.
-      size = (size / 4) * 3;
-    }
+      if (!workItems[i])
+        continue;
 
-    size_t base = PARG(2);
-    unsigned int addressSpace = ARG(2)->getType()->getPointerAddressSpace();
-    uint64_t offset = UARG(1);
+      T value;
+      getLaneValue(workItems[i]->getOperand(ARG(0)), value);
 
-    size_t address = base + offset * size;
-    unsigned char* data = workItem->getOperand(value).data;
-    workItem->getMemory(addressSpace)->store(data, address, size);
+      T next;
+      if (func == "add")
+        next = addLaneValues(acc, value);
+      else if (func == "min")
+        next = std::min(acc, value);
+      else
+        next = std::max(acc, value);
+
+      if (!reduce)
+        setLaneValue(results[i], inclusive ? next : acc);
+      acc = next;
+    }
+
+    if (reduce)
+    {
+      for (size_t i = 0; i < workItems.size(); i++)
+      {
+        if (workItems[i])
+          setLaneValue(results[i], acc);
+      }
+    }
   }
 
-  DEFINE_BUILTIN(vload_half)
+  static void group_collective_op(const llvm::CallInst* callInst,
+                                  const string& fnName,
+                                  const string& overload,
+                                  const vector<WorkItem*>& workItems,
+                                  const vector<TypedValue>& results)
   {
-    size_t base = PARG(1);
-    unsigned int addressSpace = ARG(1)->getType()->getPointerAddressSpace();
-    uint64_t offset = UARG(0);
+    // Find first work-item that reached the collective
+    size_t first = 0;
+    while (first < workItems.size() && !workItems[first])
+      first++;
+    if (first == workItems.size())
+      return;
 
-    size_t address;
-    if (fnName.compare(0, 6, "vloada") == 0 && result.num == 3)
+    // Strip work_group_ or sub_group_ prefix
+    string op = fnName.substr(fnName.find("group_") + 6);
+    if (op == "barrier")
     {
-      address = base + offset * sizeof(cl_half) * 4;
+      // Synchronization only, which plugins see once every lane arrives
+      WorkItem* workItem = workItems[first];
+      workItem->m_context->notifySubGroupBarrier(workItem->m_workGroup,
+                                                 workItems, UARG(0));
     }
-    else
+    else if (op == "all" || op == "any")
     {
-      address = base + offset * sizeof(cl_half) * result.num;
+      bool all = true;
+      bool any = false;
+      for (size_t i = 0; i < workItems.size(); i++)
+      {
+        if (workItems[i])
+        {
+          bool value = workItems[i]->getOperand(ARG(0)).getUInt() != 0;
+          all = all && value;
+          any = any || value;
+        }
+      }
+      for (size_t i = 0; i < workItems.size(); i++)
+      {
+        if (workItems[i])
+          setLaneValue(results[i], (int64_t)(op == "all" ? all : any));
+      }
     }
-    size_t size = sizeof(cl_half) * result.num;
-    uint16_t* halfData = (uint16_t*)workItem->m_pool.alloc(2 * result.num);
-    workItem->getMemory(addressSpace)
-      ->load((unsigned char*)halfData, address, size);
+    else if (op == "broadcast")
+    {
+      // Get linear ID of the source work-item
+      WorkItem* workItem = workItems[first];
+      size_t source = UARG(1);
+      if (fnName.compare(0, 11, "work_group_") == 0)
+      {
+        Size3 groupSize = workItem->m_workGroup->getGroupSize();
+        if (callInst->arg_size() > 2)
+          source += UARG(2) * groupSize.x;
+        if (callInst->arg_size() > 3)
+          source += UARG(3) * groupSize.x * groupSize.y;
+      }
 
-    // Convert to floats
-    for (unsigned i = 0; i < result.num; i++)
+      if (source >= workItems.size() || !workItems[source])
+      {
+        workItem->m_context->logError(
+          "Invalid local ID for collective broadcast");
+        return;
+      }
+
+      TypedValue value = workItems[source]->getOperand(ARG(0));
+      for (size_t i = 0; i < workItems.size(); i++)
+      {
+        if (workItems[i])
+          memcpy(results[i].data, value.data, value.size * value.num);
+      }
+    }
+    else
     {
-      ((float*)result.data)[i] = cl_half_to_float(halfData[i]);
+      unsigned size = getTypeSize(callInst->getType());
+      switch (getOverloadArgType(overload))
+      {
+      case 'f':
+      case 'd':
+        group_scan<double>(callInst, op, workItems, results, -INFINITY,
+                           INFINITY);
+        break;
+      case 'c':
+      case 's':
+      case 'i':
+      case 'l':
+      {
+        int64_t maxValue = (int64_t)(UINT64_MAX >> (65 - size * 8));
+        group_scan<int64_t>(callInst, op, workItems, results, -maxValue - 1,
+                            maxValue);
+        break;
+      }
+      case 'h':
+      case 't':
+      case 'j':
+      case 'm':
+        group_scan<uint64_t>(callInst, op, workItems, results, 0,
+                             UINT64_MAX >> (64 - size * 8));
+        break;
+      default:
+        FATAL_ERROR("Unsupported argument type: %c",
+                    getOverloadArgType(overload));
+      }
     }
   }
 
-  DEFINE_BUILTIN(vstore_half)
+  DEFINE_BUILTIN(group_collective)
   {
-    const llvm::Value* value = ARG(0);
-    unsigned size = getTypeSize(value->getType());
-    if (isVector3(value))
-    {
-      // 3-element vectors are same size as 4-element vectors,
-      // but vstore address offset shouldn't use this.
-      size = (size / 4) * 3;
-    }
+    // Gather the work-item into its group, which computes the results for
+    // every work-item once they have all arrived
+    workItem->m_state = WorkItem::BARRIER;
+    workItem->m_workGroup->notifyCollective(
+      workItem, callInst, fnName.compare(0, 10, "sub_group_") == 0,
+      group_collective_op, fnName, overload, result);
 
-    size_t base = PARG(2);
-    unsigned int addressSpace = ARG(2)->getType()->getPointerAddressSpace();
-    uint64_t offset = UARG(1);
+    // Without fibers the work-item returns before the rest of the group has
+    // arrived, so the instruction is reported once the result is computed
+    if (workItem->m_state == WorkItem::BARRIER)
+      workItem->m_collectivePending = true;
+  }
 
-    // Convert to halfs
-    TypedValue op = workItem->getOperand(value);
-    unsigned char* data = op.data;
-    size = op.num * sizeof(cl_half);
-    uint16_t* halfData = (uint16_t*)workItem->m_pool.alloc(2 * op.num);
+  ////////////////////
+  // Pipe Functions //
+  ////////////////////
 
-    // Parse rounding mode (RTE is the default)
-    cl_half_rounding_mode rmode = CL_HALF_RTE;
-    if (fnName.find("_rtz") != std::string::npos)
-      rmode = CL_HALF_RTZ;
-    else if (fnName.find("_rtn") != std::string::npos)
-      rmode = CL_HALF_RTN;
-    else if (fnName.find("_rtp") != std::string::npos)
-      rmode = CL_HALF_RTP;
+  // Reservation IDs pack the number of reserved packets above the slot index
+  // of the first packet, so that zero is never a valid reservation
+#define RESERVE_ID_SHIFT (sizeof(size_t) * 4)
+#define RESERVE_ID_MASK (((size_t)1 << RESERVE_ID_SHIFT) - 1)
 
-    for (unsigned i = 0; i < op.num; i++)
-    {
-      if (op.size == 4)
-        halfData[i] = cl_half_from_float(((float*)data)[i], rmode);
-      else
-        halfData[i] = cl_half_from_double(((double*)data)[i], rmode);
-    }
+  static atomic<uint32_t>& getPipeCounter(uint32_t& value)
+  {
+    static_assert(sizeof(atomic<uint32_t>) == sizeof(uint32_t),
+                  "pipe counters must be plain 32-bit words");
+    return *(atomic<uint32_t>*)&value;
+  }
 
-    size_t address;
-    if (fnName.compare(0, 7, "vstorea") == 0 && op.num == 3)
+  static Pipe* getPipe(WorkItem* workItem, const llvm::CallInst* callInst)
+  {
+    Memory* memory = workItem->m_context->getGlobalMemory();
+    size_t address = PARG(0);
+    if (!memory->isAddressValid(address, sizeof(Pipe)))
     {
-      address = base + offset * sizeof(cl_half) * 4;
+      workItem->m_context->logError("Invalid pipe object");
+      return NULL;
     }
-    else
+
+    // Packet size and alignment are always the last two arguments
+    Pipe* pipe = (Pipe*)memory->getPointer(address);
+    if (UARG(callInst->arg_size() - 2) != pipe->packetSize)
     {
-      address = base + offset * sizeof(cl_half) * op.num;
+      workItem->m_context->logError("Pipe packet size mismatch");
+      return NULL;
     }
 
-    workItem->getMemory(addressSpace)
-      ->store((unsigned char*)halfData, address, size);
+    return pipe;
   }
 
-  /////////////////////////
+  // Reserve consecutive packet slots for reading or writing, returning zero
+  // if there are not enough packets (or enough space) in the pipe
+  // This is the bounded multi-producer/multi-consumer queue algorithm, where
+  // each slot holds a sequence number recording which lap of the ring buffer
+  // it is ready for, so no locks are needed and commits can happen in any
+  // order.
+  static size_t reservePipePackets(Pipe* pipe, bool read, uint64_t num)
+  {
+    if (num == 0 || num > pipe->maxPackets)
+      return 0;
+
+    uint32_t* sequence = (uint32_t*)(pipe + 1);
+    uint32_t mask = pipe->numSlots - 1;
+    atomic<uint32_t>& index =
+      getPipeCounter(read ? pipe->readIndex : pipe->writeIndex);
+    uint32_t position = index.load(memory_order_relaxed);
+    while (true)
+    {
+      // Slots can be read once they have been written, and can be written
+      // once the packet from the previous lap has been read
+      bool stale = false;
+      for (uint32_t i = 0; i < num && !stale; i++)
+      {
+        uint32_t slotPosition = position + i;
+        uint32_t seq = getPipeCounter(sequence[slotPosition & mask])
+                         .load(memory_order_acquire);
+        int32_t diff = (int32_t)(seq - slotPosition - (read ? 1 : 0));
+        if (diff < 0)
+          return 0;
+        stale = diff > 0;
+      }
+
+      // Writers must also respect the capacity of the pipe
+      if (!read && !stale)
+      {
+        uint32_t readIndex =
+          getPipeCounter(pipe->readIndex).load(memory_order_acquire);
+        int32_t used = (int32_t)(position - readIndex);
+        if (used >= 0 && used + num > pipe->maxPackets)
+          return 0;
+        stale = used < 0;
+      }
+
+      if (stale)
+      {
+        position = index.load(memory_order_relaxed);
+      }
+      else if (index.compare_exchange_weak(
+                 position, (uint32_t)(position + num), memory_order_relaxed))
+      {
+        return (size_t)(num << RESERVE_ID_SHIFT) | (position & mask);
+      }
+    }
+  }
+
+  // Publish reserved packets to readers, or release them back to writers
+  static void commitPipePackets(Pipe* pipe, bool read, size_t reserveID)
+  {
+    uint32_t* sequence = (uint32_t*)(pipe + 1);
+    uint32_t mask = pipe->numSlots - 1;
+    uint32_t first = reserveID & RESERVE_ID_MASK;
+    uint32_t num = reserveID >> RESERVE_ID_SHIFT;
+    for (uint32_t i = 0; i < num; i++)
+    {
+      atomic<uint32_t>& seq = getPipeCounter(sequence[(first + i) & mask]);
+      uint32_t value = seq.load(memory_order_relaxed);
+      seq.store(read ? value - 1 + pipe->numSlots : value + 1,
+                memory_order_release);
+    }
+  }
+
+  // Packet pointers are passed in the generic address space, so find the
+  // memory of the pointer they were cast from, or NULL if it is unsupported
+  static Memory* getPipePacketMemory(WorkItem* workItem,
+                                     const llvm::CallInst* callInst,
+                                     unsigned arg)
+  {
+    const llvm::Value* ptr = ARG(arg)->stripPointerCasts();
+    unsigned addrSpace = ptr->getType()->getPointerAddressSpace();
+    if (addrSpace > AddrSpaceLocal)
+    {
+      workItem->m_context->logError("Unsupported pipe packet address space");
+      return NULL;
+    }
+    return workItem->getMemory(addrSpace);
+  }
+
+  static void copyPipePacket(WorkItem* workItem, const llvm::CallInst* callInst,
+                             Pipe* pipe, Memory* memory, uint32_t slot,
+                             unsigned arg, bool read)
+  {
+    size_t offset = pipe->packetOffset + (size_t)slot * pipe->packetSize;
+    unsigned char* packet = (unsigned char*)pipe + offset;
+    if (read)
+      memory->store(packet, PARG(arg), pipe->packetSize);
+    else
+      memory->load(packet, PARG(arg), pipe->packetSize);
+  }
+
+  DEFINE_BUILTIN(pipe_access)
+  {
+    bool read = fnName.compare(0, 11, "__read_pipe") == 0;
+    Pipe* pipe = getPipe(workItem, callInst);
+    if (!pipe)
+    {
+      result.setSInt(-1);
+      return;
+    }
+
+    // Fail before reserving anything if the packet cannot be copied
+    unsigned arg = callInst->arg_size() == 4 ? 1 : 3;
+    Memory* memory = getPipePacketMemory(workItem, callInst, arg);
+    if (!memory)
+    {
+      result.setSInt(-1);
+      return;
+    }
+
+    if (callInst->arg_size() == 4)
+    {
+      // Unreserved access reserves, copies and commits a single packet
+      size_t reserveID = reservePipePackets(pipe, read, 1);
+      if (!reserveID)
+      {
+        result.setSInt(-1);
+        return;
+      }
+      copyPipePacket(workItem, callInst, pipe, memory,
+                     reserveID & RESERVE_ID_MASK, arg, read);
+      commitPipePackets(pipe, read, reserveID);
+    }
+    else
+    {
+      size_t reserveID = PARG(1);
+      uint64_t index = UARG(2);
+      if (!reserveID)
+      {
+        workItem->m_context->logError("Invalid pipe reservation ID");
+        result.setSInt(-1);
+        return;
+      }
+      if (index >= (reserveID >> RESERVE_ID_SHIFT))
+      {
+        workItem->m_context->logError("Pipe packet index out of range of "
+                                      "reservation");
+        result.setSInt(-1);
+        return;
+      }
+
+      uint32_t slot =
+        ((reserveID & RESERVE_ID_MASK) + index) & (pipe->numSlots - 1);
+      copyPipePacket(workItem, callInst, pipe, memory, slot, arg, read);
+    }
+    result.setSInt(0);
+  }
+
+  DEFINE_BUILTIN(pipe_reserve)
+  {
+    bool read = fnName == "__reserve_read_pipe";
+    Pipe* pipe = getPipe(workItem, callInst);
+    result.setPointer(pipe ? reservePipePackets(pipe, read, UARG(1)) : 0);
+  }
+
+  DEFINE_BUILTIN(pipe_commit)
+  {
+    bool read = fnName == "__commit_read_pipe";
+    Pipe* pipe = getPipe(workItem, callInst);
+    if (pipe && PARG(1))
+      commitPipePackets(pipe, read, PARG(1));
+  }
+
+  static void group_pipe_op(const llvm::CallInst* callInst,
+                            const string& fnName, const string& overload,
+                            const vector<WorkItem*>& workItems,
+                            const vector<TypedValue>& results)
+  {
+    // Find first work-item that reached the collective
+    size_t first = 0;
+    while (first < workItems.size() && !workItems[first])
+      first++;
+    if (first == workItems.size())
+      return;
+
+    // Reserve or commit once on behalf of the whole group
+    WorkItem* workItem = workItems[first];
+    bool read = fnName.find("_read_pipe") != string::npos;
+    Pipe* pipe = getPipe(workItem, callInst);
+    if (fnName.find("_reserve_") != string::npos)
+    {
+      size_t reserveID = pipe ? reservePipePackets(pipe, read, UARG(1)) : 0;
+      for (size_t i = 0; i < workItems.size(); i++)
+      {
+        TypedValue result = results[i];
+        if (workItems[i])
+          result.setPointer(reserveID);
+      }
+    }
+    else if (pipe && PARG(1))
+    {
+      commitPipePackets(pipe, read, PARG(1));
+    }
+  }
+
+  DEFINE_BUILTIN(group_pipe)
+  {
+    workItem->m_state = WorkItem::BARRIER;
+    workItem->m_workGroup->notifyCollective(
+      workItem, callInst, fnName.compare(0, 12, "__sub_group_") == 0,
+      group_pipe_op, fnName, overload, result);
+  }
+
+  DEFINE_BUILTIN(get_pipe_num_packets)
+  {
+    Pipe* pipe = getPipe(workItem, callInst);
+    if (!pipe)
+    {
+      result.setUInt(0);
+      return;
+    }
+
+    uint32_t readIndex =
+      getPipeCounter(pipe->readIndex).load(memory_order_acquire);
+    uint32_t writeIndex =
+      getPipeCounter(pipe->writeIndex).load(memory_order_acquire);
+    result.setUInt(std::max((int32_t)(writeIndex - readIndex), 0));
+  }
+
+  DEFINE_BUILTIN(get_pipe_max_packets)
+  {
+    Pipe* pipe = getPipe(workItem, callInst);
+    result.setUInt(pipe ? pipe->maxPackets : 0);
+  }
+
+  DEFINE_BUILTIN(is_valid_reserve_id)
+  {
+    result.setUInt(PARG(0) != 0);
+  }
+
+  //////////////////////////////
+  // Enqueue Kernel Functions //
+  //////////////////////////////
+
+  // Layout of ndrange_t
+  struct NDRange
+  {
+    cl_uint workDim;
+    size_t globalOffset[3];
+    size_t globalSize[3];
+    size_t localSize[3];
+  };
+
+  // There is only a single device queue, so any non-null handle will do
+#define DEFAULT_DEVICE_QUEUE ((size_t)1)
+
+  static unsigned getPointerAddressSpace(const llvm::Value* ptr)
+  {
+    // Pointers passed to these builtins are usually in the generic address
+    // space, so use the address space of the pointer they were cast from
+    return ptr->stripPointerCasts()->getType()->getPointerAddressSpace();
+  }
+
+  static int checkEventArgs(WorkItem* workItem,
+                            const llvm::CallInst* callInst, unsigned arg)
+  {
+    uint64_t numEvents = UARG(arg);
+    size_t waitList = PARG(arg + 1);
+    if ((numEvents > 0) != (waitList != 0))
+      return CLK_INVALID_EVENT_WAIT_LIST;
+
+    // Events are always complete, since enqueued kernels run in order
+    size_t retEvent = PARG(arg + 2);
+    if (retEvent)
+    {
+      unsigned addrSpace = getPointerAddressSpace(ARG(arg + 2));
+      if (addrSpace > AddrSpaceLocal)
+      {
+        workItem->m_context->logError("Unsupported event address space");
+        return CLK_ENQUEUE_FAILURE;
+      }
+
+      size_t event = ++nextEventID;
+      workItem->getMemory(addrSpace)->store((unsigned char*)&event, retEvent,
+                                            sizeof(size_t));
+    }
+    return CLK_SUCCESS;
+  }
+
+  DEFINE_BUILTIN(enqueue_kernel)
+  {
+    // Block kernel arguments follow the event arguments, if present
+    bool events = fnName.find("_events") != string::npos;
+    bool varargs = fnName.find("varargs") != string::npos;
+    unsigned invokeArg = events ? 6 : 3;
+    if (PARG(0) == 0)
+    {
+      result.setSInt(CLK_INVALID_QUEUE);
+      return;
+    }
+
+    NDRange ndrange;
+    workItem->getMemory(getPointerAddressSpace(ARG(2)))
+      ->load((unsigned char*)&ndrange, PARG(2), sizeof(NDRange));
+    if (ndrange.workDim < 1 || ndrange.workDim > 3)
+    {
+      result.setSInt(CLK_INVALID_NDRANGE);
+      return;
+    }
+    Size3 globalOffset(0, 0, 0), globalSize(1, 1, 1), localSize(1, 1, 1);
+    for (unsigned i = 0; i < ndrange.workDim; i++)
+    {
+      if (ndrange.globalSize[i] == 0)
+      {
+        result.setSInt(CLK_INVALID_NDRANGE);
+        return;
+      }
+      globalOffset[i] = ndrange.globalOffset[i];
+      globalSize[i] = ndrange.globalSize[i];
+      if (ndrange.localSize[i])
+        localSize[i] = ndrange.localSize[i];
+    }
+
+    if (events)
+    {
+      int err = checkEventArgs(workItem, callInst, 3);
+      if (err != CLK_SUCCESS)
+      {
+        result.setSInt(err);
+        return;
+      }
+    }
+
+    const llvm::Function* function =
+      llvm::dyn_cast<llvm::Function>(ARG(invokeArg)->stripPointerCasts());
+    if (!function)
+    {
+      workItem->m_context->logError("Unable to resolve enqueued block");
+      result.setSInt(CLK_ENQUEUE_FAILURE);
+      return;
+    }
+
+    // Sizes of local memory pointers passed to the block
+    vector<size_t> localArgSizes;
+    if (varargs)
+    {
+      uint64_t numLocal = UARG(invokeArg + 2);
+      localArgSizes.resize(numLocal);
+      workItem->getMemory(getPointerAddressSpace(ARG(invokeArg + 3)))
+        ->load((unsigned char*)localArgSizes.data(), PARG(invokeArg + 3),
+               numLocal * sizeof(size_t));
+      for (size_t size : localArgSizes)
+      {
+        if (size == 0)
+        {
+          result.setSInt(CLK_INVALID_ARG_SIZE);
+          return;
+        }
+      }
+    }
+    if (function->arg_size() != localArgSizes.size() + 1)
+    {
+      workItem->m_context->logError("Incorrect number of local memory "
+                                    "arguments for enqueued block");
+      result.setSInt(CLK_ENQUEUE_FAILURE);
+      return;
+    }
+
+    // Capture the block literal, which starts with its size in bytes
+    size_t blockAddress = PARG(invokeArg + 1);
+    unsigned blockAddrSpace = getPointerAddressSpace(ARG(invokeArg + 1));
+    if (blockAddrSpace > AddrSpaceLocal)
+    {
+      workItem->m_context->logError("Unsupported block address space");
+      result.setSInt(CLK_ENQUEUE_FAILURE);
+      return;
+    }
+    Memory* memory = workItem->getMemory(blockAddrSpace);
+    uint32_t blockSize = 0;
+    memory->load((unsigned char*)&blockSize, blockAddress, sizeof(uint32_t));
+    vector<uint8_t> block(blockSize);
+    if (!memory->load(block.data(), blockAddress, blockSize))
+    {
+      result.setSInt(CLK_ENQUEUE_FAILURE);
+      return;
+    }
+
+    workItem->m_kernelInvocation->enqueueChildKernel(
+      function, ndrange.workDim, globalOffset, globalSize, localSize, block,
+      localArgSizes);
+    result.setSInt(CLK_SUCCESS);
+  }
+
+  DEFINE_BUILTIN(enqueue_marker)
+  {
+    if (PARG(0) == 0)
+    {
+      result.setSInt(CLK_INVALID_QUEUE);
+      return;
+    }
+    if (UARG(1) == 0)
+    {
+      result.setSInt(CLK_INVALID_EVENT_WAIT_LIST);
+      return;
+    }
+    result.setSInt(checkEventArgs(workItem, callInst, 1));
+  }
+
+  DEFINE_BUILTIN(get_default_queue)
+  {
+    result.setPointer(DEFAULT_DEVICE_QUEUE);
+  }
+
+  DEFINE_BUILTIN(ndrange)
+  {
+    // ndrange_t is usually returned through a pointer argument
+    unsigned arg = 0;
+    unsigned char* data = result.data;
+    if (callInst->hasStructRetAttr())
+    {
+      arg = 1;
+      data = workItem->m_pool.alloc(sizeof(NDRange));
+    }
+
+    // Arguments are (global), (global, local) or (offset, global, local)
+    NDRange ndrange = {};
+    ndrange.workDim = fnName[8] - '0';
+    size_t* dst[3] = {ndrange.globalSize, ndrange.localSize, NULL};
+    unsigned numArgs = callInst->arg_size() - arg;
+    if (numArgs == 3)
+    {
+      dst[0] = ndrange.globalOffset;
+      dst[1] = ndrange.globalSize;
+      dst[2] = ndrange.localSize;
+    }
+    for (unsigned i = 0; i < numArgs; i++, arg++)
+    {
+      if (ndrange.workDim == 1)
+      {
+        dst[i][0] = UARG(arg);
+      }
+      else
+      {
+        workItem->getMemory(getPointerAddressSpace(ARG(arg)))
+          ->load((unsigned char*)dst[i], PARG(arg),
+                 ndrange.workDim * sizeof(size_t));
+      }
+    }
+
+    memcpy(data, &ndrange, sizeof(NDRange));
+    if (callInst->hasStructRetAttr())
+    {
+      workItem->getMemory(getPointerAddressSpace(ARG(0)))
+        ->store(data, PARG(0), sizeof(NDRange));
+    }
+  }
+
+  DEFINE_BUILTIN(create_user_event)
+  {
+    result.setPointer(++nextEventID);
+  }
+
+  DEFINE_BUILTIN(is_valid_event)
+  {
+    result.setUInt(PARG(0) != 0);
+  }
+
+  DEFINE_BUILTIN(capture_event_profiling_info)
+  {
+    // Profiling information is not available, so report zero durations
+    uint64_t info[2] = {0, 0};
+    workItem->m_context->getGlobalMemory()->store((unsigned char*)info,
+                                                  PARG(2), sizeof(info));
+  }
+
+  DEFINE_BUILTIN(event_noop)
+  {
+    // Events are always complete, so there is nothing to do
+  }
+
+  //////////////////////////////////////////
+  // Vector Data Load and Store Functions //
+  //////////////////////////////////////////
+
+  DEFINE_BUILTIN(vload)
+  {
+    size_t base = PARG(1);
+    unsigned int addressSpace = ARG(1)->getType()->getPointerAddressSpace();
+    uint64_t offset = UARG(0);
+
+    size_t address = base + offset * result.size * result.num;
+    size_t size = result.size * result.num;
+    workItem->getMemory(addressSpace)->load(result.data, address, size);
+  }
+
+  DEFINE_BUILTIN(vstore)
+  {
+    const llvm::Value* value = ARG(0);
+    unsigned size = getTypeSize(value->getType());
+    if (isVector3(value))
+    {
+      // 3-element vectors are same size as 4-element vectors,
+      // but vstore address offset shouldn't use this.
+      size = (size / 4) * 3;
+    }
+
+    size_t base = PARG(2);
+    unsigned int addressSpace = ARG(2)->getType()->getPointerAddressSpace();
+    uint64_t offset = UARG(1);
+
+    size_t address = base + offset * size;
+    unsigned char* data = workItem->getOperand(value).data;
+    workItem->getMemory(addressSpace)->store(data, address, size);
+  }
+
+  DEFINE_BUILTIN(vload_half)
+  {
+    size_t base = PARG(1);
+    unsigned int addressSpace = ARG(1)->getType()->getPointerAddressSpace();
+    uint64_t offset = UARG(0);
+
+    size_t address;
+    if (fnName.compare(0, 6, "vloada") == 0 && result.num == 3)
+    {
+      address = base + offset * sizeof(cl_half) * 4;
+    }
+    else
+    {
+      address = base + offset * sizeof(cl_half) * result.num;
+    }
+    size_t size = sizeof(cl_half) * result.num;
+    uint16_t* halfData = (uint16_t*)workItem->m_pool.alloc(2 * result.num);
+    workItem->getMemory(addressSpace)
+      ->load((unsigned char*)halfData, address, size);
+
+    // Convert to floats
+    halfToFloat((float*)result.data, halfData, result.num);
+  }
+
+  DEFINE_BUILTIN(vstore_half)
+  {
+    const llvm::Value* value = ARG(0);
+    unsigned size = getTypeSize(value->getType());
+    if (isVector3(value))
+    {
+      // 3-element vectors are same size as 4-element vectors,
+      // but vstore address offset shouldn't use this.
+      size = (size / 4) * 3;
+    }
+
+    size_t base = PARG(2);
+    unsigned int addressSpace = ARG(2)->getType()->getPointerAddressSpace();
+    uint64_t offset = UARG(1);
+
+    // Convert to halfs
+    TypedValue op = workItem->getOperand(value);
+    unsigned char* data = op.data;
+    size = op.num * sizeof(cl_half);
+    uint16_t* halfData = (uint16_t*)workItem->m_pool.alloc(2 * op.num);
+
+    // Parse rounding mode (RTE is the default)
+    cl_half_rounding_mode rmode = CL_HALF_RTE;
+    if (fnName.find("_rtz") != std::string::npos)
+      rmode = CL_HALF_RTZ;
+    else if (fnName.find("_rtn") != std::string::npos)
+      rmode = CL_HALF_RTN;
+    else if (fnName.find("_rtp") != std::string::npos)
+      rmode = CL_HALF_RTP;
+
+    if (op.size == 4)
+    {
+      floatToHalf(halfData, (float*)data, op.num, rmode);
+    }
+    else
+    {
+      for (unsigned i = 0; i < op.num; i++)
+      {
+        halfData[i] = cl_half_from_double(((double*)data)[i], rmode);
+      }
+    }
+
+    size_t address;
+    if (fnName.compare(0, 7, "vstorea") == 0 && op.num == 3)
+    {
+      address = base + offset * sizeof(cl_half) * 4;
+    }
+    else
+    {
+      address = base + offset * sizeof(cl_half) * op.num;
+    }
+
+    workItem->getMemory(addressSpace)
+      ->store((unsigned char*)halfData, address, size);
+  }
+
+  /////////////////////////
   // Work-Item Functions //
   /////////////////////////
 
@@ -3050,283 +4036,193 @@ class WorkItemBuiltins
     result.setUInt(r);
   }
 
-  /////////////////////
-  // Other Functions //
-  /////////////////////
-
-  DEFINE_BUILTIN(astype)
+  DEFINE_BUILTIN(get_sub_group_size)
   {
-    TypedValue src = workItem->getOperand(ARG(0));
-    memcpy(result.data, src.data, src.size * src.num);
+    WorkGroup* workGroup = workItem->m_workGroup;
+    size_t lid = workGroup->getLocalLinearID(workItem);
+    result.setUInt(workGroup->getSubGroupSize(lid / SUB_GROUP_SIZE));
   }
 
-  static void setConvertRoundingMode(const string& name, int def)
+  DEFINE_BUILTIN(get_max_sub_group_size)
   {
-    size_t rpos = name.find("_rt");
-    if (rpos != string::npos)
-    {
-      switch (name[rpos + 3])
-      {
-      case 'e':
-        fesetround(FE_TONEAREST);
-        break;
-      case 'z':
-        fesetround(FE_TOWARDZERO);
-        break;
-      case 'p':
-        fesetround(FE_UPWARD);
-        break;
-      case 'n':
-        fesetround(FE_DOWNWARD);
-        break;
-      default:
-        FATAL_ERROR("Unsupported rounding mode: %c", name[rpos + 3]);
-      }
-    }
-    else
-    {
-      fesetround(def);
-    }
+    Size3 localSize = workItem->m_kernelInvocation->getLocalSize();
+    size_t r = std::min<size_t>(SUB_GROUP_SIZE,
+                           localSize.x * localSize.y * localSize.z);
+    result.setUInt(r);
   }
 
-  DEFINE_BUILTIN(convert_float)
+  DEFINE_BUILTIN(get_num_sub_groups)
   {
-    // Use rounding mode
-    const int origRnd = fegetround();
-    setConvertRoundingMode(fnName, FE_TONEAREST);
+    result.setUInt(workItem->m_workGroup->getNumSubGroups());
+  }
 
-    for (unsigned i = 0; i < result.num; i++)
-    {
-      switch (getOverloadArgType(overload))
-      {
-      case 'h':
-      case 't':
-      case 'j':
-      case 'm':
-      {
-        uint64_t in = UARGV(0, i);
-        if (result.size == 4)
-          result.setFloat(in ? (float)in : 0.f, i);
-        else
-          result.setFloat(in ? (double)in : 0.0, i);
-        break;
-      }
-      case 'c':
-      case 's':
-      case 'i':
-      case 'l':
-        result.setFloat(SARGV(0, i), i);
-        break;
-      case 'f':
-      case 'd':
-        result.setFloat(FARGV(0, i), i);
-        break;
-      default:
-        FATAL_ERROR("Unsupported argument type: %c",
-                    getOverloadArgType(overload));
-      }
-    }
-    fesetround(origRnd);
+  DEFINE_BUILTIN(get_enqueued_num_sub_groups)
+  {
+    Size3 localSize = workItem->m_kernelInvocation->getLocalSize();
+    size_t r = (localSize.x * localSize.y * localSize.z + SUB_GROUP_SIZE - 1) /
+               SUB_GROUP_SIZE;
+    result.setUInt(r);
   }
 
-  DEFINE_BUILTIN(convert_half)
+  DEFINE_BUILTIN(get_sub_group_id)
   {
-    float f;
-    cl_half_rounding_mode rmode = CL_HALF_RTE;
-    if (fnName.find("_rtz") != std::string::npos)
-      rmode = CL_HALF_RTZ;
-    else if (fnName.find("_rtn") != std::string::npos)
-      rmode = CL_HALF_RTN;
-    else if (fnName.find("_rtp") != std::string::npos)
-      rmode = CL_HALF_RTP;
-    const char srcType = getOverloadArgType(overload);
-    for (unsigned i = 0; i < result.num; i++)
-    {
-      switch (srcType)
-      {
-      case 'h':
-      case 't':
-      case 'j':
-      case 'm':
-        f = (float)UARGV(0, i);
-        break;
-      case 'c':
-      case 's':
-      case 'i':
-      case 'l':
-        f = (float)SARGV(0, i);
-        break;
-      case 'd':
-      case 'f':
-        f = FARGV(0, i);
-        break;
-      default:
-        FATAL_ERROR("Unsupported argument type: %c",
-                    getOverloadArgType(overload));
-      }
-      result.setUInt(cl_half_from_float(f, rmode), i);
-    }
+    size_t lid = workItem->m_workGroup->getLocalLinearID(workItem);
+    result.setUInt(lid / SUB_GROUP_SIZE);
   }
 
-  DEFINE_BUILTIN(convert_uint)
+  DEFINE_BUILTIN(get_sub_group_local_id)
   {
-    // Check for saturation modifier
-    bool sat = fnName.find("_sat") != string::npos;
-    uint64_t max;
-    switch (result.size)
-    {
-    case 1:
-      max = UINT8_MAX;
-      break;
-    case 2:
-      max = UINT16_MAX;
-      break;
-    case 4:
-      max = UINT32_MAX;
-      break;
-    case 8:
-      max = UINT64_MAX;
-      break;
-    default:
-      FATAL_ERROR("Unsupported integer size %d", result.size);
-    }
+    size_t lid = workItem->m_workGroup->getLocalLinearID(workItem);
+    result.setUInt(lid % SUB_GROUP_SIZE);
+  }
 
-    // Use rounding mode
-    const int origRnd = fegetround();
-    setConvertRoundingMode(fnName, FE_TOWARDZERO);
+  /////////////////////
+  // Other Functions //
+  /////////////////////
 
-    for (unsigned i = 0; i < result.num; i++)
-    {
-      uint64_t r;
-      switch (getOverloadArgType(overload))
-      {
-      case 'h':
-      case 't':
-      case 'j':
-      case 'm':
-        r = UARGV(0, i);
-        if (sat)
-        {
-          r = _min_(r, max);
-        }
-        break;
-      case 'c':
-      case 's':
-      case 'i':
-      case 'l':
-      {
-        int64_t si = SARGV(0, i);
-        r = si;
-        if (sat)
-        {
-          if (si < 0)
-          {
-            r = 0;
-          }
-          else if (si > max)
-          {
-            r = max;
-          }
-        }
-        break;
-      }
-      case 'f':
-      case 'd':
-        if (sat)
-        {
-          r = rint(_clamp_((long double)FARGV(0, i), 0.0L, (long double)max));
-        }
-        else
-        {
-          r = rint(FARGV(0, i));
-        }
-        break;
-      default:
-        FATAL_ERROR("Unsupported argument type: %c",
-                    getOverloadArgType(overload));
-      }
+  DEFINE_BUILTIN(astype)
+  {
+    TypedValue src = workItem->getOperand(ARG(0));
+    memcpy(result.data, src.data, src.size * src.num);
+  }
 
-      result.setUInt(r, i);
+  // Conversions are specialised for each combination of types, rounding
+  // mode and saturation when they are resolved, so that no per-element type
+  // dispatch or changes to the floating point environment are needed
+  template <typename Dst, typename Src, int Rnd, bool Sat>
+  static void convert(WorkItem* workItem, const llvm::CallInst* callInst,
+                      const string& fnName, const string& overload,
+                      TypedValue& result, void*)
+  {
+    const Src* src = (const Src*)workItem->getOperand(ARG(0)).data;
+    ArrayConverter<Dst, Src, Rnd, Sat>::convert((Dst*)result.data, src,
+                                                result.num);
+  }
+
+  template <typename Dst, typename Src>
+  static BuiltinFunction getConvertBuiltin(int rnd, bool sat)
+  {
+    switch (rnd)
+    {
+    case RTZ:
+      return BuiltinFunction(sat ? convert<Dst, Src, RTZ, true>
+                                 : convert<Dst, Src, RTZ, false>,
+                             NULL);
+    case RTP:
+      return BuiltinFunction(sat ? convert<Dst, Src, RTP, true>
+                                 : convert<Dst, Src, RTP, false>,
+                             NULL);
+    case RTN:
+      return BuiltinFunction(sat ? convert<Dst, Src, RTN, true>
+                                 : convert<Dst, Src, RTN, false>,
+                             NULL);
+    default:
+      return BuiltinFunction(sat ? convert<Dst, Src, RTE, true>
+                                 : convert<Dst, Src, RTE, false>,
+                             NULL);
     }
-    fesetround(origRnd);
   }
 
-  DEFINE_BUILTIN(convert_sint)
+  template <typename Dst>
+  static BuiltinFunction getConvertBuiltin(char srcType, int rnd, bool sat)
   {
-    // Check for saturation modifier
-    bool sat = fnName.find("_sat") != string::npos;
-    int64_t min, max;
-    switch (result.size)
+    switch (srcType)
     {
-    case 1:
-      min = INT8_MIN;
-      max = INT8_MAX;
-      break;
-    case 2:
-      min = INT16_MIN;
-      max = INT16_MAX;
-      break;
-    case 4:
-      min = INT32_MIN;
-      max = INT32_MAX;
-      break;
-    case 8:
-      min = INT64_MIN;
-      max = INT64_MAX;
-      break;
+    case 'c':
+      return getConvertBuiltin<Dst, int8_t>(rnd, sat);
+    case 'h':
+      return getConvertBuiltin<Dst, uint8_t>(rnd, sat);
+    case 's':
+      return getConvertBuiltin<Dst, int16_t>(rnd, sat);
+    case 't':
+      return getConvertBuiltin<Dst, uint16_t>(rnd, sat);
+    case 'i':
+      return getConvertBuiltin<Dst, int32_t>(rnd, sat);
+    case 'j':
+      return getConvertBuiltin<Dst, uint32_t>(rnd, sat);
+    case 'l':
+      return getConvertBuiltin<Dst, int64_t>(rnd, sat);
+    case 'm':
+      return getConvertBuiltin<Dst, uint64_t>(rnd, sat);
+    case 'f':
+      return getConvertBuiltin<Dst, float>(rnd, sat);
+    case 'd':
+      return getConvertBuiltin<Dst, double>(rnd, sat);
+    case 'H':
+      return getConvertBuiltin<Dst, Half>(rnd, sat);
     default:
-      FATAL_ERROR("Unsupported integer size %d", result.size);
+      FATAL_ERROR("Unsupported argument type: %c", srcType);
     }
+  }
 
-    // Use rounding mode
-    const int origRnd = fegetround();
-    setConvertRoundingMode(fnName, FE_TOWARDZERO);
+  static BuiltinFunction specializeConvert(const string& name,
+                                           const string& overload)
+  {
+    // Get element type of argument, using 'H' for half
+    size_t start = 0;
+    if (overload.compare(0, 2, "Dv") == 0)
+      start = overload.find('_') + 1;
+    char srcType = overload[start];
+    if (overload.compare(start, 2, "Dh") == 0)
+      srcType = 'H';
 
-    for (unsigned i = 0; i < result.num; i++)
+    // Names are convert_<type>[n][_sat][_<rounding>]
+    size_t typeStart = strlen("convert_");
+    size_t typeEnd = name.find_first_of("0123456789_", typeStart);
+    string dstType = name.substr(typeStart, typeEnd - typeStart);
+    bool sat = name.find("_sat") != string::npos;
+    bool isFloat =
+      dstType == "float" || dstType == "double" || dstType == "half";
+    int rnd = isFloat ? RTE : RTZ;
+    size_t rpos = name.find("_rt");
+    if (rpos != string::npos)
     {
-      int64_t r;
-      switch (getOverloadArgType(overload))
+      switch (name[rpos + 3])
       {
-      case 'h':
-      case 't':
-      case 'j':
-      case 'm':
-        r = UARGV(0, i);
-        if (sat)
-        {
-          r = _min_((uint64_t)r, (uint64_t)max);
-        }
+      case 'e':
+        rnd = RTE;
         break;
-      case 'c':
-      case 's':
-      case 'i':
-      case 'l':
-        r = SARGV(0, i);
-        if (sat)
-        {
-          r = _clamp_(r, min, max);
-        }
+      case 'z':
+        rnd = RTZ;
         break;
-      case 'f':
-      case 'd':
-        if (sat)
-        {
-          r = rint(_clamp_((long double)FARGV(0, i), (long double)min,
-                           (long double)max));
-        }
-        else
-        {
-          r = rint(FARGV(0, i));
-        }
+      case 'p':
+        rnd = RTP;
+        break;
+      case 'n':
+        rnd = RTN;
         break;
       default:
-        FATAL_ERROR("Unsupported argument type: %c",
-                    getOverloadArgType(overload));
+        FATAL_ERROR("Unsupported rounding mode: %c", name[rpos + 3]);
       }
-
-      result.setSInt(r, i);
     }
-    fesetround(origRnd);
+
+    // Rounding only affects conversions that can be inexact
+    if (!isFloat && srcType != 'f' && srcType != 'd' && srcType != 'H')
+      rnd = RTZ;
+
+    if (dstType == "char")
+      return getConvertBuiltin<int8_t>(srcType, rnd, sat);
+    else if (dstType == "uchar")
+      return getConvertBuiltin<uint8_t>(srcType, rnd, sat);
+    else if (dstType == "short")
+      return getConvertBuiltin<int16_t>(srcType, rnd, sat);
+    else if (dstType == "ushort")
+      return getConvertBuiltin<uint16_t>(srcType, rnd, sat);
+    else if (dstType == "int")
+      return getConvertBuiltin<int32_t>(srcType, rnd, sat);
+    else if (dstType == "uint")
+      return getConvertBuiltin<uint32_t>(srcType, rnd, sat);
+    else if (dstType == "long")
+      return getConvertBuiltin<int64_t>(srcType, rnd, sat);
+    else if (dstType == "ulong")
+      return getConvertBuiltin<uint64_t>(srcType, rnd, sat);
+    else if (dstType == "float")
+      return getConvertBuiltin<float>(srcType, rnd, false);
+    else if (dstType == "double")
+      return getConvertBuiltin<double>(srcType, rnd, false);
+    else if (dstType == "half")
+      return getConvertBuiltin<Half>(srcType, rnd, false);
+    FATAL_ERROR("Unsupported conversion: %s", name.c_str());
   }
 
   DEFINE_BUILTIN(printf_builtin)
@@ -3568,9 +4464,12 @@ public:
 #define ADD_PREFIX_BUILTIN(name, func, op)                                     \
   workItemPrefixBuiltins.push_back(                                            \
     make_pair(name, BuiltinFunction((CAST)func, (void*)op)));
+#define ADD_SPECIALIZED_BUILTIN(name, specializer)                             \
+  workItemBuiltinSpecializers.push_back(make_pair(name, specializer));
 
 // Generate builtin function map
 BuiltinFunctionPrefixList workItemPrefixBuiltins;
+BuiltinSpecializerList workItemBuiltinSpecializers;
 BuiltinFunctionMap workItemBuiltins = WorkItemBuiltins::initBuiltins();
 BuiltinFunctionMap WorkItemBuiltins::initBuiltins()
 {
@@ -3792,6 +4691,74 @@ BuiltinFunctionMap WorkItemBuiltins::initBuiltins()
   ADD_BUILTIN("read_mem_fence", mem_fence, NULL);
   ADD_BUILTIN("write_mem_fence", mem_fence, NULL);
 
+  // Work-Group and Sub-Group Collective Functions
+  ADD_BUILTIN("work_group_all", group_collective, NULL);
+  ADD_BUILTIN("work_group_any", group_collective, NULL);
+  ADD_BUILTIN("work_group_broadcast", group_collective, NULL);
+  ADD_BUILTIN("work_group_reduce_add", group_collective, NULL);
+  ADD_BUILTIN("work_group_reduce_min", group_collective, NULL);
+  ADD_BUILTIN("work_group_reduce_max", group_collective, NULL);
+  ADD_BUILTIN("work_group_scan_exclusive_add", group_collective, NULL);
+  ADD_BUILTIN("work_group_scan_exclusive_min", group_collective, NULL);
+  ADD_BUILTIN("work_group_scan_exclusive_max", group_collective, NULL);
+  ADD_BUILTIN("work_group_scan_inclusive_add", group_collective, NULL);
+  ADD_BUILTIN("work_group_scan_inclusive_min", group_collective, NULL);
+  ADD_BUILTIN("work_group_scan_inclusive_max", group_collective, NULL);
+  ADD_BUILTIN("sub_group_all", group_collective, NULL);
+  ADD_BUILTIN("sub_group_any", group_collective, NULL);
+  ADD_BUILTIN("sub_group_broadcast", group_collective, NULL);
+  ADD_BUILTIN("sub_group_reduce_add", group_collective, NULL);
+  ADD_BUILTIN("sub_group_reduce_min", group_collective, NULL);
+  ADD_BUILTIN("sub_group_reduce_max", group_collective, NULL);
+  ADD_BUILTIN("sub_group_scan_exclusive_add", group_collective, NULL);
+  ADD_BUILTIN("sub_group_scan_exclusive_min", group_collective, NULL);
+  ADD_BUILTIN("sub_group_scan_exclusive_max", group_collective, NULL);
+  ADD_BUILTIN("sub_group_scan_inclusive_add", group_collective, NULL);
+  ADD_BUILTIN("sub_group_scan_inclusive_min", group_collective, NULL);
+  ADD_BUILTIN("sub_group_scan_inclusive_max", group_collective, NULL);
+  ADD_BUILTIN("sub_group_barrier", group_collective, NULL);
+
+  // Pipe Functions
+  ADD_BUILTIN("__read_pipe_2", pipe_access, NULL);
+  ADD_BUILTIN("__read_pipe_4", pipe_access, NULL);
+  ADD_BUILTIN("__write_pipe_2", pipe_access, NULL);
+  ADD_BUILTIN("__write_pipe_4", pipe_access, NULL);
+  ADD_BUILTIN("__reserve_read_pipe", pipe_reserve, NULL);
+  ADD_BUILTIN("__reserve_write_pipe", pipe_reserve, NULL);
+  ADD_BUILTIN("__commit_read_pipe", pipe_commit, NULL);
+  ADD_BUILTIN("__commit_write_pipe", pipe_commit, NULL);
+  ADD_BUILTIN("__work_group_reserve_read_pipe", group_pipe, NULL);
+  ADD_BUILTIN("__work_group_reserve_write_pipe", group_pipe, NULL);
+  ADD_BUILTIN("__work_group_commit_read_pipe", group_pipe, NULL);
+  ADD_BUILTIN("__work_group_commit_write_pipe", group_pipe, NULL);
+  ADD_BUILTIN("__sub_group_reserve_read_pipe", group_pipe, NULL);
+  ADD_BUILTIN("__sub_group_reserve_write_pipe", group_pipe, NULL);
+  ADD_BUILTIN("__sub_group_commit_read_pipe", group_pipe, NULL);
+  ADD_BUILTIN("__sub_group_commit_write_pipe", group_pipe, NULL);
+  ADD_BUILTIN("__get_pipe_num_packets_ro", get_pipe_num_packets, NULL);
+  ADD_BUILTIN("__get_pipe_num_packets_wo", get_pipe_num_packets, NULL);
+  ADD_BUILTIN("__get_pipe_max_packets_ro", get_pipe_max_packets, NULL);
+  ADD_BUILTIN("__get_pipe_max_packets_wo", get_pipe_max_packets, NULL);
+  ADD_BUILTIN("is_valid_reserve_id", is_valid_reserve_id, NULL);
+
+  // Enqueue Kernel Functions
+  ADD_BUILTIN("__enqueue_kernel_basic", enqueue_kernel, NULL);
+  ADD_BUILTIN("__enqueue_kernel_basic_events", enqueue_kernel, NULL);
+  ADD_BUILTIN("__enqueue_kernel_varargs", enqueue_kernel, NULL);
+  ADD_BUILTIN("__enqueue_kernel_events_varargs", enqueue_kernel, NULL);
+  ADD_BUILTIN("enqueue_marker", enqueue_marker, NULL);
+  ADD_BUILTIN("get_default_queue", get_default_queue, NULL);
+  ADD_BUILTIN("ndrange_1D", ndrange, NULL);
+  ADD_BUILTIN("ndrange_2D", ndrange, NULL);
+  ADD_BUILTIN("ndrange_3D", ndrange, NULL);
+  ADD_BUILTIN("create_user_event", create_user_event, NULL);
+  ADD_BUILTIN("is_valid_event", is_valid_event, NULL);
+  ADD_BUILTIN("capture_event_profiling_info", capture_event_profiling_info,
+              NULL);
+  ADD_BUILTIN("retain_event", event_noop, NULL);
+  ADD_BUILTIN("release_event", event_noop, NULL);
+  ADD_BUILTIN("set_user_event_status", event_noop, NULL);
+
   // Vector Data Load and Store Functions
   ADD_PREFIX_BUILTIN("vload_half", vload_half, NULL);
   ADD_PREFIX_BUILTIN("vloada_half", vload_half, NULL);
@@ -3812,14 +4779,17 @@ BuiltinFunctionMap WorkItemBuiltins::initBuiltins()
   ADD_BUILTIN("get_global_linear_id", get_global_linear_id, NULL);
   ADD_BUILTIN("get_local_linear_id", get_local_linear_id, NULL);
   ADD_BUILTIN("get_enqueued_local_size", get_enqueued_local_size, NULL);
+  ADD_BUILTIN("get_sub_group_size", get_sub_group_size, NULL);
+  ADD_BUILTIN("get_max_sub_group_size", get_max_sub_group_size, NULL);
+  ADD_BUILTIN("get_num_sub_groups", get_num_sub_groups, NULL);
+  ADD_BUILTIN("get_enqueued_num_sub_groups", get_enqueued_num_sub_groups,
+              NULL);
+  ADD_BUILTIN("get_sub_group_id", get_sub_group_id, NULL);
+  ADD_BUILTIN("get_sub_group_local_id", get_sub_group_local_id, NULL);
 
   // Other Functions
   ADD_PREFIX_BUILTIN("as_", astype, NULL);
-  ADD_PREFIX_BUILTIN("convert_half", convert_half, NULL);
-  ADD_PREFIX_BUILTIN("convert_float", convert_float, NULL);
-  ADD_PREFIX_BUILTIN("convert_double", convert_float, NULL);
-  ADD_PREFIX_BUILTIN("convert_u", convert_uint, NULL);
-  ADD_PREFIX_BUILTIN("convert_", convert_sint, NULL);
+  ADD_SPECIALIZED_BUILTIN("convert_", specializeConvert);
   ADD_BUILTIN("printf", printf_builtin, NULL);
 
   // LLVM Intrinsics
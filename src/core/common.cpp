@@ -15,6 +15,13 @@
 #include <sys/time.h>
 #endif
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define HAVE_F16C_DISPATCH 1
+#include <immintrin.h>
+#else
+#define HAVE_F16C_DISPATCH 0
+#endif
+
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/Operator.h"
@@ -302,6 +309,88 @@ unsigned getEnvInt(const char* var, int def, bool allowZero)
   return result;
 }
 
+#if HAVE_F16C_DISPATCH
+// Check once whether the host supports the F16C conversion instructions
+static bool hasF16C()
+{
+  static const bool f16c =
+    __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+  return f16c;
+}
+
+__attribute__((target("avx,f16c"))) static size_t
+halfToFloatF16C(float* dst, const cl_half* src, size_t num)
+{
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8)
+  {
+    __m128i h = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+  return i;
+}
+
+template <int Rounding>
+__attribute__((target("avx,f16c"))) static size_t
+floatToHalfF16C(cl_half* dst, const float* src, size_t num)
+{
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8)
+  {
+    __m256 f = _mm256_loadu_ps(src + i);
+    _mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(f, Rounding));
+  }
+  return i;
+}
+#endif
+
+void halfToFloat(float* dst, const cl_half* src, size_t num)
+{
+  size_t i = 0;
+#if HAVE_F16C_DISPATCH
+  if (hasF16C())
+    i = halfToFloatF16C(dst, src, num);
+#endif
+
+  // Convert any remaining values one at a time
+  for (; i < num; i++)
+  {
+    dst[i] = cl_half_to_float(src[i]);
+  }
+}
+
+void floatToHalf(cl_half* dst, const float* src, size_t num,
+                 cl_half_rounding_mode rounding)
+{
+  size_t i = 0;
+#if HAVE_F16C_DISPATCH
+  if (hasF16C())
+  {
+    switch (rounding)
+    {
+    case CL_HALF_RTE:
+      i = floatToHalfF16C<_MM_FROUND_TO_NEAREST_INT>(dst, src, num);
+      break;
+    case CL_HALF_RTZ:
+      i = floatToHalfF16C<_MM_FROUND_TO_ZERO>(dst, src, num);
+      break;
+    case CL_HALF_RTP:
+      i = floatToHalfF16C<_MM_FROUND_TO_POS_INF>(dst, src, num);
+      break;
+    case CL_HALF_RTN:
+      i = floatToHalfF16C<_MM_FROUND_TO_NEG_INF>(dst, src, num);
+      break;
+    }
+  }
+#endif
+
+  // Convert any remaining values one at a time
+  for (; i < num; i++)
+  {
+    dst[i] = cl_half_from_float(src[i], rounding);
+  }
+}
+
 void dumpInstruction(ostream& out, const llvm::Instruction* instruction)
 {
   llvm::raw_os_ostream stream(out);
@@ -402,6 +491,14 @@ void getConstantData(unsigned char* data, const llvm::Constant* constant)
   }
   case llvm::Type::PointerTyID:
   {
+    // Function pointers (used for blocks) refer to the function itself
+    auto function =
+      llvm::dyn_cast<llvm::Function>(constant->stripPointerCasts());
+    if (function)
+    {
+      *(size_t*)data = (size_t)function;
+      break;
+    }
     if (constant->getValueID() != llvm::Value::ConstantPointerNullVal)
     {
       FATAL_ERROR("Unsupported constant pointer value: %d",
@@ -447,6 +544,7 @@ llvm::Instruction* getConstExprAsInstruction(const llvm::ConstantExpr* expr)
   case llvm::Instruction::PtrToInt:
   case llvm::Instruction::IntToPtr:
   case llvm::Instruction::BitCast:
+  case llvm::Instruction::AddrSpaceCast:
     return llvm::CastInst::Create((llvm::Instruction::CastOps)opcode,
                                   operands[0], expr->getType());
   case llvm::Instruction::Select:
@@ -481,8 +579,6 @@ llvm::Instruction* getConstExprAsInstruction(const llvm::ConstantExpr* expr)
     return llvm::CmpInst::Create((llvm::Instruction::OtherOps)opcode,
                                  (llvm::CmpInst::Predicate)expr->getPredicate(),
                                  operands[0], operands[1]);
-  case llvm::Instruction::AddrSpaceCast:
-    FATAL_ERROR("Unsupported constant expression: addrspacecast");
   default:
     assert(expr->getNumOperands() == 2 && "Must be binary operator?");
 
@@ -646,6 +742,16 @@ unsigned getTypeAlignment(const llvm::Type* type)
   return getTypeSize(type);
 }
 
+string getUnmangledName(const string& name)
+{
+  if (name.compare(0, 2, "_Z") != 0)
+    return name;
+
+  int len = atoi(name.c_str() + 2);
+  int start = name.find_first_not_of("0123456789", 2);
+  return name.substr(start, len);
+}
+
 pair<unsigned, unsigned> getValueSize(const llvm::Value* value)
 {
   unsigned bits, numElements;
@@ -11,6 +11,7 @@
 
 #define CL_TARGET_OPENCL_VERSION 300
 #include "CL/cl.h"
+#include "CL/cl_half.h"
 
 #include <cassert>
 #include <cstdio>
@@ -57,6 +58,16 @@
 #define CLK_FILTER_NEAREST 0x0010
 #define CLK_FILTER_LINEAR 0x0020
 
+#define CLK_SUCCESS 0
+#define CLK_ENQUEUE_FAILURE -101
+#define CLK_INVALID_QUEUE -102
+#define CLK_INVALID_NDRANGE -160
+#define CLK_INVALID_EVENT_WAIT_LIST -57
+#define CLK_INVALID_ARG_SIZE -51
+
+// Number of work-items in each (full) sub-group
+#define SUB_GROUP_SIZE 32
+
 namespace llvm
 {
 class Constant;
@@ -80,6 +91,7 @@ enum AddressSpace
   AddrSpaceGlobal = 1,
   AddrSpaceConstant = 2,
   AddrSpaceLocal = 3,
+  AddrSpaceGeneric = 4,
 };
 
 enum AtomicOp
@@ -155,12 +167,33 @@ struct Image
   cl_image_desc desc;
 };
 
+// Pipe object header, stored at the start of a pipe's buffer
+// The header is followed by a sequence number for each packet slot, with the
+// packet data itself starting at packetOffset. The number of slots is a power
+// of two no smaller than maxPackets.
+struct Pipe
+{
+  uint32_t packetSize;
+  uint32_t maxPackets;
+  uint32_t numSlots;
+  uint32_t packetOffset;
+  uint32_t writeIndex;
+  uint32_t readIndex;
+};
+
 // Check if an environment variable is set to 1
 bool checkEnv(const char* var);
 
 // Get an environment variable as an integer
 unsigned getEnvInt(const char* var, int def = 0, bool allowZero = true);
 
+// Convert an array of half precision values to single precision
+void halfToFloat(float* dst, const cl_half* src, size_t num);
+
+// Convert an array of single precision values to half precision
+void floatToHalf(cl_half* dst, const float* src, size_t num,
+                 cl_half_rounding_mode rounding);
+
 // Output an instruction in human-readable format
 void dumpInstruction(std::ostream& out, const llvm::Instruction* instruction);
 
@@ -185,6 +218,9 @@ unsigned getTypeSize(const llvm::Type* type);
 /// Returns the alignment requirements of this type
 unsigned getTypeAlignment(const llvm::Type* type);
 
+// Returns the name of a function with any Itanium name mangling removed
+std::string getUnmangledName(const std::string& name);
+
 // Returns the size of a value
 std::pair<unsigned, unsigned> getValueSize(const llvm::Value* value);
 
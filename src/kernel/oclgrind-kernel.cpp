@@ -48,7 +48,16 @@ static bool parseArguments(int argc, char* argv[])
 {
   for (int i = 1; i < argc; i++)
   {
-    if (!strcmp(argv[i], "--build-options"))
+    if (!strcmp(argv[i], "--analysis-threads"))
+    {
+      if (++i >= argc)
+      {
+        cerr << "Missing argument to --analysis-threads" << endl;
+        return false;
+      }
+      setEnvironment("OCLGRIND_ANALYSIS_THREADS", argv[i]);
+    }
+    else if (!strcmp(argv[i], "--build-options"))
     {
       if (++i >= argc)
       {
@@ -57,6 +66,10 @@ static bool parseArguments(int argc, char* argv[])
       }
       setEnvironment("OCLGRIND_BUILD_OPTIONS", argv[i]);
     }
+    else if (!strcmp(argv[i], "--cache-sim"))
+    {
+      setEnvironment("OCLGRIND_CACHE_SIM", "1");
+    }
     else if (!strcmp(argv[i], "--compute-units"))
     {
       if (++i >= argc)
@@ -83,10 +96,18 @@ static bool parseArguments(int argc, char* argv[])
     {
       setEnvironment("OCLGRIND_DISABLE_PCH", "1");
     }
+    else if (!strcmp(argv[i], "--divergence"))
+    {
+      setEnvironment("OCLGRIND_DIVERGENCE", "1");
+    }
     else if (!strcmp(argv[i], "--dump-spir"))
     {
       setEnvironment("OCLGRIND_DUMP_SPIR", "1");
     }
+    else if (!strcmp(argv[i], "--fibers"))
+    {
+      setEnvironment("OCLGRIND_FIBERS", "1");
+    }
     else if (!strcmp(argv[i], "-g") || !strcmp(argv[i], "--global-mem"))
     {
       outputGlobalMemory = true;
@@ -113,6 +134,10 @@ static bool parseArguments(int argc, char* argv[])
     {
       setEnvironment("OCLGRIND_INTERACTIVE", "1");
     }
+    else if (!strcmp(argv[i], "--interpreter-opt"))
+    {
+      setEnvironment("OCLGRIND_INTERPRETER_OPT", "1");
+    }
     else if (!strcmp(argv[i], "--local-mem-size"))
     {
       if (++i >= argc)
@@ -149,6 +174,15 @@ static bool parseArguments(int argc, char* argv[])
       }
       setEnvironment("OCLGRIND_MAX_WGSIZE", argv[i]);
     }
+    else if (!strcmp(argv[i], "--mem-trace"))
+    {
+      if (++i >= argc)
+      {
+        cerr << "Missing argument to --mem-trace" << endl;
+        return false;
+      }
+      setEnvironment("OCLGRIND_MEM_TRACE", argv[i]);
+    }
     else if (!strcmp(argv[i], "--num-threads"))
     {
       if (++i >= argc)
@@ -167,6 +201,10 @@ static bool parseArguments(int argc, char* argv[])
       }
       setEnvironment("OCLGRIND_PCH_DIR", argv[i]);
     }
+    else if (!strcmp(argv[i], "--perf-model"))
+    {
+      setEnvironment("OCLGRIND_PERF_MODEL", "1");
+    }
     else if (!strcmp(argv[i], "--plugins"))
     {
       if (++i >= argc)
@@ -180,6 +218,20 @@ static bool parseArguments(int argc, char* argv[])
     {
       setEnvironment("OCLGRIND_QUICK", "1");
     }
+    else if (!strcmp(argv[i], "--roofline"))
+    {
+      setEnvironment("OCLGRIND_ROOFLINE", "1");
+    }
+    else if (!strcmp(argv[i], "--roofline-json"))
+    {
+      if (++i >= argc)
+      {
+        cerr << "Missing argument to --roofline-json" << endl;
+        return false;
+      }
+      setEnvironment("OCLGRIND_ROOFLINE", "1");
+      setEnvironment("OCLGRIND_ROOFLINE_JSON", argv[i]);
+    }
     else if (!strcmp(argv[i], "--uniform-writes"))
     {
       setEnvironment("OCLGRIND_UNIFORM_WRITES", "1");
@@ -234,9 +286,15 @@ static void printUsage()
        << "       oclgrind-kernel [--help | --version]" << endl
        << endl
        << "Options:" << endl
+       << "  --analysis-threads  NUM      "
+          "Set the number of threads used by decoupled plugins"
+       << endl
        << "  --build-options     OPTIONS  "
           "Additional options to pass to the OpenCL compiler"
        << endl
+       << "  --cache-sim                  "
+          "Simulate L1/L2 caches for global memory accesses"
+       << endl
        << "  --compute-units     UNITS    "
           "Change the number of compute units reported"
        << endl
@@ -249,9 +307,15 @@ static void printUsage()
        << "  --disable-pch                "
           "Don't use precompiled headers"
        << endl
+       << "  --divergence                 "
+          "Report branch divergence and SIMD efficiency"
+       << endl
        << "  --dump-spir                  "
           "Dump SPIR to /tmp/oclgrind_*.{ll,bc}"
        << endl
+       << "  --fibers                     "
+          "Run work-items on fibers (user-space threads)"
+       << endl
        << "  --global-mem [-g]            "
           "Output global memory at exit"
        << endl
@@ -267,6 +331,9 @@ static void printUsage()
        << "  --interactive [-i]           "
           "Enable interactive mode"
        << endl
+       << "  --interpreter-opt            "
+          "Run extra passes to reduce interpreter overhead"
+       << endl
        << "  --local-mem-size    BYTES    "
           "Change the local memory size of the device"
        << endl
@@ -279,18 +346,30 @@ static void printUsage()
        << "  --max-wgsize        WGSIZE   "
           "Change the maximum work-group size of the device"
        << endl
+       << "  --mem-trace         FILE     "
+          "Write a trace of memory accesses to a file"
+       << endl
        << "  --num-threads       NUM      "
           "Set the number of worker threads to use"
        << endl
        << "  --pch-dir           DIR      "
           "Override directory containing precompiled headers"
        << endl
+       << "  --perf-model                 "
+          "Estimate device execution times of kernels"
+       << endl
        << "  --plugins           PLUGINS  "
           "Load colon separated list of plugin libraries"
        << endl
        << "  --quick [-q]                 "
           "Only run first and last work-group"
        << endl
+       << "  --roofline                   "
+          "Report arithmetic intensity and roofline position"
+       << endl
+       << "  --roofline-json     FILE     "
+          "Also write roofline data for each kernel as JSON"
+       << endl
        << "  --uniform-writes             "
           "Don't suppress uniform write-write data-races"
        << endl
@@ -0,0 +1,270 @@
+// BranchDivergence.cpp (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#include "core/common.h"
+
+#include <algorithm>
+
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Instructions.h"
+
+#include "BranchDivergence.h"
+
+#include "core/Kernel.h"
+#include "core/KernelInvocation.h"
+#include "core/WorkGroup.h"
+#include "core/WorkItem.h"
+
+using namespace oclgrind;
+using namespace std;
+
+// Number of branches and source lines to list in the report
+#define NUM_REPORTED_ENTRIES 10
+
+THREAD_LOCAL BranchDivergence::WorkerState* BranchDivergence::m_state = NULL;
+
+static unsigned getLine(const llvm::Instruction* instruction)
+{
+  llvm::MDNode* md = instruction->getMetadata("dbg");
+  return md ? ((llvm::DILocation*)md)->getLine() : 0;
+}
+
+// Get the index of the successor taken by a conditional branch or switch
+static uint32_t getBranchOutcome(const WorkItem* workItem,
+                                 const llvm::Instruction* instruction)
+{
+  if (auto branch = llvm::dyn_cast<llvm::BranchInst>(instruction))
+  {
+    return workItem->getOperand(branch->getCondition()).getUInt() ? 0 : 1;
+  }
+
+  auto sw = llvm::cast<llvm::SwitchInst>(instruction);
+  uint64_t value = workItem->getOperand(sw->getCondition()).getUInt();
+  for (auto c : sw->cases())
+  {
+    if (c.getCaseValue()->getZExtValue() == value)
+      return c.getSuccessorIndex();
+  }
+  return 0;
+}
+
+BranchDivergence::BranchDivergence(const Context* context) : Plugin(context)
+{
+  m_simdWidth = getEnvInt("OCLGRIND_SIMD_WIDTH", 32, false);
+}
+
+void BranchDivergence::instructionExecuted(const WorkItem* workItem,
+                                           const llvm::Instruction* instruction,
+                                           const TypedValue& result)
+{
+  size_t lane = workItem->getWorkGroup()->getLocalLinearID(workItem);
+
+  vector<uint32_t>& counts = m_state->counts[instruction];
+  if (counts.empty())
+    counts.resize(m_state->groupSize);
+  counts[lane]++;
+
+  // Record the path taken at conditional branches
+  bool conditional = false;
+  if (auto branch = llvm::dyn_cast<llvm::BranchInst>(instruction))
+    conditional = branch->isConditional();
+  else if (llvm::isa<llvm::SwitchInst>(instruction))
+    conditional = true;
+  if (conditional)
+  {
+    vector<vector<uint32_t>>& outcomes = m_state->outcomes[instruction];
+    if (outcomes.empty())
+      outcomes.resize(m_state->groupSize);
+    outcomes[lane].push_back(getBranchOutcome(workItem, instruction));
+  }
+}
+
+void BranchDivergence::kernelBegin(const KernelInvocation* kernelInvocation)
+{
+  m_branches.clear();
+  m_lines.clear();
+}
+
+void BranchDivergence::kernelEnd(const KernelInvocation* kernelInvocation)
+{
+  size_t laneInstructions = 0;
+  size_t issuedInstructions = 0;
+  for (auto& line : m_lines)
+  {
+    laneInstructions += line.second.laneInstructions;
+    issuedInstructions += line.second.issuedInstructions;
+  }
+
+  // Load default locale
+  locale previousLocale = cout.getloc();
+  locale defaultLocale("");
+  cout.imbue(defaultLocale);
+
+  cout << "Branch divergence for kernel '"
+       << kernelInvocation->getKernel()->getName() << "' (SIMD width "
+       << m_simdWidth << "):" << endl;
+  cout << fixed << setprecision(2);
+  cout << setw(16)
+       << (issuedInstructions
+             ? 100.0 * laneInstructions / (issuedInstructions * m_simdWidth)
+             : 100.0)
+       << "% - SIMD efficiency" << endl;
+  cout << endl;
+
+  // Output the branches that diverged most often
+  typedef pair<const llvm::Instruction*, BranchStats> NamedBranch;
+  vector<NamedBranch> branches;
+  for (auto& branch : m_branches)
+  {
+    if (branch.second.divergent)
+      branches.push_back(branch);
+  }
+  std::sort(branches.begin(), branches.end(),
+            [](const NamedBranch& a, const NamedBranch& b) {
+              return a.second.divergent > b.second.divergent;
+            });
+  if (branches.size() > NUM_REPORTED_ENTRIES)
+    branches.resize(NUM_REPORTED_ENTRIES);
+
+  cout << "Divergent branches:" << endl;
+  for (auto& branch : branches)
+  {
+    cout << setw(16)
+         << 100.0 * branch.second.divergent / branch.second.executions
+         << "% - (" << branch.second.divergent << " of "
+         << branch.second.executions << " warp executions)";
+    unsigned line = getLine(branch.first);
+    if (line)
+      cout << " line " << line;
+    cout << endl;
+
+    cout << setw(19) << "";
+    dumpInstruction(cout, branch.first);
+    cout << endl;
+  }
+  cout << endl;
+
+  // Output the source lines that waste the most SIMD lanes
+  typedef pair<unsigned, LineStats> NamedLine;
+  vector<NamedLine> lines;
+  for (auto& line : m_lines)
+  {
+    if (line.first &&
+        line.second.laneInstructions <
+          line.second.issuedInstructions * m_simdWidth)
+      lines.push_back(line);
+  }
+  unsigned width = m_simdWidth;
+  std::sort(lines.begin(), lines.end(),
+            [width](const NamedLine& a, const NamedLine& b) {
+              return a.second.issuedInstructions * width -
+                       a.second.laneInstructions >
+                     b.second.issuedInstructions * width -
+                       b.second.laneInstructions;
+            });
+  if (lines.size() > NUM_REPORTED_ENTRIES)
+    lines.resize(NUM_REPORTED_ENTRIES);
+
+  cout << "Source lines with the lowest SIMD efficiency:" << endl;
+  for (auto& line : lines)
+  {
+    cout << setw(16)
+         << 100.0 * line.second.laneInstructions /
+              (line.second.issuedInstructions * m_simdWidth)
+         << "% - line " << line.first << endl;
+  }
+  cout << endl;
+
+  // Restore locale and formatting
+  cout.unsetf(ios::floatfield);
+  cout << setprecision(6);
+  cout.imbue(previousLocale);
+}
+
+void BranchDivergence::workGroupBegin(const WorkGroup* workGroup)
+{
+  // Create worker state if haven't already
+  if (!m_state)
+    m_state = new WorkerState;
+
+  m_state->groupSize = workGroup->getLocalLinearSize();
+  m_state->counts.clear();
+  m_state->outcomes.clear();
+}
+
+void BranchDivergence::workGroupComplete(const WorkGroup* workGroup)
+{
+  size_t groupSize = m_state->groupSize;
+
+  // Instructions are issued by a warp as many times as its busiest lane
+  // executes them
+  map<unsigned, LineStats> lines;
+  for (auto& count : m_state->counts)
+  {
+    LineStats& stats = lines[getLine(count.first)];
+    for (size_t warp = 0; warp < groupSize; warp += m_simdWidth)
+    {
+      uint32_t issued = 0;
+      size_t end = min<size_t>(warp + m_simdWidth, groupSize);
+      for (size_t lane = warp; lane < end; lane++)
+      {
+        stats.laneInstructions += count.second[lane];
+        issued = max(issued, count.second[lane]);
+      }
+      stats.issuedInstructions += issued;
+    }
+  }
+
+  // Compare the outcomes of the n-th execution of a branch by each lane
+  unordered_map<const llvm::Instruction*, BranchStats> branches;
+  for (auto& outcomes : m_state->outcomes)
+  {
+    BranchStats& stats = branches[outcomes.first];
+    for (size_t warp = 0; warp < groupSize; warp += m_simdWidth)
+    {
+      size_t end = min<size_t>(warp + m_simdWidth, groupSize);
+      size_t executions = 0;
+      for (size_t lane = warp; lane < end; lane++)
+        executions = max(executions, outcomes.second[lane].size());
+
+      for (size_t n = 0; n < executions; n++)
+      {
+        bool divergent = false;
+        int first = -1;
+        for (size_t lane = warp; lane < end && !divergent; lane++)
+        {
+          const vector<uint32_t>& path = outcomes.second[lane];
+          if (n >= path.size())
+            continue;
+          if (first < 0)
+            first = path[n];
+          else if (path[n] != (uint32_t)first)
+            divergent = true;
+        }
+
+        stats.executions++;
+        if (divergent)
+          stats.divergent++;
+      }
+    }
+  }
+
+  // Merge statistics
+  lock_guard<mutex> lock(m_mtx);
+  for (auto& line : lines)
+  {
+    m_lines[line.first].laneInstructions += line.second.laneInstructions;
+    m_lines[line.first].issuedInstructions += line.second.issuedInstructions;
+  }
+  for (auto& branch : branches)
+  {
+    m_branches[branch.first].executions += branch.second.executions;
+    m_branches[branch.first].divergent += branch.second.divergent;
+  }
+}
@@ -0,0 +1,64 @@
+// BranchDivergence.h (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#include "core/Plugin.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace oclgrind
+{
+// Groups the work-items of each work-group into SIMD warps (by local linear
+// ID) and records how often the lanes of a warp take different paths at
+// each branch. The SIMD efficiency of a warp is estimated by assuming that
+// it issues each instruction as many times as its busiest lane executes it.
+class BranchDivergence : public Plugin
+{
+public:
+  BranchDivergence(const Context* context);
+
+  virtual void instructionExecuted(const WorkItem* workItem,
+                                   const llvm::Instruction* instruction,
+                                   const TypedValue& result) override;
+  virtual void kernelBegin(const KernelInvocation* kernelInvocation) override;
+  virtual void kernelEnd(const KernelInvocation* kernelInvocation) override;
+  virtual void workGroupBegin(const WorkGroup* workGroup) override;
+  virtual void workGroupComplete(const WorkGroup* workGroup) override;
+
+private:
+  unsigned m_simdWidth;
+
+  struct BranchStats
+  {
+    size_t executions;
+    size_t divergent;
+  };
+  struct LineStats
+  {
+    size_t laneInstructions;
+    size_t issuedInstructions;
+  };
+
+  // Statistics for the current kernel
+  std::unordered_map<const llvm::Instruction*, BranchStats> m_branches;
+  std::map<unsigned, LineStats> m_lines;
+  std::mutex m_mtx;
+
+  // Execution counts and branch outcomes of each work-item in a work-group
+  struct WorkerState
+  {
+    size_t groupSize;
+    std::unordered_map<const llvm::Instruction*, std::vector<uint32_t>>
+      counts;
+    std::unordered_map<const llvm::Instruction*,
+                       std::vector<std::vector<uint32_t>>>
+      outcomes;
+  };
+  static THREAD_LOCAL WorkerState* m_state;
+};
+} // namespace oclgrind
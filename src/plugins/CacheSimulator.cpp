@@ -0,0 +1,332 @@
+// CacheSimulator.cpp (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#include "core/common.h"
+
+#include <algorithm>
+
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/Instruction.h"
+
+#include "CacheSimulator.h"
+
+#include "core/Kernel.h"
+#include "core/KernelInvocation.h"
+#include "core/Memory.h"
+#include "core/WorkGroup.h"
+#include "core/WorkItem.h"
+
+using namespace oclgrind;
+using namespace std;
+
+// Number of instructions to list in the per-instruction miss report
+#define NUM_REPORTED_INSTRUCTIONS 10
+
+THREAD_LOCAL vector<CacheSimulator::Access>* CacheSimulator::m_accesses =
+  NULL;
+
+void CacheSimulator::Cache::configure(size_t size, unsigned ways,
+                                      unsigned lineSize)
+{
+  m_ways = ways;
+  m_numSets = max<size_t>(size / ((size_t)ways * lineSize), 1);
+  reset();
+}
+
+bool CacheSimulator::Cache::access(size_t line)
+{
+  size_t set = (line % m_numSets) * m_ways;
+  m_clock++;
+
+  // Look for the line in its set, tracking the least recently used way
+  size_t victim = set;
+  for (size_t way = set; way < set + m_ways; way++)
+  {
+    if (m_tags[way] == line)
+    {
+      m_lastUse[way] = m_clock;
+      return true;
+    }
+    if (m_lastUse[way] < m_lastUse[victim])
+      victim = way;
+  }
+
+  // Replace the least recently used line
+  m_tags[victim] = line;
+  m_lastUse[victim] = m_clock;
+  return false;
+}
+
+void CacheSimulator::Cache::reset()
+{
+  m_tags.assign(m_numSets * m_ways, (size_t)-1);
+  m_lastUse.assign(m_numSets * m_ways, 0);
+  m_clock = 0;
+}
+
+CacheSimulator::CacheSimulator(const Context* context)
+    : Plugin(context),
+      m_lineSize(getEnvInt("OCLGRIND_CACHE_LINE_SIZE", 64, false)),
+      m_computeUnits(getEnvInt("OCLGRIND_COMPUTE_UNITS", 1, false))
+{
+  size_t l1Size = getEnvInt("OCLGRIND_L1_SIZE", 16 * 1024, false);
+  unsigned l1Ways = getEnvInt("OCLGRIND_L1_WAYS", 4, false);
+  for (auto& cu : m_computeUnits)
+  {
+    cu.l1.configure(l1Size, l1Ways, m_lineSize);
+  }
+
+  size_t l2Size = getEnvInt("OCLGRIND_L2_SIZE", 1024 * 1024, false);
+  unsigned l2Ways = getEnvInt("OCLGRIND_L2_WAYS", 16, false);
+  m_l2.configure(l2Size, l2Ways, m_lineSize);
+}
+
+void CacheSimulator::addAccess(const Memory* memory, const WorkItem* workItem,
+                               size_t address, size_t size)
+{
+  if (memory->getAddressSpace() != AddrSpaceGlobal || !size)
+    return;
+
+  const llvm::Instruction* instruction =
+    workItem ? workItem->getCurrentInstruction() : NULL;
+
+  // Record an access to each cache line touched
+  size_t first = address / m_lineSize;
+  size_t last = (address + size - 1) / m_lineSize;
+  for (size_t line = first; line <= last; line++)
+  {
+    m_accesses->push_back({line, instruction});
+  }
+}
+
+void CacheSimulator::kernelBegin(const KernelInvocation* kernelInvocation)
+{
+  for (auto& cu : m_computeUnits)
+  {
+    cu.l1.reset();
+    cu.numAccesses = 0;
+    cu.lastAccess.clear();
+  }
+  m_l2.reset();
+
+  m_numAccesses = 0;
+  m_l1Misses = 0;
+  m_l2Misses = 0;
+  m_coldAccesses = 0;
+  m_reuseDistances.clear();
+  m_stats.clear();
+}
+
+void CacheSimulator::kernelEnd(const KernelInvocation* kernelInvocation)
+{
+  // Load default locale
+  locale previousLocale = cout.getloc();
+  locale defaultLocale("");
+  cout.imbue(defaultLocale);
+
+  cout << "Cache simulation for kernel '"
+       << kernelInvocation->getKernel()->getName() << "':" << endl;
+
+  size_t l2Accesses = m_l1Misses;
+  cout << setw(16) << dec << m_numAccesses << " - global memory accesses ("
+       << m_lineSize << " byte lines)" << endl;
+  cout << setw(16) << m_numAccesses - m_l1Misses << " - L1 hits ("
+       << fixed << setprecision(2)
+       << (m_numAccesses ? 100.0 * (m_numAccesses - m_l1Misses) / m_numAccesses
+                         : 0.0)
+       << "%)" << endl;
+  cout << setw(16) << l2Accesses - m_l2Misses << " - L2 hits ("
+       << (l2Accesses ? 100.0 * (l2Accesses - m_l2Misses) / l2Accesses : 0.0)
+       << "%)" << endl;
+  cout.unsetf(ios::floatfield);
+  cout << endl;
+
+  // Output histogram of reuse distances, in powers of two
+  cout << "Reuse distances (accesses between uses of a line):" << endl;
+  cout << setw(16) << m_coldAccesses << " - first use" << endl;
+  for (unsigned i = 0; i < m_reuseDistances.size(); i++)
+  {
+    if (!m_reuseDistances[i])
+      continue;
+
+    size_t lower = (size_t)1 << i;
+    cout << setw(16) << m_reuseDistances[i] << " - " << lower;
+    if (i > 0)
+      cout << "-" << (lower << 1) - 1;
+    cout << endl;
+  }
+  cout << endl;
+
+  // Output the instructions with the most L1 misses
+  typedef pair<const llvm::Instruction*, InstructionStats> NamedStats;
+  vector<NamedStats> stats(m_stats.begin(), m_stats.end());
+  std::sort(stats.begin(), stats.end(),
+            [](const NamedStats& a, const NamedStats& b) {
+              if (a.second.l1Misses != b.second.l1Misses)
+                return a.second.l1Misses > b.second.l1Misses;
+              return a.second.accesses > b.second.accesses;
+            });
+  if (stats.size() > NUM_REPORTED_INSTRUCTIONS)
+    stats.resize(NUM_REPORTED_INSTRUCTIONS);
+
+  cout << "Instructions with the most L1 misses:" << endl;
+  for (auto& stat : stats)
+  {
+    cout << setw(16) << stat.second.l1Misses << " - (" << stat.second.accesses
+         << " accesses, " << stat.second.l2Misses << " L2 misses)";
+
+    llvm::MDNode* md = stat.first->getMetadata("dbg");
+    if (md)
+      cout << " line " << ((llvm::DILocation*)md)->getLine();
+    cout << endl;
+
+    cout << setw(19) << "";
+    dumpInstruction(cout, stat.first);
+    cout << endl;
+  }
+  cout << endl;
+
+  // Restore locale
+  cout.imbue(previousLocale);
+}
+
+void CacheSimulator::memoryAtomicLoad(const Memory* memory,
+                                      const WorkItem* workItem, AtomicOp op,
+                                      size_t address, size_t size)
+{
+  addAccess(memory, workItem, address, size);
+}
+
+void CacheSimulator::memoryAtomicStore(const Memory* memory,
+                                       const WorkItem* workItem, AtomicOp op,
+                                       size_t address, size_t size)
+{
+  addAccess(memory, workItem, address, size);
+}
+
+void CacheSimulator::memoryLoad(const Memory* memory, const WorkItem* workItem,
+                                size_t address, size_t size)
+{
+  addAccess(memory, workItem, address, size);
+}
+
+void CacheSimulator::memoryLoad(const Memory* memory,
+                                const WorkGroup* workGroup, size_t address,
+                                size_t size)
+{
+  addAccess(memory, NULL, address, size);
+}
+
+void CacheSimulator::memoryStore(const Memory* memory,
+                                 const WorkItem* workItem, size_t address,
+                                 size_t size, const uint8_t* storeData)
+{
+  addAccess(memory, workItem, address, size);
+}
+
+void CacheSimulator::memoryStore(const Memory* memory,
+                                 const WorkGroup* workGroup, size_t address,
+                                 size_t size, const uint8_t* storeData)
+{
+  addAccess(memory, NULL, address, size);
+}
+
+void CacheSimulator::workGroupBegin(const WorkGroup* workGroup)
+{
+  // Create worker state if haven't already
+  if (!m_accesses)
+    m_accesses = new vector<Access>;
+
+  m_accesses->clear();
+}
+
+void CacheSimulator::workGroupComplete(const WorkGroup* workGroup)
+{
+  vector<Access>& accesses = *m_accesses;
+  vector<uint8_t> missLevel(accesses.size(), 0);
+  vector<size_t> reuseDistances;
+  size_t coldAccesses = 0;
+
+  // Replay accesses through the L1 of the compute unit the work-group maps to
+  ComputeUnit& cu =
+    m_computeUnits[workGroup->getGroupIndex() % m_computeUnits.size()];
+  {
+    lock_guard<mutex> lock(cu.mtx);
+    for (size_t i = 0; i < accesses.size(); i++)
+    {
+      size_t line = accesses[i].line;
+
+      auto previous = cu.lastAccess.find(line);
+      if (previous == cu.lastAccess.end())
+      {
+        coldAccesses++;
+        cu.lastAccess[line] = cu.numAccesses;
+      }
+      else
+      {
+        uint64_t distance = cu.numAccesses - previous->second;
+        unsigned bucket = 0;
+        while (distance >>= 1)
+          bucket++;
+        if (bucket >= reuseDistances.size())
+          reuseDistances.resize(bucket + 1);
+        reuseDistances[bucket]++;
+        previous->second = cu.numAccesses;
+      }
+      cu.numAccesses++;
+
+      if (!cu.l1.access(line))
+        missLevel[i] = 1;
+    }
+  }
+
+  // Replay L1 misses through the shared L2
+  {
+    lock_guard<mutex> lock(m_l2Mutex);
+    for (size_t i = 0; i < accesses.size(); i++)
+    {
+      if (missLevel[i] && !m_l2.access(accesses[i].line))
+        missLevel[i] = 2;
+    }
+  }
+
+  // Merge statistics
+  lock_guard<mutex> lock(m_statsMutex);
+  m_numAccesses += accesses.size();
+  m_coldAccesses += coldAccesses;
+  if (reuseDistances.size() > m_reuseDistances.size())
+    m_reuseDistances.resize(reuseDistances.size());
+  for (unsigned i = 0; i < reuseDistances.size(); i++)
+    m_reuseDistances[i] += reuseDistances[i];
+
+  const llvm::Instruction* instruction = NULL;
+  InstructionStats* stats = NULL;
+  for (size_t i = 0; i < accesses.size(); i++)
+  {
+    if (missLevel[i] >= 1)
+      m_l1Misses++;
+    if (missLevel[i] >= 2)
+      m_l2Misses++;
+
+    // Work-group copies are not attributed to an instruction
+    if (!accesses[i].instruction)
+      continue;
+
+    // Consecutive accesses usually come from the same instruction
+    if (accesses[i].instruction != instruction)
+    {
+      instruction = accesses[i].instruction;
+      stats = &m_stats[instruction];
+    }
+    stats->accesses++;
+    if (missLevel[i] >= 1)
+      stats->l1Misses++;
+    if (missLevel[i] >= 2)
+      stats->l2Misses++;
+  }
+}
@@ -0,0 +1,105 @@
+// CacheSimulator.h (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#include "core/Plugin.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace oclgrind
+{
+// Simulates a set-associative L1 cache per compute unit and a shared L2
+// cache for global memory accesses. Work-groups are mapped to compute
+// units round-robin. Each worker buffers the accesses of its work-group and
+// replays them through the caches when the work-group completes.
+class CacheSimulator : public Plugin
+{
+public:
+  CacheSimulator(const Context* context);
+
+  virtual void kernelBegin(const KernelInvocation* kernelInvocation) override;
+  virtual void kernelEnd(const KernelInvocation* kernelInvocation) override;
+  virtual void memoryAtomicLoad(const Memory* memory, const WorkItem* workItem,
+                                AtomicOp op, size_t address,
+                                size_t size) override;
+  virtual void memoryAtomicStore(const Memory* memory, const WorkItem* workItem,
+                                 AtomicOp op, size_t address,
+                                 size_t size) override;
+  virtual void memoryLoad(const Memory* memory, const WorkItem* workItem,
+                          size_t address, size_t size) override;
+  virtual void memoryLoad(const Memory* memory, const WorkGroup* workGroup,
+                          size_t address, size_t size) override;
+  virtual void memoryStore(const Memory* memory, const WorkItem* workItem,
+                           size_t address, size_t size,
+                           const uint8_t* storeData) override;
+  virtual void memoryStore(const Memory* memory, const WorkGroup* workGroup,
+                           size_t address, size_t size,
+                           const uint8_t* storeData) override;
+  virtual void workGroupBegin(const WorkGroup* workGroup) override;
+  virtual void workGroupComplete(const WorkGroup* workGroup) override;
+
+private:
+  // Set-associative cache with LRU replacement
+  class Cache
+  {
+  public:
+    void configure(size_t size, unsigned ways, unsigned lineSize);
+    bool access(size_t line);
+    void reset();
+
+  private:
+    unsigned m_ways;
+    size_t m_numSets;
+    std::vector<size_t> m_tags;
+    std::vector<uint64_t> m_lastUse;
+    uint64_t m_clock;
+  };
+
+  struct Access
+  {
+    size_t line;
+    const llvm::Instruction* instruction;
+  };
+
+  struct InstructionStats
+  {
+    size_t accesses;
+    size_t l1Misses;
+    size_t l2Misses;
+  };
+
+  // Per compute unit state, including the last access to each line, which is
+  // used to compute reuse distances
+  struct ComputeUnit
+  {
+    Cache l1;
+    uint64_t numAccesses;
+    std::unordered_map<size_t, uint64_t> lastAccess;
+    std::mutex mtx;
+  };
+
+  unsigned m_lineSize;
+  std::vector<ComputeUnit> m_computeUnits;
+  Cache m_l2;
+  std::mutex m_l2Mutex;
+
+  // Statistics for the current kernel
+  size_t m_numAccesses;
+  size_t m_l1Misses;
+  size_t m_l2Misses;
+  size_t m_coldAccesses;
+  std::vector<size_t> m_reuseDistances;
+  std::unordered_map<const llvm::Instruction*, InstructionStats> m_stats;
+  std::mutex m_statsMutex;
+
+  static THREAD_LOCAL std::vector<Access>* m_accesses;
+
+  void addAccess(const Memory* memory, const WorkItem* workItem,
+                 size_t address, size_t size);
+};
+} // namespace oclgrind
@@ -49,6 +49,11 @@ Logger::~Logger()
   }
 }
 
+unsigned Logger::getRecordedEvents() const
+{
+  return 0;
+}
+
 void Logger::log(MessageType type, const char* message)
 {
   lock_guard<mutex> lock(logMutex);
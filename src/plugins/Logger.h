@@ -16,6 +16,7 @@ public:
   Logger(const Context* context);
   virtual ~Logger();
 
+  virtual unsigned getRecordedEvents() const override;
   virtual void log(MessageType type, const char* message) override;
 
 private:
@@ -9,7 +9,7 @@
 #include "core/common.h"
 
 #include "core/Context.h"
-#include "core/Memory.h"
+#include "core/KernelInvocation.h"
 #include "core/WorkItem.h"
 
 #include "llvm/IR/Instructions.h"
@@ -20,7 +20,15 @@
 using namespace oclgrind;
 using namespace std;
 
-MemCheck::MemCheck(const Context* context) : Plugin(context) {}
+MemCheck::MemCheck(const Context* context) : Plugin(context)
+{
+  m_kernelInvocation = NULL;
+}
+
+unsigned MemCheck::getRecordedEvents() const
+{
+  return 1 << PluginEvent::INSTRUCTION_EXECUTED;
+}
 
 void MemCheck::instructionExecuted(const WorkItem* workItem,
                                    const llvm::Instruction* instruction,
@@ -42,6 +50,18 @@ void MemCheck::instructionExecuted(const WorkItem* workItem,
     return;
   }
 
+  // Only accesses through a GEP can index into a static array
+  if (!llvm::isa<llvm::GetElementPtrInst>(PtrOp->stripPointerCasts()))
+  {
+    return;
+  }
+
+  // Skip accesses already proven to be in bounds for the whole NDRange
+  if (m_kernelInvocation->isAccessInBounds(instruction))
+  {
+    return;
+  }
+
   // Walk up chain of GEP instructions leading to this access
   while (auto GEPI =
            llvm::dyn_cast<llvm::GetElementPtrInst>(PtrOp->stripPointerCasts()))
@@ -52,64 +72,14 @@ void MemCheck::instructionExecuted(const WorkItem* workItem,
   }
 }
 
-void MemCheck::memoryAtomicLoad(const Memory* memory, const WorkItem* workItem,
-                                AtomicOp op, size_t address, size_t size)
+void MemCheck::kernelBegin(const KernelInvocation* kernelInvocation)
 {
-  checkLoad(memory, address, size);
+  m_kernelInvocation = kernelInvocation;
 }
 
-void MemCheck::memoryAtomicStore(const Memory* memory, const WorkItem* workItem,
-                                 AtomicOp op, size_t address, size_t size)
+void MemCheck::kernelEnd(const KernelInvocation* kernelInvocation)
 {
-  checkStore(memory, address, size);
-}
-
-void MemCheck::memoryLoad(const Memory* memory, const WorkItem* workItem,
-                          size_t address, size_t size)
-{
-  checkLoad(memory, address, size);
-}
-
-void MemCheck::memoryLoad(const Memory* memory, const WorkGroup* workGroup,
-                          size_t address, size_t size)
-{
-  checkLoad(memory, address, size);
-}
-
-void MemCheck::memoryMap(const Memory* memory, size_t address, size_t offset,
-                         size_t size, cl_map_flags flags)
-{
-  MapRegion map = {address, offset, size, memory->getPointer(address + offset),
-                   (flags == CL_MAP_READ ? MapRegion::READ : MapRegion::WRITE)};
-  m_mapRegions.push_back(map);
-}
-
-void MemCheck::memoryStore(const Memory* memory, const WorkItem* workItem,
-                           size_t address, size_t size,
-                           const uint8_t* storeData)
-{
-  checkStore(memory, address, size);
-}
-
-void MemCheck::memoryStore(const Memory* memory, const WorkGroup* workGroup,
-                           size_t address, size_t size,
-                           const uint8_t* storeData)
-{
-  checkStore(memory, address, size);
-}
-
-void MemCheck::memoryUnmap(const Memory* memory, size_t address,
-                           const void* ptr)
-{
-  for (auto region = m_mapRegions.begin(); region != m_mapRegions.end();
-       region++)
-  {
-    if (region->ptr == ptr)
-    {
-      m_mapRegions.erase(region);
-      return;
-    }
-  }
+  m_kernelInvocation = NULL;
 }
 
 void MemCheck::checkArrayAccess(const WorkItem* workItem,
@@ -151,77 +121,3 @@ void MemCheck::checkArrayAccess(const WorkItem* workItem,
     }
   }
 }
-
-void MemCheck::checkLoad(const Memory* memory, size_t address,
-                         size_t size) const
-{
-  if (!memory->isAddressValid(address, size))
-  {
-    logInvalidAccess(true, memory->getAddressSpace(), address, size);
-    return;
-  }
-
-  if (memory->getBuffer(address)->flags & CL_MEM_WRITE_ONLY)
-  {
-    m_context->logError("Invalid read from write-only buffer");
-  }
-
-  if (memory->getAddressSpace() == AddrSpaceLocal ||
-      memory->getAddressSpace() == AddrSpacePrivate)
-    return;
-
-  // Check if memory location is currently mapped for writing
-  for (auto region = m_mapRegions.begin(); region != m_mapRegions.end();
-       region++)
-  {
-    if (region->type == MapRegion::WRITE &&
-        address < region->address + region->size &&
-        address + size >= region->address)
-    {
-      m_context->logError("Invalid read from buffer mapped for writing");
-    }
-  }
-}
-
-void MemCheck::checkStore(const Memory* memory, size_t address,
-                          size_t size) const
-{
-  if (!memory->isAddressValid(address, size))
-  {
-    logInvalidAccess(false, memory->getAddressSpace(), address, size);
-    return;
-  }
-
-  if (memory->getBuffer(address)->flags & CL_MEM_READ_ONLY)
-  {
-    m_context->logError("Invalid write to read-only buffer");
-  }
-
-  if (memory->getAddressSpace() == AddrSpaceLocal ||
-      memory->getAddressSpace() == AddrSpacePrivate)
-    return;
-
-  // Check if memory location is currently mapped
-  for (auto region = m_mapRegions.begin(); region != m_mapRegions.end();
-       region++)
-  {
-    if (address < region->address + region->size &&
-        address + size >= region->address)
-    {
-      m_context->logError("Invalid write to mapped buffer");
-    }
-  }
-}
-
-void MemCheck::logInvalidAccess(bool read, unsigned addrSpace, size_t address,
-                                size_t size) const
-{
-  Context::Message msg(ERROR, m_context);
-  msg << "Invalid " << (read ? "read" : "write") << " of size " << size
-      << " at " << getAddressSpaceName(addrSpace) << " memory address 0x" << hex
-      << address << endl
-      << msg.INDENT << "Kernel: " << msg.CURRENT_KERNEL << endl
-      << "Entity: " << msg.CURRENT_ENTITY << endl
-      << msg.CURRENT_LOCATION << endl;
-  msg.send();
-}
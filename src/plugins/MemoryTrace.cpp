@@ -0,0 +1,307 @@
+// MemoryTrace.cpp (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#include "core/common.h"
+#include "config.h"
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/Instruction.h"
+
+#include "MemoryTrace.h"
+
+#include "core/Kernel.h"
+#include "core/KernelInvocation.h"
+#include "trace/TraceFormat.h"
+
+using namespace oclgrind;
+using namespace std;
+
+// Size at which a worker's buffer is handed to the writer thread
+#define CHUNK_SIZE (1 << 20)
+
+// Maximum number of chunks waiting to be written before workers block
+#define MAX_PENDING_CHUNKS 16
+
+THREAD_LOCAL MemoryTrace::WorkerState MemoryTrace::m_state = {NULL, 0};
+
+MemoryTrace::MemoryTrace(const Context* context) : Plugin(context)
+{
+  m_tracePrivate = checkEnv("OCLGRIND_MEM_TRACE_PRIVATE");
+  m_generation = 0;
+  m_finished = false;
+
+  const char* filename = getenv("OCLGRIND_MEM_TRACE");
+  m_file.open(filename, ios::out | ios::binary | ios::trunc);
+  if (!m_file.good())
+  {
+    cerr << "Oclgrind: Unable to open memory trace file '" << filename << "'"
+         << endl;
+    return;
+  }
+
+  // Write file header
+  uint8_t header[12] = TRACE_MAGIC;
+  traceWriteUInt32(header + 8, TRACE_VERSION);
+  m_file.write((const char*)header, sizeof(header));
+
+  m_writer = thread(&MemoryTrace::writeChunks, this);
+}
+
+MemoryTrace::~MemoryTrace()
+{
+  {
+    lock_guard<mutex> lock(m_chunkMutex);
+    m_finished = true;
+  }
+  m_chunkCondition.notify_all();
+  if (m_writer.joinable())
+    m_writer.join();
+
+  for (auto buffer : m_buffers)
+    delete buffer;
+}
+
+void MemoryTrace::addRecord(const PluginEvent& event, unsigned type)
+{
+  if (event.addrSpace == AddrSpacePrivate && !m_tracePrivate)
+    return;
+
+  WorkerBuffer* buffer = getWorkerBuffer();
+
+  uint64_t wi =
+    event.workItem == (size_t)-1 ? TRACE_NO_WORK_ITEM : event.workItem;
+  uint32_t instruction =
+    event.instruction ? getInstructionID(buffer, event.instruction) : 0;
+
+  uint8_t flags = type | (event.addrSpace << 2);
+  if (wi != buffer->workItem)
+    flags |= TRACE_FLAG_WORK_ITEM;
+  if (instruction != buffer->instruction)
+    flags |= TRACE_FLAG_INSTRUCTION;
+
+  vector<uint8_t>& data = buffer->data;
+  data.push_back(flags);
+  if (flags & TRACE_FLAG_WORK_ITEM)
+    traceWriteDelta(data, wi, buffer->workItem);
+  if (flags & TRACE_FLAG_INSTRUCTION)
+    traceWriteVarint(data, instruction);
+  traceWriteDelta(data, event.address, buffer->addresses[event.addrSpace]);
+  traceWriteVarint(data, event.size);
+
+  buffer->workItem = wi;
+  buffer->instruction = instruction;
+  buffer->addresses[event.addrSpace] = event.address;
+
+  if (data.size() >= CHUNK_SIZE)
+    flushBuffer(buffer);
+}
+
+void MemoryTrace::enqueueChunk(uint8_t type, vector<uint8_t>& data)
+{
+  unique_lock<mutex> lock(m_chunkMutex);
+  if (!m_writer.joinable())
+  {
+    data.clear();
+    return;
+  }
+
+  // Apply back-pressure if the writer is falling behind
+  m_chunkCondition.wait(
+    lock, [this] { return m_chunks.size() < MAX_PENDING_CHUNKS; });
+
+  m_chunks.push_back(make_pair(type, vector<uint8_t>()));
+  m_chunks.back().second.swap(data);
+  m_chunkCondition.notify_all();
+}
+
+void MemoryTrace::eventsRecorded(const PluginEvent* events, size_t num)
+{
+  for (size_t i = 0; i < num; i++)
+  {
+    switch (events[i].type)
+    {
+    case PluginEvent::MEMORY_LOAD:
+      addRecord(events[i], TraceLoad);
+      break;
+    case PluginEvent::MEMORY_STORE:
+      addRecord(events[i], TraceStore);
+      break;
+    case PluginEvent::MEMORY_ATOMIC_LOAD:
+      addRecord(events[i], TraceAtomicLoad);
+      break;
+    case PluginEvent::MEMORY_ATOMIC_STORE:
+      addRecord(events[i], TraceAtomicStore);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+void MemoryTrace::flushBuffer(WorkerBuffer* buffer)
+{
+  if (!buffer->data.empty())
+  {
+    enqueueChunk(TraceChunkRecords, buffer->data);
+    buffer->data.reserve(CHUNK_SIZE + 64);
+  }
+
+  // Reset delta encoding state, so that chunks can be decoded independently
+  buffer->workItem = 0;
+  buffer->instruction = 0;
+  for (unsigned i = 0; i < 4; i++)
+    buffer->addresses[i] = 0;
+}
+
+uint32_t MemoryTrace::getInstructionID(WorkerBuffer* buffer,
+                                       const llvm::Instruction* instruction)
+{
+  auto itr = buffer->instructionIDs.find(instruction);
+  if (itr != buffer->instructionIDs.end())
+    return itr->second;
+
+  // Assign IDs from a table shared by all workers
+  uint32_t id;
+  {
+    lock_guard<mutex> lock(m_mtx);
+    auto result = m_instructionIDs.insert(
+      make_pair(instruction, (uint32_t)m_instructionIDs.size() + 1));
+    id = result.first->second;
+  }
+  buffer->instructionIDs[instruction] = id;
+  return id;
+}
+
+MemoryTrace::WorkerBuffer* MemoryTrace::getWorkerBuffer()
+{
+  // Buffers are released at the end of each kernel, so a buffer is only
+  // reused if it was created for the current kernel
+  if (m_state.buffer && m_state.generation == m_generation)
+    return m_state.buffer;
+
+  WorkerBuffer* buffer = new WorkerBuffer;
+  buffer->data.reserve(CHUNK_SIZE + 64);
+  flushBuffer(buffer);
+
+  lock_guard<mutex> lock(m_mtx);
+  m_buffers.push_back(buffer);
+  m_state.buffer = buffer;
+  m_state.generation = m_generation;
+  return buffer;
+}
+
+unsigned MemoryTrace::getRecordedEvents() const
+{
+  return (1 << PluginEvent::MEMORY_LOAD) | (1 << PluginEvent::MEMORY_STORE) |
+         (1 << PluginEvent::MEMORY_ATOMIC_LOAD) |
+         (1 << PluginEvent::MEMORY_ATOMIC_STORE);
+}
+
+bool MemoryTrace::isDecoupled() const
+{
+  return true;
+}
+
+void MemoryTrace::kernelBegin(const KernelInvocation* kernelInvocation)
+{
+  m_generation++;
+  m_instructionIDs.clear();
+
+  // Write kernel chunk
+  vector<uint8_t> data;
+  traceWriteString(data, kernelInvocation->getKernel()->getName());
+  traceWriteVarint(data, kernelInvocation->getWorkDim());
+  Size3 globalSize = kernelInvocation->getGlobalSize();
+  Size3 localSize = kernelInvocation->getLocalSize();
+  for (unsigned i = 0; i < 3; i++)
+    traceWriteVarint(data, globalSize[i]);
+  for (unsigned i = 0; i < 3; i++)
+    traceWriteVarint(data, localSize[i]);
+  enqueueChunk(TraceChunkKernel, data);
+}
+
+void MemoryTrace::kernelEnd(const KernelInvocation* kernelInvocation)
+{
+  // Analysis threads have processed every event, so write out and release
+  // their buffers
+  for (auto buffer : m_buffers)
+  {
+    flushBuffer(buffer);
+    delete buffer;
+  }
+  m_buffers.clear();
+
+  // Write instructions chunk
+  vector<uint8_t> data;
+  traceWriteVarint(data, m_instructionIDs.size());
+  for (auto& instruction : m_instructionIDs)
+  {
+    traceWriteVarint(data, instruction.second);
+
+    llvm::MDNode* md = instruction.first->getMetadata("dbg");
+    traceWriteVarint(data, md ? ((llvm::DILocation*)md)->getLine() : 0);
+
+    ostringstream text;
+    dumpInstruction(text, instruction.first);
+    traceWriteString(data, text.str());
+  }
+  enqueueChunk(TraceChunkInstructions, data);
+}
+
+void MemoryTrace::writeChunks()
+{
+  while (true)
+  {
+    // Wait for a chunk to be available
+    pair<uint8_t, vector<uint8_t>> chunk;
+    {
+      unique_lock<mutex> lock(m_chunkMutex);
+      m_chunkCondition.wait(lock,
+                            [this] { return m_finished || !m_chunks.empty(); });
+      if (m_chunks.empty())
+        break;
+      chunk.first = m_chunks.front().first;
+      chunk.second.swap(m_chunks.front().second);
+      m_chunks.pop_front();
+    }
+    m_chunkCondition.notify_all();
+
+    const vector<uint8_t>& raw = chunk.second;
+    const uint8_t* payload = raw.data();
+    size_t storedSize = raw.size();
+    uint8_t compression = TraceCompressionNone;
+
+#if HAVE_ZLIB
+    // Compress the chunk, keeping it uncompressed if that doesn't help
+    uLongf compressedSize = compressBound(raw.size());
+    vector<uint8_t> compressed(compressedSize);
+    if (compress2(compressed.data(), &compressedSize, raw.data(), raw.size(),
+                  Z_BEST_SPEED) == Z_OK &&
+        compressedSize < raw.size())
+    {
+      payload = compressed.data();
+      storedSize = compressedSize;
+      compression = TraceCompressionZlib;
+    }
+#endif
+
+    uint8_t header[TRACE_CHUNK_HEADER_SIZE];
+    header[0] = chunk.first;
+    header[1] = compression;
+    traceWriteUInt32(header + 2, raw.size());
+    traceWriteUInt32(header + 6, storedSize);
+    m_file.write((const char*)header, sizeof(header));
+    m_file.write((const char*)payload, storedSize);
+  }
+
+  m_file.close();
+}
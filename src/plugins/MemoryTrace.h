@@ -0,0 +1,79 @@
+// MemoryTrace.h (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#include "core/Plugin.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace oclgrind
+{
+// Streams every memory access made by kernels to a binary trace file (see
+// trace/TraceFormat.h). Accesses are received as decoupled plugin events,
+// each analysis thread encodes records into its own buffer, and full
+// buffers are compressed and written by a background thread.
+class MemoryTrace : public Plugin
+{
+public:
+  MemoryTrace(const Context* context);
+  virtual ~MemoryTrace();
+
+  virtual void eventsRecorded(const PluginEvent* events, size_t num) override;
+  virtual unsigned getRecordedEvents() const override;
+  virtual bool isDecoupled() const override;
+  virtual void kernelBegin(const KernelInvocation* kernelInvocation) override;
+  virtual void kernelEnd(const KernelInvocation* kernelInvocation) override;
+
+private:
+  // Records encoded by a single analysis thread, and the state needed to
+  // delta-encode the next record
+  struct WorkerBuffer
+  {
+    std::vector<uint8_t> data;
+    uint64_t workItem;
+    uint32_t instruction;
+    uint64_t addresses[4];
+    std::unordered_map<const llvm::Instruction*, uint32_t> instructionIDs;
+  };
+
+  struct WorkerState
+  {
+    WorkerBuffer* buffer;
+    uint64_t generation;
+  };
+  static THREAD_LOCAL WorkerState m_state;
+
+  bool m_tracePrivate;
+
+  // Buffers created for the current kernel
+  uint64_t m_generation;
+  std::vector<WorkerBuffer*> m_buffers;
+  std::unordered_map<const llvm::Instruction*, uint32_t> m_instructionIDs;
+  std::mutex m_mtx;
+
+  // Chunks waiting to be written by the background thread
+  std::ofstream m_file;
+  std::thread m_writer;
+  std::deque<std::pair<uint8_t, std::vector<uint8_t>>> m_chunks;
+  std::mutex m_chunkMutex;
+  std::condition_variable m_chunkCondition;
+  bool m_finished;
+
+  void enqueueChunk(uint8_t type, std::vector<uint8_t>& data);
+  void flushBuffer(WorkerBuffer* buffer);
+  uint32_t getInstructionID(WorkerBuffer* buffer,
+                            const llvm::Instruction* instruction);
+  WorkerBuffer* getWorkerBuffer();
+  void addRecord(const PluginEvent& event, unsigned type);
+  void writeChunks();
+};
+} // namespace oclgrind
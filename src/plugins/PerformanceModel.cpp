@@ -0,0 +1,221 @@
+// PerformanceModel.cpp (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#include "core/common.h"
+
+#include <algorithm>
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Instructions.h"
+
+#include "PerformanceModel.h"
+
+#include "core/Kernel.h"
+#include "core/KernelInvocation.h"
+#include "core/Memory.h"
+#include "core/WorkGroup.h"
+
+using namespace oclgrind;
+using namespace std;
+
+THREAD_LOCAL PerformanceModel::WorkGroupCosts PerformanceModel::m_state = {0};
+
+// Number of cycles needed to issue an instruction for a single work-item
+static unsigned getIssueCost(const llvm::Instruction* instruction)
+{
+  switch (instruction->getOpcode())
+  {
+  case llvm::Instruction::PHI:
+  case llvm::Instruction::BitCast:
+  case llvm::Instruction::AddrSpaceCast:
+  case llvm::Instruction::Alloca:
+    return 0;
+  case llvm::Instruction::FDiv:
+  case llvm::Instruction::FRem:
+    return 4;
+  case llvm::Instruction::SDiv:
+  case llvm::Instruction::UDiv:
+  case llvm::Instruction::SRem:
+  case llvm::Instruction::URem:
+    return 8;
+  case llvm::Instruction::Call:
+  {
+    // Builtin functions are assumed to run on special function units
+    const llvm::Function* function =
+      ((const llvm::CallInst*)instruction)->getCalledFunction();
+    if (function && function->getName().startswith("llvm.dbg."))
+      return 0;
+    return 4;
+  }
+  default:
+    return 1;
+  }
+}
+
+DeviceProfile oclgrind::getDeviceProfile()
+{
+  DeviceProfile profile;
+  profile.computeUnits = getEnvInt("OCLGRIND_COMPUTE_UNITS", 1, false);
+  profile.lanesPerUnit = getEnvInt("OCLGRIND_PERF_LANES", 64, false);
+  profile.clockMHz = getEnvInt("OCLGRIND_PERF_CLOCK", 1000, false);
+  profile.bandwidthGBs = getEnvInt("OCLGRIND_PERF_BANDWIDTH", 100, false);
+  profile.globalLatency = getEnvInt("OCLGRIND_PERF_GLOBAL_LATENCY", 400);
+  profile.localLatency = getEnvInt("OCLGRIND_PERF_LOCAL_LATENCY", 30);
+  profile.barrierLatency = getEnvInt("OCLGRIND_PERF_BARRIER_LATENCY", 40);
+  return profile;
+}
+
+PerformanceModel::PerformanceModel(const Context* context)
+    : Plugin(context), m_profile(getDeviceProfile())
+{
+}
+
+void PerformanceModel::countMemoryAccess(const Memory* memory, size_t size)
+{
+  switch (memory->getAddressSpace())
+  {
+  case AddrSpaceGlobal:
+  case AddrSpaceConstant:
+    m_state.globalAccesses++;
+    m_state.globalBytes += size;
+    break;
+  case AddrSpaceLocal:
+    m_state.localAccesses++;
+    break;
+  }
+}
+
+void PerformanceModel::instructionExecuted(const WorkItem* workItem,
+                                           const llvm::Instruction* instruction,
+                                           const TypedValue& result)
+{
+  m_state.issueCycles += getIssueCost(instruction);
+}
+
+void PerformanceModel::kernelBegin(const KernelInvocation* kernelInvocation)
+{
+  m_unitCycles.assign(m_profile.computeUnits, 0);
+  m_totals = {0};
+}
+
+void PerformanceModel::kernelEnd(const KernelInvocation* kernelInvocation)
+{
+  // Work-groups are spread across the compute units, so the kernel runs for
+  // as long as the busiest unit, or as long as it takes to move its global
+  // memory traffic, whichever is greater
+  double cycles = *max_element(m_unitCycles.begin(), m_unitCycles.end());
+  double computeTime = cycles * 1000.0 / m_profile.clockMHz;
+  double memoryTime = (double)m_totals.globalBytes / m_profile.bandwidthGBs;
+  double deviceTime = max(computeTime, memoryTime);
+
+  kernelInvocation->setDeviceTime(deviceTime);
+
+  // Load default locale
+  locale previousLocale = cout.getloc();
+  locale defaultLocale("");
+  cout.imbue(defaultLocale);
+
+  cout << "Estimated device time for kernel '"
+       << kernelInvocation->getKernel()->getName() << "': " << fixed
+       << setprecision(3) << deviceTime / 1000.0 << " us ("
+       << (computeTime >= memoryTime ? "compute" : "memory") << " bound)"
+       << endl;
+  cout << setw(16) << computeTime / 1000.0 << " us - compute ("
+       << m_totals.issueCycles << " issue cycles, " << m_totals.barriers
+       << " barriers)" << endl;
+  cout << setw(16) << memoryTime / 1000.0 << " us - memory ("
+       << m_totals.globalBytes << " bytes in " << m_totals.globalAccesses
+       << " global accesses, " << m_totals.localAccesses
+       << " local accesses)" << endl;
+  cout << endl;
+
+  // Restore locale and formatting
+  cout.unsetf(ios::floatfield);
+  cout << setprecision(6);
+  cout.imbue(previousLocale);
+}
+
+void PerformanceModel::memoryAtomicLoad(const Memory* memory,
+                                        const WorkItem* workItem, AtomicOp op,
+                                        size_t address, size_t size)
+{
+  countMemoryAccess(memory, size);
+}
+
+void PerformanceModel::memoryAtomicStore(const Memory* memory,
+                                         const WorkItem* workItem, AtomicOp op,
+                                         size_t address, size_t size)
+{
+  countMemoryAccess(memory, size);
+}
+
+void PerformanceModel::memoryLoad(const Memory* memory,
+                                  const WorkItem* workItem, size_t address,
+                                  size_t size)
+{
+  countMemoryAccess(memory, size);
+}
+
+void PerformanceModel::memoryLoad(const Memory* memory,
+                                  const WorkGroup* workGroup, size_t address,
+                                  size_t size)
+{
+  countMemoryAccess(memory, size);
+}
+
+void PerformanceModel::memoryStore(const Memory* memory,
+                                   const WorkItem* workItem, size_t address,
+                                   size_t size, const uint8_t* storeData)
+{
+  countMemoryAccess(memory, size);
+}
+
+void PerformanceModel::memoryStore(const Memory* memory,
+                                   const WorkGroup* workGroup, size_t address,
+                                   size_t size, const uint8_t* storeData)
+{
+  countMemoryAccess(memory, size);
+}
+
+void PerformanceModel::workGroupBarrier(const WorkGroup* workGroup,
+                                        uint32_t flags)
+{
+  m_state.barriers++;
+}
+
+void PerformanceModel::workGroupBegin(const WorkGroup* workGroup)
+{
+  m_state = {0};
+}
+
+void PerformanceModel::workGroupComplete(const WorkGroup* workGroup)
+{
+  Size3 groupSize = workGroup->getGroupSize();
+  size_t numWorkItems = groupSize.x * groupSize.y * groupSize.z;
+
+  // The work-items of a group issue instructions across the lanes of a
+  // compute unit, while memory latency is hidden by switching between them
+  // unless a single work-item's chain of accesses takes longer
+  double issue = (double)m_state.issueCycles / m_profile.lanesPerUnit;
+  double latency = (double)(m_state.globalAccesses * m_profile.globalLatency +
+                            m_state.localAccesses * m_profile.localLatency) /
+                     numWorkItems +
+                   m_state.barriers * m_profile.barrierLatency;
+  double cycles = max(issue, latency);
+
+  lock_guard<mutex> lock(m_mtx);
+
+  m_unitCycles[workGroup->getGroupIndex() % m_profile.computeUnits] += cycles;
+
+  m_totals.issueCycles += m_state.issueCycles;
+  m_totals.globalAccesses += m_state.globalAccesses;
+  m_totals.globalBytes += m_state.globalBytes;
+  m_totals.localAccesses += m_state.localAccesses;
+  m_totals.barriers += m_state.barriers;
+}
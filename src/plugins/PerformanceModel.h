@@ -0,0 +1,85 @@
+// PerformanceModel.h (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#include "core/Plugin.h"
+
+#include <mutex>
+
+namespace oclgrind
+{
+// Device described by the OCLGRIND_COMPUTE_UNITS and OCLGRIND_PERF_*
+// environment variables, shared by the performance and roofline models
+struct DeviceProfile
+{
+  unsigned computeUnits;
+  unsigned lanesPerUnit;
+  unsigned clockMHz;
+  unsigned bandwidthGBs;
+  unsigned globalLatency;
+  unsigned localLatency;
+  unsigned barrierLatency;
+};
+DeviceProfile getDeviceProfile();
+
+// Estimates the execution time of each kernel on a GPU-like device, from
+// the instructions, memory accesses and barriers executed by each
+// work-group. The device is described by a profile read from environment
+// variables. The estimate is reported through the event profiling info.
+class PerformanceModel : public Plugin
+{
+public:
+  PerformanceModel(const Context* context);
+
+  virtual void instructionExecuted(const WorkItem* workItem,
+                                   const llvm::Instruction* instruction,
+                                   const TypedValue& result) override;
+  virtual void kernelBegin(const KernelInvocation* kernelInvocation) override;
+  virtual void kernelEnd(const KernelInvocation* kernelInvocation) override;
+  virtual void memoryAtomicLoad(const Memory* memory, const WorkItem* workItem,
+                                AtomicOp op, size_t address,
+                                size_t size) override;
+  virtual void memoryAtomicStore(const Memory* memory, const WorkItem* workItem,
+                                 AtomicOp op, size_t address,
+                                 size_t size) override;
+  virtual void memoryLoad(const Memory* memory, const WorkItem* workItem,
+                          size_t address, size_t size) override;
+  virtual void memoryLoad(const Memory* memory, const WorkGroup* workGroup,
+                          size_t address, size_t size) override;
+  virtual void memoryStore(const Memory* memory, const WorkItem* workItem,
+                           size_t address, size_t size,
+                           const uint8_t* storeData) override;
+  virtual void memoryStore(const Memory* memory, const WorkGroup* workGroup,
+                           size_t address, size_t size,
+                           const uint8_t* storeData) override;
+  virtual void workGroupBarrier(const WorkGroup* workGroup,
+                                uint32_t flags) override;
+  virtual void workGroupBegin(const WorkGroup* workGroup) override;
+  virtual void workGroupComplete(const WorkGroup* workGroup) override;
+
+private:
+  DeviceProfile m_profile;
+
+  // Costs accumulated by a work-group
+  struct WorkGroupCosts
+  {
+    size_t issueCycles;
+    size_t globalAccesses;
+    size_t globalBytes;
+    size_t localAccesses;
+    size_t barriers;
+  };
+  static THREAD_LOCAL WorkGroupCosts m_state;
+
+  // Totals for the current kernel
+  std::vector<double> m_unitCycles;
+  WorkGroupCosts m_totals;
+  std::mutex m_mtx;
+
+  void countMemoryAccess(const Memory* memory, size_t size);
+};
+} // namespace oclgrind
@@ -126,6 +126,28 @@ void RaceDetector::memoryStore(const Memory* memory, const WorkGroup* workGroup,
   registerAccess(memory, workGroup, NULL, address, size, false, storeData);
 }
 
+void RaceDetector::subGroupBarrier(const WorkGroup* workGroup,
+                                   const vector<WorkItem*>& workItems,
+                                   uint32_t flags)
+{
+  size_t first = 0;
+  while (!workItems[first])
+    first++;
+  size_t subGroup =
+    workGroup->getLocalLinearID(workItems[first]) / SUB_GROUP_SIZE;
+
+  if (flags & CLK_LOCAL_MEM_FENCE)
+  {
+    syncWorkItems(workGroup->getLocalMemory(), STATE(workGroup),
+                  STATE(workGroup).wiLocal, subGroup);
+  }
+  if (flags & CLK_GLOBAL_MEM_FENCE)
+  {
+    syncWorkItems(m_context->getGlobalMemory(), STATE(workGroup),
+                  STATE(workGroup).wiGlobal, subGroup);
+  }
+}
+
 void RaceDetector::workGroupBarrier(const WorkGroup* workGroup, uint32_t flags)
 {
   if (flags & CLK_LOCAL_MEM_FENCE)
@@ -156,8 +178,9 @@ void RaceDetector::workGroupBegin(const WorkGroup* workGroup)
   // Re-use pool allocator for all access maps
   AccessMap tmp(0, AccessMap::hasher(), AccessMap::key_equal(),
                 state.wgGlobal.get_allocator());
-  state.wiGlobal.resize(state.numWorkItems + 1, tmp);
-  state.wiLocal.resize(state.numWorkItems + 1, tmp);
+  size_t numSlots = state.numWorkItems + 1 + workGroup->getNumSubGroups();
+  state.wiGlobal.resize(numSlots, tmp);
+  state.wiLocal.resize(numSlots, tmp);
 }
 
 void RaceDetector::workGroupComplete(const WorkGroup* workGroup)
@@ -219,6 +242,12 @@ bool RaceDetector::check(const MemoryAccess& a, const MemoryAccess& b) const
   if (a.isAtomic() && b.isAtomic())
     return false;
 
+  // No race if a sub-group barrier ordered one access before the other
+  if ((a.isSubGroupSynced() || b.isSubGroupSynced()) && a.isWorkItem() &&
+      b.isWorkItem() && a.getSubGroup() == b.getSubGroup() &&
+      getAccessWorkGroup(a) == getAccessWorkGroup(b))
+    return false;
+
   // Potential race if at least one store
   if (a.isStore() || b.isStore())
   {
@@ -351,6 +380,11 @@ void RaceDetector::registerAccess(const Memory* memory,
   if (!memory->isAddressValid(address, size))
     return;
 
+  // No other work-item can access memory used by a race-free instruction
+  if (workItem &&
+      m_kernelInvocation->isAccessRaceFree(workItem->getCurrentInstruction()))
+    return;
+
   // Construct access
   MemoryAccess access(workGroup, workItem, storeData != NULL, atomic);
 
@@ -360,10 +394,11 @@ void RaceDetector::registerAccess(const Memory* memory,
     Size3 wgsize = workGroup->getGroupSize();
     Size3 lid = workItem->getLocalID();
     index = lid.x + (lid.y + lid.z * wgsize.y) * wgsize.x;
+    access.setSubGroup(index / SUB_GROUP_SIZE);
   }
   else
   {
-    index = STATE(workGroup).wiLocal.size() - 1;
+    index = STATE(workGroup).numWorkItems;
   }
 
   AccessMap& accesses = (addrSpace == AddrSpaceGlobal)
@@ -380,12 +415,24 @@ void RaceDetector::registerAccess(const Memory* memory,
 }
 
 void RaceDetector::syncWorkItems(const Memory* memory, WorkGroupState& state,
-                                 vector<AccessMap>& accesses)
+                                 vector<AccessMap>& accesses,
+                                 size_t subGroup)
 {
   AccessMap wgAccesses(0, AccessMap::hasher(), AccessMap::key_equal(),
                        state.wgGlobal.get_allocator());
 
-  for (size_t i = 0; i < state.numWorkItems + 1; i++)
+  // Synchronize the work-items of a single sub-group, or everything
+  bool global = memory->getAddressSpace() == AddrSpaceGlobal;
+  size_t begin = 0;
+  size_t end = accesses.size();
+  if (subGroup != SIZE_MAX)
+  {
+    begin = subGroup * SUB_GROUP_SIZE;
+    end = min(begin + SUB_GROUP_SIZE, state.numWorkItems);
+    global = false;
+  }
+
+  for (size_t i = begin; i < end; i++)
   {
     RaceList races;
     for (auto& record : accesses[i])
@@ -408,13 +455,13 @@ void RaceDetector::syncWorkItems(const Memory* memory, WorkGroupState& state,
       if (a.load.isSet())
       {
         insert(b, a.load);
-        if (memory->getAddressSpace() == AddrSpaceGlobal)
+        if (global)
           insert(state.wgGlobal[address], a.load);
       }
       if (a.store.isSet())
       {
         insert(b, a.store);
-        if (memory->getAddressSpace() == AddrSpaceGlobal)
+        if (global)
           insert(state.wgGlobal[address], a.store);
       }
     }
@@ -425,12 +472,31 @@ void RaceDetector::syncWorkItems(const Memory* memory, WorkGroupState& state,
     for (auto race : races)
       logRace(race);
   }
+
+  // Keep the sub-group's accesses to check against other sub-groups, since
+  // only later accesses from the same sub-group are ordered after them
+  if (subGroup != SIZE_MAX)
+  {
+    AccessMap& synced = accesses[state.numWorkItems + 1 + subGroup];
+    for (auto& record : wgAccesses)
+    {
+      AccessRecord& a = record.second;
+      AccessRecord& b = synced[record.first];
+      a.load.setSubGroupSynced();
+      a.store.setSubGroupSynced();
+      if (a.load.isSet())
+        insert(b, a.load);
+      if (a.store.isSet())
+        insert(b, a.store);
+    }
+  }
 }
 
 RaceDetector::MemoryAccess::MemoryAccess()
 {
   this->info = 0;
   this->instruction = NULL;
+  this->subGroup = 0;
 }
 
 RaceDetector::MemoryAccess::MemoryAccess(const WorkGroup* workGroup,
@@ -442,6 +508,7 @@ RaceDetector::MemoryAccess::MemoryAccess(const WorkGroup* workGroup,
   this->info |= 1 << SET_BIT;
   this->info |= store << STORE_BIT;
   this->info |= atomic << ATOMIC_BIT;
+  this->subGroup = 0;
 
   if (workItem)
   {
@@ -482,6 +549,11 @@ bool RaceDetector::MemoryAccess::isStore() const
   return this->info & (1 << STORE_BIT);
 }
 
+bool RaceDetector::MemoryAccess::isSubGroupSynced() const
+{
+  return this->info & (1 << SG_BIT);
+}
+
 bool RaceDetector::MemoryAccess::isWorkGroup() const
 {
   return this->info & (1 << WG_BIT);
@@ -512,6 +584,21 @@ void RaceDetector::MemoryAccess::setStoreData(uint8_t data)
   this->storeData = data;
 }
 
+size_t RaceDetector::MemoryAccess::getSubGroup() const
+{
+  return this->subGroup;
+}
+
+void RaceDetector::MemoryAccess::setSubGroup(size_t subGroup)
+{
+  this->subGroup = subGroup;
+}
+
+void RaceDetector::MemoryAccess::setSubGroupSynced()
+{
+  this->info |= (1 << SG_BIT);
+}
+
 bool RaceDetector::MemoryAccess::operator==(
   const RaceDetector::MemoryAccess& other) const
 {
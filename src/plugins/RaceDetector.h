@@ -39,6 +39,9 @@ public:
   virtual void memoryStore(const Memory* memory, const WorkGroup* workGroup,
                            size_t address, size_t size,
                            const uint8_t* storeData) override;
+  virtual void subGroupBarrier(const WorkGroup* workGroup,
+                               const std::vector<WorkItem*>& workItems,
+                               uint32_t flags) override;
   virtual void workGroupBarrier(const WorkGroup* workGroup,
                                 uint32_t flags) override;
   virtual void workGroupBegin(const WorkGroup* workGroup) override;
@@ -56,7 +59,9 @@ private:
     static const unsigned STORE_BIT = 1;
     static const unsigned ATOMIC_BIT = 2;
     static const unsigned WG_BIT = 3;
+    static const unsigned SG_BIT = 4;
     uint8_t storeData;
+    uint16_t subGroup;
 
   public:
     void clear();
@@ -66,6 +71,7 @@ private:
     bool isAtomic() const;
     bool isLoad() const;
     bool isStore() const;
+    bool isSubGroupSynced() const;
     bool isWorkGroup() const;
     bool isWorkItem() const;
 
@@ -75,6 +81,10 @@ private:
     uint8_t getStoreData() const;
     void setStoreData(uint8_t);
 
+    size_t getSubGroup() const;
+    void setSubGroup(size_t);
+    void setSubGroupSynced();
+
     MemoryAccess();
     MemoryAccess(const WorkGroup* workGroup, const WorkItem* workItem,
                  bool store, bool atomic);
@@ -95,6 +105,8 @@ private:
   std::unordered_map<size_t, std::vector<AccessRecord>> m_globalAccesses;
   std::map<size_t, std::mutex*> m_globalMutexes;
 
+  // Accesses are tracked for each work-item, then for the work-group, then
+  // for each sub-group once they are ordered by a sub-group barrier
   struct WorkGroupState
   {
     size_t numWorkItems;
@@ -133,6 +145,7 @@ private:
                       const WorkItem* workItem, size_t address, size_t size,
                       bool atomic, const uint8_t* storeData = NULL);
   void syncWorkItems(const Memory* memory, WorkGroupState& state,
-                     std::vector<AccessMap>& accesses);
+                     std::vector<AccessMap>& accesses,
+                     size_t subGroup = SIZE_MAX);
 };
 } // namespace oclgrind
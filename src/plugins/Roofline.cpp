@@ -0,0 +1,293 @@
+// Roofline.cpp (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#include "core/common.h"
+
+#include <algorithm>
+#include <set>
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include "PerformanceModel.h"
+#include "Roofline.h"
+
+#include "core/Kernel.h"
+#include "core/KernelInvocation.h"
+#include "core/Memory.h"
+
+using namespace oclgrind;
+using namespace std;
+
+THREAD_LOCAL Roofline::Counts Roofline::m_state = {0};
+
+// Math builtins and intrinsics, which count as one operation per element of
+// their result (fused multiply-adds count as two)
+static const set<string> mathFunctions = {
+  "acos", "acosh", "acospi", "asin", "asinh", "asinpi", "atan", "atan2",
+  "atan2pi", "atanh", "atanpi", "cbrt", "ceil", "clamp", "copysign", "cos",
+  "cosh", "cospi", "cross", "degrees", "distance", "dot", "erf", "erfc", "exp",
+  "exp10", "exp2", "expm1", "fabs", "fast_distance", "fast_length",
+  "fast_normalize", "fdim", "floor", "fmax", "fmin", "fmod", "fract", "hypot",
+  "ldexp", "length", "lgamma", "log", "log10", "log1p", "log2", "logb", "max",
+  "maxmag", "maxnum", "min", "minmag", "minnum", "mix", "normalize", "pow",
+  "pown", "powr", "radians", "remainder", "rint", "rootn", "round", "rsqrt",
+  "sign", "sin", "sinh", "sinpi", "smoothstep", "sqrt", "step", "tan", "tanh",
+  "tanpi", "tgamma", "trunc"};
+
+// Get the number of floating point operations performed by a call to a
+// function for each element of its result
+static unsigned getCallFlops(const llvm::Function* function)
+{
+  if (!function->getReturnType()->getScalarType()->isFloatingPointTy())
+    return 0;
+
+  // Strip intrinsic type suffixes and builtin name mangling
+  string name = function->getName().str();
+  if (name.compare(0, 5, "llvm.") == 0)
+  {
+    name = name.substr(5, name.find('.', 5) - 5);
+  }
+  else
+  {
+    name = getUnmangledName(name);
+  }
+
+  // Reduced precision variants perform the same operations
+  if (name.compare(0, 5, "half_") == 0)
+    name = name.substr(5);
+  else if (name.compare(0, 7, "native_") == 0)
+    name = name.substr(7);
+
+  if (name == "fma" || name == "fmuladd" || name == "mad")
+    return 2;
+  return mathFunctions.count(name) ? 1 : 0;
+}
+
+Roofline::Roofline(const Context* context) : Plugin(context)
+{
+  // Use the same device profile as the performance model, assuming one
+  // operation per lane per cycle
+  DeviceProfile profile = getDeviceProfile();
+  m_peakGOPs = profile.computeUnits * profile.lanesPerUnit *
+               (profile.clockMHz / 1000.0);
+  m_bandwidthGBs = profile.bandwidthGBs;
+
+  const char* json = getenv("OCLGRIND_ROOFLINE_JSON");
+  if (json)
+  {
+    m_json.open(json, ios::out | ios::trunc);
+    if (!m_json.good())
+    {
+      cerr << "Oclgrind: Unable to open roofline output file '" << json
+           << "'" << endl;
+    }
+  }
+}
+
+void Roofline::instructionExecuted(const WorkItem* workItem,
+                                   const llvm::Instruction* instruction,
+                                   const TypedValue& result)
+{
+  switch (instruction->getOpcode())
+  {
+  case llvm::Instruction::FAdd:
+  case llvm::Instruction::FSub:
+  case llvm::Instruction::FMul:
+  case llvm::Instruction::FDiv:
+  case llvm::Instruction::FRem:
+  case llvm::Instruction::FNeg:
+  case llvm::Instruction::FCmp:
+    m_state.flops += result.num;
+    break;
+  case llvm::Instruction::Add:
+  case llvm::Instruction::Sub:
+  case llvm::Instruction::Mul:
+  case llvm::Instruction::UDiv:
+  case llvm::Instruction::SDiv:
+  case llvm::Instruction::URem:
+  case llvm::Instruction::SRem:
+  case llvm::Instruction::Shl:
+  case llvm::Instruction::LShr:
+  case llvm::Instruction::AShr:
+  case llvm::Instruction::And:
+  case llvm::Instruction::Or:
+  case llvm::Instruction::Xor:
+  case llvm::Instruction::ICmp:
+    m_state.intops += result.num;
+    break;
+  case llvm::Instruction::Call:
+  {
+    auto itr = m_callFlops.find(
+      ((const llvm::CallInst*)instruction)->getCalledFunction());
+    if (itr != m_callFlops.end())
+      m_state.flops += itr->second * result.num;
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+void Roofline::kernelBegin(const KernelInvocation* kernelInvocation)
+{
+  m_totals = {0};
+
+  // Count the operations performed by every function the kernel could
+  // call up front, so that executed calls only need a lookup
+  m_callFlops.clear();
+  const llvm::Module* module =
+    kernelInvocation->getKernel()->getFunction()->getParent();
+  for (auto F = module->begin(); F != module->end(); F++)
+  {
+    unsigned flops = getCallFlops(&*F);
+    if (flops)
+      m_callFlops[&*F] = flops;
+  }
+}
+
+void Roofline::kernelEnd(const KernelInvocation* kernelInvocation)
+{
+  // Only global and constant memory traffic goes to device memory
+  size_t spaceBytes[4];
+  for (unsigned i = 0; i < 4; i++)
+    spaceBytes[i] = m_totals.loadBytes[i] + m_totals.storeBytes[i];
+  size_t globalBytes =
+    spaceBytes[AddrSpaceGlobal] + spaceBytes[AddrSpaceConstant];
+
+  size_t ops = m_totals.flops + m_totals.intops;
+  double ridgePoint = m_peakGOPs / m_bandwidthGBs;
+  double intensity = globalBytes ? (double)ops / globalBytes : 0;
+  double attainable =
+    globalBytes ? min(m_peakGOPs, intensity * m_bandwidthGBs) : m_peakGOPs;
+  bool memoryBound = globalBytes && intensity < ridgePoint;
+
+  // Load default locale
+  locale previousLocale = cout.getloc();
+  locale defaultLocale("");
+  cout.imbue(defaultLocale);
+
+  cout << "Roofline for kernel '" << kernelInvocation->getKernel()->getName()
+       << "':" << endl;
+  cout << setw(16) << m_totals.flops << " - floating point operations"
+       << endl;
+  cout << setw(16) << m_totals.intops << " - integer operations" << endl;
+  for (unsigned i = 0; i < 4; i++)
+  {
+    if (!spaceBytes[i])
+      continue;
+    cout << setw(16) << spaceBytes[i] << " - bytes of "
+         << getAddressSpaceName(i) << " memory (" << m_totals.loadBytes[i]
+         << " loaded, " << m_totals.storeBytes[i] << " stored)" << endl;
+  }
+  cout << fixed << setprecision(3);
+  if (globalBytes)
+  {
+    cout << setw(16) << (double)m_totals.flops / globalBytes
+         << " - FLOPs per global byte" << endl;
+    cout << setw(16) << intensity << " - operations per global byte"
+         << endl;
+  }
+  cout << setw(16) << attainable << " - attainable GOP/s ("
+       << (memoryBound ? "memory" : "compute") << " bound, peak "
+       << m_peakGOPs << " GOP/s, ridge point " << ridgePoint
+       << " ops/byte)" << endl;
+  cout << endl;
+
+  // Restore locale and formatting
+  cout.unsetf(ios::floatfield);
+  cout << setprecision(6);
+  cout.imbue(previousLocale);
+
+  // Write a JSON object for each kernel invocation, one per line
+  if (m_json.is_open() && m_json.good())
+  {
+    Size3 globalSize = kernelInvocation->getGlobalSize();
+    Size3 localSize = kernelInvocation->getLocalSize();
+    m_json << "{\"kernel\":\"" << kernelInvocation->getKernel()->getName()
+           << "\",\"global_size\":[" << globalSize.x << "," << globalSize.y
+           << "," << globalSize.z << "],\"local_size\":[" << localSize.x
+           << "," << localSize.y << "," << localSize.z
+           << "],\"flops\":" << m_totals.flops
+           << ",\"intops\":" << m_totals.intops << ",\"bytes\":{";
+    for (unsigned i = 0; i < 4; i++)
+    {
+      m_json << (i ? "," : "") << "\"" << getAddressSpaceName(i)
+             << "\":{\"load\":" << m_totals.loadBytes[i]
+             << ",\"store\":" << m_totals.storeBytes[i] << "}";
+    }
+    m_json << "},\"intensity\":";
+    if (globalBytes)
+      m_json << intensity;
+    else
+      m_json << "null";
+    m_json << ",\"attainable_gops\":" << attainable
+           << ",\"peak_gops\":" << m_peakGOPs
+           << ",\"bandwidth_gbs\":" << m_bandwidthGBs
+           << ",\"bound\":\"" << (memoryBound ? "memory" : "compute")
+           << "\"}" << endl;
+  }
+}
+
+void Roofline::memoryAtomicLoad(const Memory* memory, const WorkItem* workItem,
+                                AtomicOp op, size_t address, size_t size)
+{
+  m_state.loadBytes[memory->getAddressSpace()] += size;
+}
+
+void Roofline::memoryAtomicStore(const Memory* memory,
+                                 const WorkItem* workItem, AtomicOp op,
+                                 size_t address, size_t size)
+{
+  m_state.storeBytes[memory->getAddressSpace()] += size;
+}
+
+void Roofline::memoryLoad(const Memory* memory, const WorkItem* workItem,
+                          size_t address, size_t size)
+{
+  m_state.loadBytes[memory->getAddressSpace()] += size;
+}
+
+void Roofline::memoryLoad(const Memory* memory, const WorkGroup* workGroup,
+                          size_t address, size_t size)
+{
+  m_state.loadBytes[memory->getAddressSpace()] += size;
+}
+
+void Roofline::memoryStore(const Memory* memory, const WorkItem* workItem,
+                           size_t address, size_t size,
+                           const uint8_t* storeData)
+{
+  m_state.storeBytes[memory->getAddressSpace()] += size;
+}
+
+void Roofline::memoryStore(const Memory* memory, const WorkGroup* workGroup,
+                           size_t address, size_t size,
+                           const uint8_t* storeData)
+{
+  m_state.storeBytes[memory->getAddressSpace()] += size;
+}
+
+void Roofline::workGroupBegin(const WorkGroup* workGroup)
+{
+  m_state = {0};
+}
+
+void Roofline::workGroupComplete(const WorkGroup* workGroup)
+{
+  lock_guard<mutex> lock(m_mtx);
+  m_totals.flops += m_state.flops;
+  m_totals.intops += m_state.intops;
+  for (unsigned i = 0; i < 4; i++)
+  {
+    m_totals.loadBytes[i] += m_state.loadBytes[i];
+    m_totals.storeBytes[i] += m_state.storeBytes[i];
+  }
+}
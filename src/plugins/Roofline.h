@@ -0,0 +1,73 @@
+// Roofline.h (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#include "core/Plugin.h"
+
+#include <fstream>
+#include <mutex>
+
+namespace oclgrind
+{
+// Counts the floating point and integer operations executed by each kernel
+// and the bytes it moves in each address space, and places the kernel on a
+// roofline for the device profile used by the performance model.
+class Roofline : public Plugin
+{
+public:
+  Roofline(const Context* context);
+
+  virtual void instructionExecuted(const WorkItem* workItem,
+                                   const llvm::Instruction* instruction,
+                                   const TypedValue& result) override;
+  virtual void kernelBegin(const KernelInvocation* kernelInvocation) override;
+  virtual void kernelEnd(const KernelInvocation* kernelInvocation) override;
+  virtual void memoryAtomicLoad(const Memory* memory, const WorkItem* workItem,
+                                AtomicOp op, size_t address,
+                                size_t size) override;
+  virtual void memoryAtomicStore(const Memory* memory, const WorkItem* workItem,
+                                 AtomicOp op, size_t address,
+                                 size_t size) override;
+  virtual void memoryLoad(const Memory* memory, const WorkItem* workItem,
+                          size_t address, size_t size) override;
+  virtual void memoryLoad(const Memory* memory, const WorkGroup* workGroup,
+                          size_t address, size_t size) override;
+  virtual void memoryStore(const Memory* memory, const WorkItem* workItem,
+                           size_t address, size_t size,
+                           const uint8_t* storeData) override;
+  virtual void memoryStore(const Memory* memory, const WorkGroup* workGroup,
+                           size_t address, size_t size,
+                           const uint8_t* storeData) override;
+  virtual void workGroupBegin(const WorkGroup* workGroup) override;
+  virtual void workGroupComplete(const WorkGroup* workGroup) override;
+
+private:
+  // Device profile
+  double m_peakGOPs;
+  double m_bandwidthGBs;
+
+  // Operations and bytes counted for a work-group or a kernel
+  struct Counts
+  {
+    size_t flops;
+    size_t intops;
+    size_t loadBytes[4];
+    size_t storeBytes[4];
+  };
+  static THREAD_LOCAL Counts m_state;
+
+  // Floating point operations per result element of each math function in
+  // the current kernel's module, which is only read while the kernel runs
+  std::unordered_map<const llvm::Function*, unsigned> m_callFlops;
+
+  // Totals for the current kernel
+  Counts m_totals;
+  std::mutex m_mtx;
+
+  std::ofstream m_json;
+};
+} // namespace oclgrind
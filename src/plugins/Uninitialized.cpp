@@ -133,7 +133,9 @@ void Uninitialized::checkStructMemcpy(const WorkItem* workItem,
     FATAL_ERROR("Unsupported addressspace %d", srcAddrSpace);
   }
 
-  if (!ShadowContext::isCleanStruct(shadowMemory, srcAddr, structTy))
+  const InterpreterCache::TypeLayout& layout =
+    workItem->getInterpreterCache()->getTypeLayout(structTy);
+  if (!ShadowContext::isCleanStruct(shadowMemory, srcAddr, layout.scalars))
   {
     logUninitializedWrite(srcAddrSpace, srcAddr);
   }
@@ -166,21 +168,6 @@ void Uninitialized::copyShadowMemoryStrided(
   delete[] v.data;
 }
 
-std::string Uninitialized::extractUnmangledName(const std::string fullname)
-{
-  // Extract unmangled name
-  if (fullname.compare(0, 2, "_Z") == 0)
-  {
-    int len = atoi(fullname.c_str() + 2);
-    int start = fullname.find_first_not_of("0123456789", 2);
-    return fullname.substr(start, len);
-  }
-  else
-  {
-    return fullname;
-  }
-}
-
 ShadowMemory* Uninitialized::getShadowMemory(unsigned addrSpace,
                                              const WorkItem* workItem,
                                              const WorkGroup* workGroup) const
@@ -223,7 +210,7 @@ bool Uninitialized::handleBuiltinFunction(const WorkItem* workItem, string name,
                                           const llvm::CallInst* CI,
                                           const TypedValue result)
 {
-  name = extractUnmangledName(name);
+  name = getUnmangledName(name);
   ShadowValues* shadowValues =
     shadowContext.getShadowWorkItem(workItem)->getValues();
 
@@ -1121,6 +1108,7 @@ void Uninitialized::instructionExecuted(const WorkItem* workItem,
 
     break;
   }
+  case llvm::Instruction::AddrSpaceCast:
   case llvm::Instruction::BitCast:
   {
     TypedValue shadow =
@@ -2823,48 +2811,25 @@ bool ShadowContext::isCleanImageFormat(const TypedValue shadowImage)
           ShadowContext::isCleanValue(image->format.image_channel_data_type));
 }
 
-bool ShadowContext::isCleanStruct(ShadowMemory* shadowMemory, size_t address,
-                                  const llvm::StructType* structTy)
+bool ShadowContext::isCleanStruct(
+  ShadowMemory* shadowMemory, size_t address,
+  const vector<pair<unsigned, unsigned>>& scalars)
 {
-  if (structTy->isPacked())
+  // Check each member of the flattened struct
+  for (auto& scalar : scalars)
   {
-    unsigned size = getTypeSize(structTy);
+    unsigned size = scalar.second;
     TypedValue v = {size, 1, m_workSpace.memoryPool->alloc(size)};
 
-    shadowMemory->load(v.data, address, size);
+    shadowMemory->load(v.data, address + scalar.first, size);
 
-    return isCleanValue(v);
-  }
-  else
-  {
-    for (unsigned i = 0; i < structTy->getStructNumElements(); ++i)
+    if (!isCleanValue(v))
     {
-      size_t offset = getStructMemberOffset(structTy, i);
-      unsigned size = getTypeSize(structTy->getElementType(i));
-
-      if (const llvm::StructType* elemTy =
-            llvm::dyn_cast<llvm::StructType>(structTy->getElementType(i)))
-      {
-        if (!isCleanStruct(shadowMemory, address + offset, elemTy))
-        {
-          return false;
-        }
-      }
-      else
-      {
-        TypedValue v = {size, 1, m_workSpace.memoryPool->alloc(size)};
-
-        shadowMemory->load(v.data, address + offset, size);
-
-        if (!isCleanValue(v))
-        {
-          return false;
-        }
-      }
+      return false;
     }
-
-    return true;
   }
+
+  return true;
 }
 
 bool ShadowContext::isCleanValue(unsigned long v)
@@ -234,8 +234,9 @@ public:
   static bool isCleanImageAddress(const TypedValue shadowImage);
   static bool isCleanImageDescription(const TypedValue shadowImage);
   static bool isCleanImageFormat(const TypedValue shadowImage);
-  static bool isCleanStruct(ShadowMemory* shadowMemory, size_t address,
-                            const llvm::StructType* structTy);
+  static bool
+  isCleanStruct(ShadowMemory* shadowMemory, size_t address,
+                const std::vector<std::pair<unsigned, unsigned>>& scalars);
   static bool isCleanValue(unsigned long v);
   static bool isCleanValue(TypedValue v);
   static bool isCleanValue(TypedValue v, unsigned offset);
@@ -304,7 +305,6 @@ private:
                                const WorkItem* workItem = NULL,
                                const WorkGroup* workGroup = NULL,
                                bool unchecked = false);
-  static std::string extractUnmangledName(const std::string fullname);
   ShadowMemory* getShadowMemory(unsigned addrSpace,
                                 const WorkItem* workItem = NULL,
                                 const WorkGroup* workGroup = NULL) const;
@@ -19,21 +19,16 @@
 using namespace oclgrind;
 using namespace std;
 
-// Maps to keep track of retained objects
-static map<Command*, list<cl_mem>> memObjectMap;
-static map<Command*, cl_kernel> kernelMap;
-static map<Command*, cl_event> eventMap;
-static map<Command*, list<cl_event>> waitListMap;
-
 void asyncEnqueue(cl_command_queue queue, cl_command_type type, Command* cmd,
                   cl_uint numEvents, const cl_event* waitList,
                   cl_event* eventOut)
 {
   // Add event wait list to command
+  cmd->clWaitList.reserve(numEvents);
   for (unsigned i = 0; i < numEvents; i++)
   {
     cmd->waitList.push_back(waitList[i]->event);
-    waitListMap[cmd].push_back(waitList[i]);
+    cmd->clWaitList.push_back(waitList[i]);
     clRetainEvent(waitList[i]);
   }
 
@@ -49,8 +44,8 @@ void asyncEnqueue(cl_command_queue queue, cl_command_type type, Command* cmd,
   _event->event = event;
   _event->refCount = 1;
 
-  // Add event to map
-  eventMap[cmd] = _event;
+  // Store event in command
+  cmd->clEvent = _event;
 
   // Pass event as output and retain (if required)
   if (eventOut)
@@ -62,20 +57,21 @@ void asyncEnqueue(cl_command_queue queue, cl_command_type type, Command* cmd,
 
 void asyncQueueRetain(Command* cmd, cl_mem mem)
 {
-  // Retain object and add to map
+  // Retain object and store in command
   clRetainMemObject(mem);
-  memObjectMap[cmd].push_back(mem);
+  cmd->clMemObjects.push_back(mem);
 }
 
 void asyncQueueRetain(Command* cmd, cl_kernel kernel)
 {
-  assert(kernelMap.find(cmd) == kernelMap.end());
+  assert(!cmd->clKernel);
 
-  // Retain kernel and add to map
+  // Retain kernel and store in command
   clRetainKernel(kernel);
-  kernelMap[cmd] = kernel;
+  cmd->clKernel = kernel;
 
   // Retain memory objects arguments
+  cmd->clMemObjects.reserve(cmd->clMemObjects.size() + kernel->memArgs.size());
   map<cl_uint, cl_mem>::const_iterator itr;
   for (itr = kernel->memArgs.begin(); itr != kernel->memArgs.end(); itr++)
   {
@@ -86,46 +82,41 @@ void asyncQueueRetain(Command* cmd, cl_kernel kernel)
 void asyncQueueRelease(Command* cmd)
 {
   // Release memory objects
-  if (memObjectMap.find(cmd) != memObjectMap.end())
+  for (cl_mem mem : cmd->clMemObjects)
   {
-    list<cl_mem> memObjects = memObjectMap[cmd];
-    while (!memObjects.empty())
-    {
-      clReleaseMemObject(memObjects.front());
-      memObjects.pop_front();
-    }
-    memObjectMap.erase(cmd);
+    clReleaseMemObject(mem);
   }
+  cmd->clMemObjects.clear();
 
   // Release kernel
   if (cmd->type == Command::KERNEL)
   {
-    assert(kernelMap.find(cmd) != kernelMap.end());
-    clReleaseKernel(kernelMap[cmd]);
-    kernelMap.erase(cmd);
+    assert(cmd->clKernel);
+    clReleaseKernel(cmd->clKernel);
+    cmd->clKernel = NULL;
     delete ((KernelCommand*)cmd)->kernel;
   }
 
-  // Remove event from map
-  cl_event event = eventMap[cmd];
-  eventMap.erase(cmd);
+  cl_event event = cmd->clEvent;
 
-  // Perform callbacks
+  // Perform callbacks (on a copy, as a callback may register another)
+  list<pair<void(CL_CALLBACK*)(cl_event, cl_int, void*), void*>> callbacks;
+  {
+    lock_guard<mutex> lock(event->callbackMutex);
+    callbacks = event->callbacks;
+  }
   list<pair<void(CL_CALLBACK*)(cl_event, cl_int, void*), void*>>::iterator
     callItr;
-  for (callItr = event->callbacks.begin(); callItr != event->callbacks.end();
-       callItr++)
+  for (callItr = callbacks.begin(); callItr != callbacks.end(); callItr++)
   {
     callItr->first(event, event->event->state, callItr->second);
   }
 
   // Release events
-  list<cl_event>::iterator waitItr;
-  for (waitItr = waitListMap[cmd].begin(); waitItr != waitListMap[cmd].end();
-       waitItr++)
+  for (cl_event waitEvent : cmd->clWaitList)
   {
-    clReleaseEvent(*waitItr);
+    clReleaseEvent(waitEvent);
   }
-  waitListMap.erase(cmd);
+  cmd->clWaitList.clear();
   clReleaseEvent(event);
 }
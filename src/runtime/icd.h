@@ -114,9 +114,11 @@
 #define clCreateEventFromGLsyncKHR _clCreateEventFromGLsyncKHR
 #endif // OCLGRIND_ICD
 
+#include <atomic>
 #include <cstdint>
 #include <list>
 #include <map>
+#include <mutex>
 #include <stack>
 #include <vector>
 
@@ -164,16 +166,24 @@ struct _cl_device_id
   size_t maxWGSize;
 };
 
+struct SVMAllocation
+{
+  size_t size;
+  size_t address;
+};
+
 struct _cl_context
 {
   void* dispatch;
   oclgrind::Context* context;
+  std::map<const void*, SVMAllocation> svmAllocations;
+  std::mutex svmMutex;
   void(CL_CALLBACK* notify)(const char*, const void*, size_t, void*);
   void* data;
   cl_context_properties* properties;
   size_t szProperties;
   std::stack<std::pair<void(CL_CALLBACK*)(cl_context, void*), void*>> callbacks;
-  unsigned int refCount;
+  std::atomic<unsigned int> refCount;
 };
 
 struct _cl_command_queue
@@ -183,7 +193,8 @@ struct _cl_command_queue
   cl_context context;
   std::vector<cl_queue_properties> properties_array;
   oclgrind::Queue* queue;
-  unsigned int refCount;
+  cl_uint size;
+  std::atomic<unsigned int> refCount;
 };
 
 struct _cl_mem
@@ -196,10 +207,11 @@ struct _cl_mem
   size_t offset;
   cl_mem_flags flags;
   bool isImage;
+  bool isPipe;
   void* hostPtr;
   std::stack<std::pair<void(CL_CALLBACK*)(cl_mem, void*), void*>> callbacks;
   std::vector<cl_mem_properties> properties;
-  unsigned int refCount;
+  std::atomic<unsigned int> refCount;
 };
 
 struct cl_image : _cl_mem
@@ -208,12 +220,18 @@ struct cl_image : _cl_mem
   cl_image_desc desc;
 };
 
+struct cl_pipe : _cl_mem
+{
+  cl_uint packetSize;
+  cl_uint maxPackets;
+};
+
 struct _cl_program
 {
   void* dispatch;
   oclgrind::Program* program;
   cl_context context;
-  unsigned int refCount;
+  std::atomic<unsigned int> refCount;
 };
 
 struct _cl_kernel
@@ -223,7 +241,7 @@ struct _cl_kernel
   cl_program program;
   std::map<cl_uint, cl_mem> memArgs;
   std::vector<oclgrind::Image*> imageArgs;
-  unsigned int refCount;
+  std::atomic<unsigned int> refCount;
 };
 
 struct _cl_event
@@ -235,7 +253,8 @@ struct _cl_event
   oclgrind::Event* event;
   std::list<std::pair<void(CL_CALLBACK*)(cl_event, cl_int, void*), void*>>
     callbacks;
-  unsigned int refCount;
+  std::mutex callbackMutex;
+  std::atomic<unsigned int> refCount;
 };
 
 struct _cl_sampler
@@ -247,7 +266,7 @@ struct _cl_sampler
   cl_filter_mode filterMode;
   std::vector<cl_sampler_properties> properties;
   uint32_t sampler;
-  unsigned int refCount;
+  std::atomic<unsigned int> refCount;
 };
 
 extern void* m_dispatchTable[256];
@@ -196,7 +196,16 @@ static bool parseArguments(int argc, char* argv[])
 {
   for (int i = 1; i < argc; i++)
   {
-    if (!strcmp(argv[i], "--build-options"))
+    if (!strcmp(argv[i], "--analysis-threads"))
+    {
+      if (++i >= argc)
+      {
+        cerr << "Missing argument to --analysis-threads" << endl;
+        return false;
+      }
+      setEnvironment("OCLGRIND_ANALYSIS_THREADS", argv[i]);
+    }
+    else if (!strcmp(argv[i], "--build-options"))
     {
       if (++i >= argc)
       {
@@ -205,6 +214,10 @@ static bool parseArguments(int argc, char* argv[])
       }
       setEnvironment("OCLGRIND_BUILD_OPTIONS", argv[i]);
     }
+    else if (!strcmp(argv[i], "--cache-sim"))
+    {
+      setEnvironment("OCLGRIND_CACHE_SIM", "1");
+    }
     else if (!strcmp(argv[i], "--check-api"))
     {
       setEnvironment("OCLGRIND_CHECK_API", "1");
@@ -235,10 +248,18 @@ static bool parseArguments(int argc, char* argv[])
     {
       setEnvironment("OCLGRIND_DISABLE_PCH", "1");
     }
+    else if (!strcmp(argv[i], "--divergence"))
+    {
+      setEnvironment("OCLGRIND_DIVERGENCE", "1");
+    }
     else if (!strcmp(argv[i], "--dump-spir"))
     {
       setEnvironment("OCLGRIND_DUMP_SPIR", "1");
     }
+    else if (!strcmp(argv[i], "--fibers"))
+    {
+      setEnvironment("OCLGRIND_FIBERS", "1");
+    }
     else if (!strcmp(argv[i], "--global-mem-size"))
     {
       if (++i >= argc)
@@ -261,6 +282,10 @@ static bool parseArguments(int argc, char* argv[])
     {
       setEnvironment("OCLGRIND_INTERACTIVE", "1");
     }
+    else if (!strcmp(argv[i], "--interpreter-opt"))
+    {
+      setEnvironment("OCLGRIND_INTERPRETER_OPT", "1");
+    }
     else if (!strcmp(argv[i], "--local-mem-size"))
     {
       if (++i >= argc)
@@ -297,6 +322,15 @@ static bool parseArguments(int argc, char* argv[])
       }
       setEnvironment("OCLGRIND_MAX_WGSIZE", argv[i]);
     }
+    else if (!strcmp(argv[i], "--mem-trace"))
+    {
+      if (++i >= argc)
+      {
+        cerr << "Missing argument to --mem-trace" << endl;
+        return false;
+      }
+      setEnvironment("OCLGRIND_MEM_TRACE", argv[i]);
+    }
     else if (!strcmp(argv[i], "--num-threads"))
     {
       if (++i >= argc)
@@ -315,6 +349,10 @@ static bool parseArguments(int argc, char* argv[])
       }
       setEnvironment("OCLGRIND_PCH_DIR", argv[i]);
     }
+    else if (!strcmp(argv[i], "--perf-model"))
+    {
+      setEnvironment("OCLGRIND_PERF_MODEL", "1");
+    }
     else if (!strcmp(argv[i], "--plugins"))
     {
       if (++i >= argc)
@@ -328,6 +366,20 @@ static bool parseArguments(int argc, char* argv[])
     {
       setEnvironment("OCLGRIND_QUICK", "1");
     }
+    else if (!strcmp(argv[i], "--roofline"))
+    {
+      setEnvironment("OCLGRIND_ROOFLINE", "1");
+    }
+    else if (!strcmp(argv[i], "--roofline-json"))
+    {
+      if (++i >= argc)
+      {
+        cerr << "Missing argument to --roofline-json" << endl;
+        return false;
+      }
+      setEnvironment("OCLGRIND_ROOFLINE", "1");
+      setEnvironment("OCLGRIND_ROOFLINE_JSON", argv[i]);
+    }
     else if (!strcmp(argv[i], "--uniform-writes"))
     {
       setEnvironment("OCLGRIND_UNIFORM_WRITES", "1");
@@ -454,9 +506,15 @@ static void printUsage()
        << "       oclgrind [--help | --version]" << endl
        << endl
        << "Options:" << endl
+       << "  --analysis-threads  NUM      "
+          "Set the number of threads used by decoupled plugins"
+       << endl
        << "  --build-options     OPTIONS  "
           "Additional options to pass to the OpenCL compiler"
        << endl
+       << "  --cache-sim                  "
+          "Simulate L1/L2 caches for global memory accesses"
+       << endl
        << "  --check-api                  "
           "Report errors on API calls"
        << endl
@@ -472,9 +530,15 @@ static void printUsage()
        << "  --disable-pch                "
           "Don't use precompiled headers"
        << endl
+       << "  --divergence                 "
+          "Report branch divergence and SIMD efficiency"
+       << endl
        << "  --dump-spir                  "
           "Dump SPIR to /tmp/oclgrind_*.{ll,bc}"
        << endl
+       << "  --fibers                     "
+          "Run work-items on fibers (user-space threads)"
+       << endl
        << "  --global-mem-size   BYTES    "
           "Change the global memory size of the device"
        << endl
@@ -487,6 +551,9 @@ static void printUsage()
        << "  --interactive [-i]           "
           "Enable interactive mode"
        << endl
+       << "  --interpreter-opt            "
+          "Run extra passes to reduce interpreter overhead"
+       << endl
        << "  --local-mem-size    BYTES    "
           "Change the local memory size of the device"
        << endl
@@ -499,18 +566,30 @@ static void printUsage()
        << "  --max-wgsize        WGSIZE   "
           "Change the maximum work-group size of the device"
        << endl
+       << "  --mem-trace         FILE     "
+          "Write a trace of memory accesses to a file"
+       << endl
        << "  --num-threads       NUM      "
           "Set the number of worker threads to use"
        << endl
        << "  --pch-dir           DIR      "
           "Override directory containing precompiled headers"
        << endl
+       << "  --perf-model                 "
+          "Estimate device execution times of kernels"
+       << endl
        << "  --plugins           PLUGINS  "
           "Load colon separated list of plugin libraries"
        << endl
        << "  --quick [-q]                 "
           "Only run first and last work-group"
        << endl
+       << "  --roofline                   "
+          "Report arithmetic intensity and roofline position"
+       << endl
+       << "  --roofline-json     FILE     "
+          "Also write roofline data for each kernel as JSON"
+       << endl
        << "  --uniform-writes             "
           "Don't suppress uniform write-write data-races"
        << endl
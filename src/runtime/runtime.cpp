@@ -12,6 +12,7 @@
 #include <cmath>
 #include <cstring>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 
 #include "async_queue.h"
@@ -54,6 +55,9 @@ using namespace std;
 #define DEVICE_PROFILE "FULL_PROFILE"
 #define DEVICE_CTS_VERSION "v0000-01-01-00"
 #define DEVICE_SPIR_VERSIONS "1.2"
+#define DEVICE_PIPE_MAX_PACKET_SIZE 1024
+#define DEVICE_QUEUE_PREFERRED_SIZE (16 * 1024)
+#define DEVICE_QUEUE_MAX_SIZE (256 * 1024)
 #define DEVICE_TYPE                                                            \
   (CL_DEVICE_TYPE_CPU | CL_DEVICE_TYPE_GPU | CL_DEVICE_TYPE_ACCELERATOR |      \
    CL_DEVICE_TYPE_DEFAULT)
@@ -248,21 +252,26 @@ CL_API_ENTRY cl_int CL_API_CALL clIcdGetPlatformIDsKHR(
     ReturnError(NULL, CL_INVALID_VALUE);
   }
 
-  if (!m_platform)
+  // Create the platform and device once, even if called from several threads
   {
-    m_platform = new _cl_platform_id;
-    m_platform->dispatch = m_dispatchTable;
-
-    m_device = new _cl_device_id;
-    m_device->dispatch = m_dispatchTable;
-    m_device->globalMemSize = oclgrind::getEnvInt(
-      "OCLGRIND_GLOBAL_MEM_SIZE", DEFAULT_GLOBAL_MEM_SIZE, false);
-    m_device->constantMemSize = oclgrind::getEnvInt(
-      "OCLGRIND_CONSTANT_MEM_SIZE", DEFAULT_CONSTANT_MEM_SIZE, false);
-    m_device->localMemSize = oclgrind::getEnvInt("OCLGRIND_LOCAL_MEM_SIZE",
-                                                 DEFAULT_LOCAL_MEM_SIZE, false);
-    m_device->maxWGSize =
-      oclgrind::getEnvInt("OCLGRIND_MAX_WGSIZE", DEFAULT_MAX_WGSIZE, false);
+    static mutex platformMutex;
+    lock_guard<mutex> lock(platformMutex);
+    if (!m_platform)
+    {
+      m_platform = new _cl_platform_id;
+      m_platform->dispatch = m_dispatchTable;
+
+      m_device = new _cl_device_id;
+      m_device->dispatch = m_dispatchTable;
+      m_device->globalMemSize = oclgrind::getEnvInt(
+        "OCLGRIND_GLOBAL_MEM_SIZE", DEFAULT_GLOBAL_MEM_SIZE, false);
+      m_device->constantMemSize = oclgrind::getEnvInt(
+        "OCLGRIND_CONSTANT_MEM_SIZE", DEFAULT_CONSTANT_MEM_SIZE, false);
+      m_device->localMemSize = oclgrind::getEnvInt(
+        "OCLGRIND_LOCAL_MEM_SIZE", DEFAULT_LOCAL_MEM_SIZE, false);
+      m_device->maxWGSize =
+        oclgrind::getEnvInt("OCLGRIND_MAX_WGSIZE", DEFAULT_MAX_WGSIZE, false);
+    }
   }
 
   if (platforms)
@@ -478,7 +487,8 @@ CL_API_ENTRY cl_int CL_API_CALL clGetDeviceInfo(
                                        " cl_khr_int64_base_atomics"
                                        " cl_khr_int64_extended_atomics"
                                        " cl_khr_byte_addressable_store"
-                                       " cl_khr_fp64";
+                                       " cl_khr_fp64"
+                                       " cl_khr_subgroups";
 
   static constexpr cl_name_version extension_versions[] = {
     {CL_MAKE_VERSION(1, 0, 0), "cl_khr_spir"},
@@ -491,6 +501,7 @@ CL_API_ENTRY cl_int CL_API_CALL clGetDeviceInfo(
     {CL_MAKE_VERSION(1, 0, 0), "cl_khr_int64_extended_atomics"},
     {CL_MAKE_VERSION(1, 0, 0), "cl_khr_byte_addressable_store"},
     {CL_MAKE_VERSION(1, 0, 0), "cl_khr_fp64"},
+    {CL_MAKE_VERSION(1, 0, 0), "cl_khr_subgroups"},
   };
 
   static constexpr cl_name_version opencl_c_all_versions[] = {
@@ -604,15 +615,15 @@ CL_API_ENTRY cl_int CL_API_CALL clGetDeviceInfo(
     break;
   case CL_DEVICE_MAX_PIPE_ARGS:
     result_size = sizeof(cl_uint);
-    result_data.cluint = 0;
+    result_data.cluint = 16;
     break;
   case CL_DEVICE_PIPE_MAX_ACTIVE_RESERVATIONS:
     result_size = sizeof(cl_uint);
-    result_data.cluint = 0;
+    result_data.cluint = 16;
     break;
   case CL_DEVICE_PIPE_MAX_PACKET_SIZE:
     result_size = sizeof(cl_uint);
-    result_data.cluint = 0;
+    result_data.cluint = DEVICE_PIPE_MAX_PACKET_SIZE;
     break;
   case CL_DEVICE_MEM_BASE_ADDR_ALIGN:
     result_size = sizeof(cl_uint);
@@ -702,23 +713,24 @@ CL_API_ENTRY cl_int CL_API_CALL clGetDeviceInfo(
     break;
   case CL_DEVICE_QUEUE_ON_DEVICE_PROPERTIES:
     result_size = sizeof(cl_command_queue_properties);
-    result_data.clcmdqprop = 0;
+    result_data.clcmdqprop =
+      CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_PROFILING_ENABLE;
     break;
   case CL_DEVICE_QUEUE_ON_DEVICE_PREFERRED_SIZE:
     result_size = sizeof(cl_uint);
-    result_data.cluint = 0;
+    result_data.cluint = DEVICE_QUEUE_PREFERRED_SIZE;
     break;
   case CL_DEVICE_QUEUE_ON_DEVICE_MAX_SIZE:
     result_size = sizeof(cl_uint);
-    result_data.cluint = 0;
+    result_data.cluint = DEVICE_QUEUE_MAX_SIZE;
     break;
   case CL_DEVICE_MAX_ON_DEVICE_QUEUES:
     result_size = sizeof(cl_uint);
-    result_data.cluint = 0;
+    result_data.cluint = 1;
     break;
   case CL_DEVICE_MAX_ON_DEVICE_EVENTS:
     result_size = sizeof(cl_uint);
-    result_data.cluint = 0;
+    result_data.cluint = 1024;
     break;
   case CL_DEVICE_NAME:
     result_size = sizeof(DEVICE_NAME);
@@ -826,7 +838,8 @@ CL_API_ENTRY cl_int CL_API_CALL clGetDeviceInfo(
     break;
   case CL_DEVICE_SVM_CAPABILITIES:
     result_size = sizeof(cl_device_svm_capabilities);
-    result_data.svm = 0;
+    result_data.svm =
+      CL_DEVICE_SVM_COARSE_GRAIN_BUFFER | CL_DEVICE_SVM_FINE_GRAIN_BUFFER;
     break;
   case CL_DEVICE_PREFERRED_PLATFORM_ATOMIC_ALIGNMENT:
     result_size = sizeof(cl_uint);
@@ -842,7 +855,8 @@ CL_API_ENTRY cl_int CL_API_CALL clGetDeviceInfo(
     break;
   case CL_DEVICE_MAX_NUM_SUB_GROUPS:
     result_size = sizeof(cl_uint);
-    result_data.cluint = 0;
+    result_data.cluint =
+      (m_device->maxWGSize + SUB_GROUP_SIZE - 1) / SUB_GROUP_SIZE;
     break;
   case CL_DEVICE_SUB_GROUP_INDEPENDENT_FORWARD_PROGRESS:
     result_size = sizeof(cl_bool);
@@ -915,11 +929,11 @@ CL_API_ENTRY cl_int CL_API_CALL clGetDeviceInfo(
     break;
   case CL_DEVICE_DEVICE_ENQUEUE_CAPABILITIES:
     result_size = sizeof(cl_device_device_enqueue_capabilities);
-    result_data.devenqcaps = 0;
+    result_data.devenqcaps = CL_DEVICE_QUEUE_SUPPORTED;
     break;
   case CL_DEVICE_PIPE_SUPPORT:
     result_size = sizeof(cl_bool);
-    result_data.clbool = CL_FALSE;
+    result_data.clbool = CL_TRUE;
     break;
   case CL_DEVICE_LATEST_CONFORMANCE_VERSION_PASSED:
     result_size = sizeof(DEVICE_CTS_VERSION);
@@ -1119,6 +1133,12 @@ CL_API_ENTRY cl_int CL_API_CALL clReleaseContext(cl_context context)
       context->callbacks.pop();
     }
 
+    // Free SVM allocations that the application didn't free
+    while (!context->svmAllocations.empty())
+    {
+      clSVMFree(context, (void*)context->svmAllocations.begin()->first);
+    }
+
     delete context->context;
     delete context;
   }
@@ -1217,6 +1237,7 @@ clCreateCommandQueue(cl_context context, cl_device_id device,
   queue->properties = properties;
   queue->context = context;
   queue->refCount = 1;
+  queue->size = 0;
 
   clRetainContext(context);
 
@@ -1323,8 +1344,14 @@ CL_API_ENTRY cl_int CL_API_CALL clGetCommandQueueInfo(
     data = command_queue->properties_array.data();
     break;
   case CL_QUEUE_SIZE:
-    ReturnErrorArg(command_queue->context, CL_INVALID_COMMAND_QUEUE,
-                   param_name);
+    if (!(command_queue->properties & CL_QUEUE_ON_DEVICE))
+    {
+      ReturnErrorArg(command_queue->context, CL_INVALID_COMMAND_QUEUE,
+                     param_name);
+    }
+    result_size = sizeof(cl_uint);
+    result_data.cluint = command_queue->size;
+    break;
   case CL_QUEUE_DEVICE_DEFAULT:
     result_size = sizeof(cl_command_queue);
     result_data.queue = nullptr;
@@ -1395,6 +1422,7 @@ cl_mem createBuffer(cl_context context, cl_mem_flags flags, size_t size,
   mem->offset = 0;
   mem->flags = flags;
   mem->isImage = false;
+  mem->isPipe = false;
   mem->refCount = 1;
   if (flags & CL_MEM_USE_HOST_PTR)
   {
@@ -1532,6 +1560,7 @@ CL_API_ENTRY cl_mem CL_API_CALL clCreateSubBuffer(
   mem->size = region.size;
   mem->offset = region.origin;
   mem->isImage = false;
+  mem->isPipe = false;
   mem->flags = memFlags;
   mem->hostPtr = (unsigned char*)buffer->hostPtr + region.origin;
   mem->refCount = 1;
@@ -1720,8 +1749,19 @@ cl_mem createImage(cl_context context, cl_mem_flags flags,
   }
 
   // Create image object wrapper
+  // (copied field by field, as the reference count is not copyable)
   cl_image* image = new cl_image;
-  *(cl_mem)image = *mem;
+  image->dispatch = mem->dispatch;
+  image->context = mem->context;
+  image->parent = mem->parent;
+  image->address = mem->address;
+  image->size = mem->size;
+  image->offset = mem->offset;
+  image->flags = mem->flags;
+  image->isPipe = mem->isPipe;
+  image->hostPtr = mem->hostPtr;
+  image->callbacks = mem->callbacks;
+  image->properties = mem->properties;
   image->isImage = true;
   image->format = *image_format;
   image->desc = *image_desc;
@@ -2009,9 +2049,12 @@ CL_API_ENTRY cl_int CL_API_CALL clGetMemObjectInfo(
   {
   case CL_MEM_TYPE:
     result_size = sizeof(cl_mem_object_type);
-    result_data.clmemobjty = memobj->isImage
-                               ? ((cl_image*)memobj)->desc.image_type
-                               : CL_MEM_OBJECT_BUFFER;
+    if (memobj->isImage)
+      result_data.clmemobjty = ((cl_image*)memobj)->desc.image_type;
+    else if (memobj->isPipe)
+      result_data.clmemobjty = CL_MEM_OBJECT_PIPE;
+    else
+      result_data.clmemobjty = CL_MEM_OBJECT_BUFFER;
     break;
   case CL_MEM_FLAGS:
     result_size = sizeof(cl_mem_flags);
@@ -3066,6 +3109,9 @@ clSetKernelArg(cl_kernel kernel, cl_uint arg_index, size_t arg_size,
   unsigned int addr = kernel->kernel->getArgumentAddressQualifier(arg_index);
   bool isSampler =
     kernel->kernel->getArgumentTypeName(arg_index) == "sampler_t";
+  unsigned int typeQual = kernel->kernel->getArgumentTypeQualifier(arg_index);
+  bool isPipe = typeQual != (unsigned int)-1 &&
+                (typeQual & CL_KERNEL_ARG_TYPE_PIPE);
 
   if (kernel->kernel->getArgumentSize(arg_index) != arg_size && !isSampler &&
       addr != CL_KERNEL_ARG_ADDRESS_LOCAL)
@@ -3076,6 +3122,13 @@ clSetKernelArg(cl_kernel kernel, cl_uint arg_index, size_t arg_size,
                                    << " bytes");
   }
 
+  if (isPipe && !(arg_value && *(cl_mem*)arg_value &&
+                  (*(cl_mem*)arg_value)->isPipe))
+  {
+    ReturnErrorInfo(kernel->program->context, CL_INVALID_ARG_VALUE,
+                    "Pipe argument requires a pipe object");
+  }
+
   // Prepare argument value
   oclgrind::TypedValue value;
   value.data = new unsigned char[arg_size];
@@ -3403,8 +3456,10 @@ CL_API_ENTRY cl_int CL_API_CALL clWaitForEvents(
       if (event_list[i]->queue)
       {
         oclgrind::Command* cmd = event_list[i]->event->command;
-        event_list[i]->event->queue->execute(cmd, false);
-        releaseCommand(cmd);
+        if (event_list[i]->event->queue->execute(cmd, false))
+        {
+          releaseCommand(cmd);
+        }
 
         // If it's still not complete, update flag
         if (!isComplete(event_list[i]))
@@ -3592,9 +3647,14 @@ CL_API_ENTRY cl_int CL_API_CALL clSetUserEventStatus(
 
   event->event->state = execution_status;
 
-  // Perform callbacks
+  // Perform callbacks (on a copy, as a callback may register another)
+  list<pair<void(CL_CALLBACK*)(cl_event, cl_int, void*), void*>> callbacks;
+  {
+    lock_guard<mutex> lock(event->callbackMutex);
+    callbacks = event->callbacks;
+  }
   list<pair<void(CL_CALLBACK*)(cl_event, cl_int, void*), void*>>::iterator itr;
-  for (itr = event->callbacks.begin(); itr != event->callbacks.end(); itr++)
+  for (itr = callbacks.begin(); itr != callbacks.end(); itr++)
   {
     itr->first(event, execution_status, itr->second);
   }
@@ -3626,6 +3686,7 @@ clSetEventCallback(cl_event event, cl_int command_exec_callback_type,
                    command_exec_callback_type);
   }
 
+  lock_guard<mutex> lock(event->callbackMutex);
   event->callbacks.push_back(make_pair(pfn_notify, user_data));
 
   return CL_SUCCESS;
@@ -4993,6 +5054,7 @@ CL_API_ENTRY cl_int CL_API_CALL clEnqueueNDRangeKernel(
 
   // Set-up offsets and sizes
   oclgrind::KernelCommand* cmd = new oclgrind::KernelCommand();
+  // Snapshot of the kernel arguments, shared until clSetKernelArg is called
   cmd->kernel = new oclgrind::Kernel(*kernel->kernel);
   cmd->work_dim = work_dim;
   cmd->globalSize = oclgrind::Size3(1, 1, 1);
@@ -5496,6 +5558,8 @@ CL_API_ENTRY cl_command_queue CL_API_CALL clCreateCommandQueueWithProperties(
   // Parse properties
   cl_command_queue_properties props = 0;
   bool out_of_order = false;
+  cl_uint size = 0;
+  bool hasSize = false;
   unsigned i = 0;
   while (properties && properties[i])
   {
@@ -5506,17 +5570,12 @@ CL_API_ENTRY cl_command_queue CL_API_CALL clCreateCommandQueueWithProperties(
       {
         out_of_order = true;
       }
-      if (properties[i] & (CL_QUEUE_ON_DEVICE | CL_QUEUE_ON_DEVICE_DEFAULT))
-      {
-        SetErrorInfo(context, CL_INVALID_QUEUE_PROPERTIES,
-                     "On device queues not implemented");
-        return NULL;
-      }
       props = properties[i];
       break;
     case CL_QUEUE_SIZE:
-      SetErrorInfo(context, CL_INVALID_VALUE, "CL_QUEUE_SIZE not implemented");
-      return NULL;
+      size = properties[i];
+      hasSize = true;
+      break;
     default:
       SetErrorInfo(context, CL_INVALID_VALUE, properties);
       return NULL;
@@ -5525,6 +5584,35 @@ CL_API_ENTRY cl_command_queue CL_API_CALL clCreateCommandQueueWithProperties(
   }
   unsigned numProperties = i + 1;
 
+  // Device queues run kernels enqueued from the device, and must be
+  // out-of-order
+  if (props & (CL_QUEUE_ON_DEVICE | CL_QUEUE_ON_DEVICE_DEFAULT))
+  {
+    if (!(props & CL_QUEUE_ON_DEVICE) || !out_of_order)
+    {
+      SetErrorInfo(context, CL_INVALID_VALUE,
+                   "CL_QUEUE_ON_DEVICE requires "
+                   "CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE");
+      return NULL;
+    }
+    if (!hasSize)
+    {
+      size = DEVICE_QUEUE_PREFERRED_SIZE;
+    }
+  }
+  else if (hasSize)
+  {
+    SetErrorInfo(context, CL_INVALID_VALUE,
+                 "CL_QUEUE_SIZE is only valid for device queues");
+    return NULL;
+  }
+  if (size > DEVICE_QUEUE_MAX_SIZE)
+  {
+    SetErrorInfo(context, CL_INVALID_VALUE,
+                 "CL_QUEUE_SIZE must not exceed " << DEVICE_QUEUE_MAX_SIZE);
+    return NULL;
+  }
+
   // Create command-queue object
   cl_command_queue queue;
   queue = new _cl_command_queue;
@@ -5533,6 +5621,7 @@ CL_API_ENTRY cl_command_queue CL_API_CALL clCreateCommandQueueWithProperties(
   queue->properties = props;
   queue->context = context;
   queue->refCount = 1;
+  queue->size = size;
   if (properties)
   {
     queue->properties_array.assign(properties, properties + numProperties);
@@ -5551,8 +5640,96 @@ clCreatePipe(cl_context context, cl_mem_flags flags, cl_uint pipe_packet_size,
 {
   REGISTER_API;
 
-  SetErrorInfo(context, CL_INVALID_OPERATION, "Unimplemented OpenCL 2.0 API");
-  return NULL;
+  // Check parameters
+  if (!context)
+  {
+    SetErrorArg(NULL, CL_INVALID_CONTEXT, context);
+    return NULL;
+  }
+  if (flags == 0)
+  {
+    flags = CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS;
+  }
+  if (flags & ~(cl_mem_flags)(CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS))
+  {
+    SetErrorInfo(context, CL_INVALID_VALUE,
+                 "Only CL_MEM_READ_WRITE and CL_MEM_HOST_NO_ACCESS can be "
+                 "specified for pipes");
+    return NULL;
+  }
+  if (properties && properties[0] != 0)
+  {
+    SetErrorInfo(context, CL_INVALID_VALUE, "Unsupported property");
+    return NULL;
+  }
+  if (pipe_packet_size == 0 || pipe_packet_size > DEVICE_PIPE_MAX_PACKET_SIZE)
+  {
+    SetErrorInfo(context, CL_INVALID_PIPE_SIZE,
+                 "pipe_packet_size must be between 1 and "
+                   << DEVICE_PIPE_MAX_PACKET_SIZE);
+    return NULL;
+  }
+
+  // Round number of packet slots up to a power of two, which must leave room
+  // for the packet count in a reservation ID
+  size_t numSlots = 1;
+  while (numSlots < pipe_max_packets)
+  {
+    numSlots <<= 1;
+  }
+  if (pipe_max_packets == 0 ||
+      numSlots > ((size_t)1 << (sizeof(size_t) * 4 - 1)))
+  {
+    SetErrorInfo(context, CL_INVALID_PIPE_SIZE,
+                 "pipe_max_packets is " << pipe_max_packets);
+    return NULL;
+  }
+
+  // Build initial pipe contents, with each slot ready for its first write
+  size_t packetOffset = sizeof(oclgrind::Pipe) + numSlots * sizeof(cl_uint);
+  packetOffset += sizeof(cl_long16) - 1;
+  packetOffset &= ~(sizeof(cl_long16) - 1);
+  size_t size = packetOffset + numSlots * pipe_packet_size;
+  vector<uint8_t> data(size, 0);
+  oclgrind::Pipe* header = (oclgrind::Pipe*)data.data();
+  header->packetSize = pipe_packet_size;
+  header->maxPackets = pipe_max_packets;
+  header->numSlots = numSlots;
+  header->packetOffset = packetOffset;
+  header->writeIndex = 0;
+  header->readIndex = 0;
+  cl_uint* sequence = (cl_uint*)(header + 1);
+  for (size_t i = 0; i < numSlots; i++)
+  {
+    sequence[i] = i;
+  }
+
+  // Create memory object
+  oclgrind::Memory* globalMemory = context->context->getGlobalMemory();
+  cl_pipe* pipe = new cl_pipe;
+  pipe->dispatch = m_dispatchTable;
+  pipe->context = context;
+  pipe->parent = NULL;
+  pipe->size = size;
+  pipe->offset = 0;
+  pipe->flags = flags;
+  pipe->isImage = false;
+  pipe->isPipe = true;
+  pipe->hostPtr = NULL;
+  pipe->refCount = 1;
+  pipe->packetSize = pipe_packet_size;
+  pipe->maxPackets = pipe_max_packets;
+  pipe->address = globalMemory->allocateBuffer(size, flags, data.data());
+  if (!pipe->address)
+  {
+    SetError(context, CL_MEM_OBJECT_ALLOCATION_FAILURE);
+    delete pipe;
+    return NULL;
+  }
+  clRetainContext(context);
+
+  SetError(context, CL_SUCCESS);
+  return pipe;
 }
 
 CL_API_ENTRY cl_int CL_API_CALL clGetPipeInfo(
@@ -5561,18 +5738,188 @@ CL_API_ENTRY cl_int CL_API_CALL clGetPipeInfo(
 {
   REGISTER_API;
 
-  ReturnErrorInfo(NULL, CL_INVALID_MEM_OBJECT, "Pipes are not supported");
+  // Check pipe is valid
+  if (!pipe)
+  {
+    ReturnErrorArg(NULL, CL_INVALID_MEM_OBJECT, pipe);
+  }
+  if (!pipe->isPipe)
+  {
+    ReturnErrorInfo(pipe->context, CL_INVALID_MEM_OBJECT,
+                    "Memory object is not a pipe");
+  }
+
+  size_t dummy = 0;
+  size_t& result_size = param_value_size_ret ? *param_value_size_ret : dummy;
+  union
+  {
+    cl_uint cluint;
+  } result_data;
+
+  switch (param_name)
+  {
+  case CL_PIPE_PACKET_SIZE:
+    result_size = sizeof(cl_uint);
+    result_data.cluint = ((cl_pipe*)pipe)->packetSize;
+    break;
+  case CL_PIPE_MAX_PACKETS:
+    result_size = sizeof(cl_uint);
+    result_data.cluint = ((cl_pipe*)pipe)->maxPackets;
+    break;
+  case CL_PIPE_PROPERTIES:
+    result_size = 0;
+    break;
+  default:
+    ReturnErrorArg(pipe->context, CL_INVALID_VALUE, param_name);
+  }
+
+  if (param_value)
+  {
+    // Check destination is large enough
+    if (param_value_size < result_size)
+    {
+      ReturnErrorInfo(pipe->context, CL_INVALID_VALUE, ParamValueSizeTooSmall);
+    }
+    else
+    {
+      memcpy(param_value, &result_data, result_size);
+    }
+  }
+
+  return CL_SUCCESS;
 }
 
+namespace
+{
+// Find the global memory address corresponding to a range of an SVM
+// allocation, returning 0 if the range is not part of a single allocation
+size_t getSVMAddress(cl_context context, const void* ptr, size_t size)
+{
+  lock_guard<mutex> lock(context->svmMutex);
+
+  auto itr = context->svmAllocations.upper_bound(ptr);
+  if (itr == context->svmAllocations.begin())
+  {
+    return 0;
+  }
+  itr--;
+
+  size_t offset = (const char*)ptr - (const char*)itr->first;
+  if (offset + size > itr->second.size)
+  {
+    return 0;
+  }
+  return itr->second.address + offset;
+}
+
+// Arguments for deferred release of SVM allocations
+struct SVMFreeArgs
+{
+  cl_command_queue queue;
+  cl_uint num;
+  void** pointers;
+  void(CL_CALLBACK* func)(cl_command_queue, cl_uint, void**, void*);
+  void* data;
+};
+
+void CL_CALLBACK svmFreeCallback(void* args)
+{
+  SVMFreeArgs* svmFree = (SVMFreeArgs*)args;
+
+  if (svmFree->func)
+  {
+    svmFree->func(svmFree->queue, svmFree->num, svmFree->pointers,
+                  svmFree->data);
+  }
+  else
+  {
+    for (cl_uint i = 0; i < svmFree->num; i++)
+    {
+      clSVMFree(svmFree->queue->context, svmFree->pointers[i]);
+    }
+  }
+  delete[] svmFree->pointers;
+}
+} // namespace
+
 CL_API_ENTRY void* CL_API_CALL
 clSVMAlloc(cl_context context, cl_svm_mem_flags flags, size_t size,
            cl_uint alignment) CL_API_SUFFIX__VERSION_2_0
 {
   REGISTER_API;
 
-  notifyAPIError(context, CL_INVALID_OPERATION, __func__,
-                 "Unimplemented OpenCL 2.0 API");
-  return NULL;
+  // Check parameters
+  if (!context)
+  {
+    notifyAPIError(NULL, CL_INVALID_CONTEXT, __func__, "context is NULL");
+    return NULL;
+  }
+  if (flags & CL_MEM_SVM_ATOMICS)
+  {
+    notifyAPIError(context, CL_INVALID_VALUE, __func__,
+                   "CL_MEM_SVM_ATOMICS not supported");
+    return NULL;
+  }
+  if (size == 0 ||
+      size > context->context->getGlobalMemory()->getMaxAllocSize())
+  {
+    notifyAPIError(context, CL_INVALID_VALUE, __func__,
+                   "invalid size for SVM allocation");
+    return NULL;
+  }
+  if (alignment & (alignment - 1))
+  {
+    notifyAPIError(context, CL_INVALID_VALUE, __func__,
+                   "alignment must be a power of two");
+    return NULL;
+  }
+
+  // Default to alignment of largest OpenCL type (long16)
+  if (alignment < 128)
+  {
+    alignment = 128;
+  }
+
+  // Allocate host memory
+  void* ptr;
+#if defined(_WIN32) && !defined(__MINGW32__)
+  ptr = _aligned_malloc(size, alignment);
+#else
+  if (posix_memalign(&ptr, alignment, size))
+  {
+    ptr = NULL;
+  }
+#endif
+  if (!ptr)
+  {
+    return NULL;
+  }
+
+  // Use host memory directly as the storage for a global memory buffer
+  cl_mem_flags memFlags =
+    (flags & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY | CL_MEM_READ_ONLY)) |
+    CL_MEM_USE_HOST_PTR;
+  size_t address =
+    context->context->getGlobalMemory()->createHostBuffer(size, ptr, memFlags);
+  if (!address)
+  {
+#if defined(_WIN32) && !defined(__MINGW32__)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+    return NULL;
+  }
+
+  {
+    lock_guard<mutex> lock(context->svmMutex);
+    context->svmAllocations[ptr] = {size, address};
+  }
+
+  // Let kernels follow host pointers into the allocation
+  context->context->getGlobalMemory()->addSVMRegion(ptr, size, address);
+
+  return ptr;
 }
 
 CL_API_ENTRY void CL_API_CALL clSVMFree(cl_context context, void* svm_pointer)
@@ -5580,8 +5927,37 @@ CL_API_ENTRY void CL_API_CALL clSVMFree(cl_context context, void* svm_pointer)
 {
   REGISTER_API;
 
-  notifyAPIError(context, CL_INVALID_OPERATION, __func__,
-                 "Unimplemented OpenCL 2.0 API");
+  if (!context)
+  {
+    notifyAPIError(NULL, CL_INVALID_CONTEXT, __func__, "context is NULL");
+    return;
+  }
+  if (!svm_pointer)
+  {
+    return;
+  }
+
+  size_t address;
+  {
+    lock_guard<mutex> lock(context->svmMutex);
+    auto itr = context->svmAllocations.find(svm_pointer);
+    if (itr == context->svmAllocations.end())
+    {
+      notifyAPIError(context, CL_INVALID_VALUE, __func__,
+                     "svm_pointer is not an SVM allocation");
+      return;
+    }
+    address = itr->second.address;
+    context->svmAllocations.erase(itr);
+  }
+
+  context->context->getGlobalMemory()->removeSVMRegion(svm_pointer);
+  context->context->getGlobalMemory()->deallocateBuffer(address);
+#if defined(_WIN32) && !defined(__MINGW32__)
+  _aligned_free(svm_pointer);
+#else
+  free(svm_pointer);
+#endif
 }
 
 CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMFree(
@@ -5595,8 +5971,28 @@ CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMFree(
 {
   REGISTER_API;
 
-  ReturnErrorInfo(command_queue->context, CL_INVALID_OPERATION,
-                  "Unimplemented OpenCL 2.0 API");
+  // Check parameters
+  if (!command_queue)
+  {
+    ReturnErrorArg(NULL, CL_INVALID_COMMAND_QUEUE, command_queue);
+  }
+  if (!num_svm_pointers || !svm_pointers)
+  {
+    ReturnErrorInfo(command_queue->context, CL_INVALID_VALUE,
+                    "no SVM pointers specified");
+  }
+
+  // Free pointers once preceding commands have completed
+  SVMFreeArgs args = {command_queue, num_svm_pointers,
+                      new void*[num_svm_pointers], pfn_free_func, user_data};
+  memcpy(args.pointers, svm_pointers, num_svm_pointers * sizeof(void*));
+
+  oclgrind::NativeKernelCommand* cmd =
+    new oclgrind::NativeKernelCommand(svmFreeCallback, &args, sizeof(args));
+  asyncEnqueue(command_queue, CL_COMMAND_SVM_FREE, cmd,
+               num_events_in_wait_list, event_wait_list, event);
+
+  return CL_SUCCESS;
 }
 
 CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMMemcpy(
@@ -5606,8 +6002,71 @@ CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMMemcpy(
 {
   REGISTER_API;
 
-  ReturnErrorInfo(command_queue->context, CL_INVALID_OPERATION,
-                  "Unimplemented OpenCL 2.0 API");
+  // Check parameters
+  if (!command_queue)
+  {
+    ReturnErrorArg(NULL, CL_INVALID_COMMAND_QUEUE, command_queue);
+  }
+  if (!dst_ptr)
+  {
+    ReturnErrorArg(command_queue->context, CL_INVALID_VALUE, dst_ptr);
+  }
+  if (!src_ptr)
+  {
+    ReturnErrorArg(command_queue->context, CL_INVALID_VALUE, src_ptr);
+  }
+  if (((const char*)dst_ptr < (const char*)src_ptr + size) &&
+      ((const char*)src_ptr < (const char*)dst_ptr + size))
+  {
+    ReturnErrorInfo(command_queue->context, CL_MEM_COPY_OVERLAP,
+                    "src_ptr and dst_ptr regions overlap");
+  }
+
+  size_t dst = getSVMAddress(command_queue->context, dst_ptr, size);
+  size_t src = getSVMAddress(command_queue->context, src_ptr, size);
+
+  // Use a buffer copy, read or write depending on which sides are SVM
+  oclgrind::Command* cmd;
+  if (dst && src)
+  {
+    oclgrind::CopyCommand* copy = new oclgrind::CopyCommand();
+    copy->src = src;
+    copy->dst = dst;
+    copy->size = size;
+    cmd = copy;
+  }
+  else if (dst)
+  {
+    oclgrind::BufferCommand* write =
+      new oclgrind::BufferCommand(oclgrind::Command::WRITE);
+    write->ptr = (unsigned char*)src_ptr;
+    write->address = dst;
+    write->size = size;
+    cmd = write;
+  }
+  else if (src)
+  {
+    oclgrind::BufferCommand* read =
+      new oclgrind::BufferCommand(oclgrind::Command::READ);
+    read->ptr = (unsigned char*)dst_ptr;
+    read->address = src;
+    read->size = size;
+    cmd = read;
+  }
+  else
+  {
+    ReturnErrorInfo(command_queue->context, CL_INVALID_VALUE,
+                    "neither src_ptr nor dst_ptr is an SVM allocation");
+  }
+  asyncEnqueue(command_queue, CL_COMMAND_SVM_MEMCPY, cmd,
+               num_events_in_wait_list, event_wait_list, event);
+
+  if (blocking_copy)
+  {
+    return clFinish(command_queue);
+  }
+
+  return CL_SUCCESS;
 }
 
 CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMMemFill(
@@ -5617,8 +6076,46 @@ CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMMemFill(
 {
   REGISTER_API;
 
-  ReturnErrorInfo(command_queue->context, CL_INVALID_OPERATION,
-                  "Unimplemented OpenCL 2.0 API");
+  // Check parameters
+  if (!command_queue)
+  {
+    ReturnErrorArg(NULL, CL_INVALID_COMMAND_QUEUE, command_queue);
+  }
+  if (!pattern)
+  {
+    ReturnErrorArg(command_queue->context, CL_INVALID_VALUE, pattern);
+  }
+  if (pattern_size == 0 || pattern_size > 128 ||
+      (pattern_size & (pattern_size - 1)))
+  {
+    ReturnErrorInfo(command_queue->context, CL_INVALID_VALUE,
+                    "pattern_size (" << pattern_size
+                                     << ") must be a power of two <= 128");
+  }
+  if (size % pattern_size)
+  {
+    ReturnErrorInfo(command_queue->context, CL_INVALID_VALUE,
+                    "size (" << size << ") not a multiple of pattern_size ("
+                             << pattern_size << ")");
+  }
+
+  size_t address = getSVMAddress(command_queue->context, svm_ptr, size);
+  if (!address)
+  {
+    ReturnErrorInfo(command_queue->context, CL_INVALID_VALUE,
+                    "svm_ptr is not an SVM allocation of at least "
+                      << size << " bytes");
+  }
+
+  // Enqueue command
+  oclgrind::FillBufferCommand* cmd = new oclgrind::FillBufferCommand(
+    (const unsigned char*)pattern, pattern_size);
+  cmd->address = address;
+  cmd->size = size;
+  asyncEnqueue(command_queue, CL_COMMAND_SVM_MEMFILL, cmd,
+               num_events_in_wait_list, event_wait_list, event);
+
+  return CL_SUCCESS;
 }
 
 CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMMap(
@@ -5628,8 +6125,40 @@ CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMMap(
 {
   REGISTER_API;
 
-  ReturnErrorInfo(command_queue->context, CL_INVALID_OPERATION,
-                  "Unimplemented OpenCL 2.0 API");
+  // Check parameters
+  if (!command_queue)
+  {
+    ReturnErrorArg(NULL, CL_INVALID_COMMAND_QUEUE, command_queue);
+  }
+  if (!svm_ptr || !size)
+  {
+    ReturnErrorArg(command_queue->context, CL_INVALID_VALUE, svm_ptr);
+  }
+
+  size_t address = getSVMAddress(command_queue->context, svm_ptr, size);
+  if (!address)
+  {
+    ReturnErrorInfo(command_queue->context, CL_INVALID_VALUE,
+                    "svm_ptr is not an SVM allocation of at least "
+                      << size << " bytes");
+  }
+
+  // Host and device share the same storage, so mapping only needs to be
+  // reported to plugins
+  oclgrind::MapCommand* cmd = new oclgrind::MapCommand();
+  cmd->address = address;
+  cmd->offset = 0;
+  cmd->size = size;
+  cmd->flags = flags;
+  asyncEnqueue(command_queue, CL_COMMAND_SVM_MAP, cmd,
+               num_events_in_wait_list, event_wait_list, event);
+
+  if (blocking_map)
+  {
+    return clFinish(command_queue);
+  }
+
+  return CL_SUCCESS;
 }
 
 CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMUnmap(
@@ -5639,8 +6168,26 @@ CL_API_ENTRY cl_int CL_API_CALL clEnqueueSVMUnmap(
 {
   REGISTER_API;
 
-  ReturnErrorInfo(command_queue->context, CL_INVALID_OPERATION,
-                  "Unimplemented OpenCL 2.0 API");
+  // Check parameters
+  if (!command_queue)
+  {
+    ReturnErrorArg(NULL, CL_INVALID_COMMAND_QUEUE, command_queue);
+  }
+
+  size_t address = getSVMAddress(command_queue->context, svm_ptr, 0);
+  if (!svm_ptr || !address)
+  {
+    ReturnErrorArg(command_queue->context, CL_INVALID_VALUE, svm_ptr);
+  }
+
+  // Enqueue command
+  oclgrind::UnmapCommand* cmd = new oclgrind::UnmapCommand();
+  cmd->address = address;
+  cmd->ptr = svm_ptr;
+  asyncEnqueue(command_queue, CL_COMMAND_SVM_UNMAP, cmd,
+               num_events_in_wait_list, event_wait_list, event);
+
+  return CL_SUCCESS;
 }
 
 CL_API_ENTRY cl_sampler CL_API_CALL clCreateSamplerWithProperties(
@@ -5749,8 +6296,47 @@ clSetKernelArgSVMPointer(cl_kernel kernel, cl_uint arg_index,
 {
   REGISTER_API;
 
-  ReturnErrorInfo(kernel->program->context, CL_INVALID_OPERATION,
-                  "Unimplemented OpenCL 2.0 API");
+  // Check parameters are valid
+  if (!kernel)
+  {
+    ReturnErrorArg(NULL, CL_INVALID_KERNEL, kernel);
+  }
+  if (arg_index >= kernel->kernel->getNumArguments())
+  {
+    ReturnErrorInfo(kernel->program->context, CL_INVALID_ARG_INDEX,
+                    "arg_index is " << arg_index << ", but kernel has "
+                                    << kernel->kernel->getNumArguments()
+                                    << " arguments");
+  }
+  unsigned int addr = kernel->kernel->getArgumentAddressQualifier(arg_index);
+  if (addr != CL_KERNEL_ARG_ADDRESS_GLOBAL &&
+      addr != CL_KERNEL_ARG_ADDRESS_CONSTANT)
+  {
+    ReturnErrorInfo(kernel->program->context, CL_INVALID_ARG_INDEX,
+                    "argument " << arg_index << " is not a global pointer");
+  }
+
+  // Translate SVM pointer to the address of the global memory buffer that
+  // shares its storage
+  size_t address = 0;
+  if (arg_value)
+  {
+    address = getSVMAddress(kernel->program->context, arg_value, 0);
+    if (!address)
+    {
+      ReturnErrorInfo(kernel->program->context, CL_INVALID_ARG_VALUE,
+                      "arg_value is not a pointer into an SVM allocation");
+    }
+  }
+
+  oclgrind::TypedValue value = {sizeof(size_t), 1,
+                                new unsigned char[sizeof(size_t)]};
+  value.setPointer(address);
+  kernel->kernel->setArgument(arg_index, value);
+  kernel->memArgs.erase(arg_index);
+  delete[] value.data;
+
+  return CL_SUCCESS;
 }
 
 CL_API_ENTRY cl_int CL_API_CALL clSetKernelExecInfo(
@@ -5759,8 +6345,38 @@ CL_API_ENTRY cl_int CL_API_CALL clSetKernelExecInfo(
 {
   REGISTER_API;
 
-  ReturnErrorInfo(kernel->program->context, CL_INVALID_OPERATION,
-                  "Unimplemented OpenCL 2.0 API");
+  // Check parameters are valid
+  if (!kernel)
+  {
+    ReturnErrorArg(NULL, CL_INVALID_KERNEL, kernel);
+  }
+  if (!param_value)
+  {
+    ReturnErrorArg(kernel->program->context, CL_INVALID_VALUE, param_value);
+  }
+
+  switch (param_name)
+  {
+  case CL_KERNEL_EXEC_INFO_SVM_PTRS:
+    // All SVM allocations are always accessible to kernels
+    break;
+  case CL_KERNEL_EXEC_INFO_SVM_FINE_GRAIN_SYSTEM:
+    if (param_value_size != sizeof(cl_bool))
+    {
+      ReturnErrorArg(kernel->program->context, CL_INVALID_VALUE,
+                     param_value_size);
+    }
+    if (*(const cl_bool*)param_value)
+    {
+      ReturnErrorInfo(kernel->program->context, CL_INVALID_OPERATION,
+                      "Fine-grained system SVM not supported");
+    }
+    break;
+  default:
+    ReturnErrorArg(kernel->program->context, CL_INVALID_VALUE, param_name);
+  }
+
+  return CL_SUCCESS;
 }
 
 CL_API_ENTRY cl_kernel CL_API_CALL clCloneKernel(
@@ -5844,8 +6460,101 @@ CL_API_ENTRY cl_int CL_API_CALL clGetKernelSubGroupInfo(
 {
   REGISTER_API;
 
-  ReturnErrorInfo(kernel->program->context, CL_INVALID_OPERATION,
-                  "Unimplemented OpenCL 2.1 API");
+  // Check parameters are valid
+  if (!kernel)
+  {
+    ReturnErrorArg(NULL, CL_INVALID_KERNEL, kernel);
+  }
+  if (!device || device != m_device)
+  {
+    ReturnErrorArg(kernel->program->context, CL_INVALID_DEVICE, device);
+  }
+
+  size_t dummy;
+  size_t& result_size = param_value_size_ret ? *param_value_size_ret : dummy;
+  union
+  {
+    size_t sizet;
+    size_t sizet3[3];
+  } result_data;
+
+  switch (param_name)
+  {
+  case CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE:
+  case CL_KERNEL_SUB_GROUP_COUNT_FOR_NDRANGE:
+  {
+    // Input is the local size
+    if (!input_value || !input_value_size ||
+        input_value_size % sizeof(size_t) ||
+        input_value_size > 3 * sizeof(size_t))
+    {
+      ReturnErrorArg(kernel->program->context, CL_INVALID_VALUE, input_value);
+    }
+    size_t localSize = 1;
+    for (unsigned i = 0; i < input_value_size / sizeof(size_t); i++)
+    {
+      localSize *= ((const size_t*)input_value)[i];
+    }
+
+    result_size = sizeof(size_t);
+    if (param_name == CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE)
+      result_data.sizet = min<size_t>(localSize, SUB_GROUP_SIZE);
+    else
+      result_data.sizet = (localSize + SUB_GROUP_SIZE - 1) / SUB_GROUP_SIZE;
+    break;
+  }
+  case CL_KERNEL_LOCAL_SIZE_FOR_SUB_GROUP_COUNT:
+  {
+    // Input is the number of sub-groups
+    if (!input_value || input_value_size != sizeof(size_t))
+    {
+      ReturnErrorArg(kernel->program->context, CL_INVALID_VALUE, input_value);
+    }
+    size_t numSubGroups = *(const size_t*)input_value;
+
+    // Output has one element per dimension
+    result_size = param_value_size;
+    if (!result_size || result_size % sizeof(size_t) ||
+        result_size > 3 * sizeof(size_t))
+    {
+      ReturnErrorArg(kernel->program->context, CL_INVALID_VALUE,
+                     param_value_size);
+    }
+    result_data.sizet3[0] = numSubGroups * SUB_GROUP_SIZE;
+    result_data.sizet3[1] = 1;
+    result_data.sizet3[2] = 1;
+    if (result_data.sizet3[0] > m_device->maxWGSize)
+      result_data.sizet3[0] = 0;
+    break;
+  }
+  case CL_KERNEL_MAX_NUM_SUB_GROUPS:
+    result_size = sizeof(size_t);
+    result_data.sizet =
+      (m_device->maxWGSize + SUB_GROUP_SIZE - 1) / SUB_GROUP_SIZE;
+    break;
+  case CL_KERNEL_COMPILE_NUM_SUB_GROUPS:
+    result_size = sizeof(size_t);
+    result_data.sizet = 0;
+    break;
+  default:
+    ReturnErrorArg(kernel->program->context, CL_INVALID_VALUE, param_name);
+  }
+
+  if (param_value)
+  {
+    // Check destination is large enough
+    if (param_value_size < result_size)
+    {
+      ReturnErrorInfo(kernel->program->context, CL_INVALID_VALUE,
+                      ParamValueSizeTooSmall);
+    }
+    else
+    {
+      memcpy(param_value, &result_data, result_size);
+    }
+  }
+
+  return CL_SUCCESS;
 }
 
 CL_API_ENTRY cl_int CL_API_CALL clSetDefaultDeviceCommandQueue(
@@ -6084,7 +6793,7 @@ void* m_dispatchTable[] = {
   DISPATCH_TABLE_ENTRY(clSetKernelExecInfo),
 
   // cl_khr_sub_groups
-  DISPATCH_TABLE_ENTRY(NULL),
+  DISPATCH_TABLE_ENTRY(clGetKernelSubGroupInfo),
 
   // OpenCL 2.1
   DISPATCH_TABLE_ENTRY(clCloneKernel),
@@ -0,0 +1,118 @@
+// TraceFormat.h (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+// Binary format of the memory access traces written by the MemoryTrace
+// plugin.
+//
+// A trace starts with an 8 byte magic string and a 32-bit version, followed
+// by a sequence of chunks. Each chunk has a 10 byte header:
+//
+//   uint8  type         (TraceChunkType)
+//   uint8  compression  (TraceCompression)
+//   uint32 rawSize      (size of the payload once decompressed)
+//   uint32 storedSize   (size of the payload in the file)
+//
+// All integers in headers are little-endian. Payloads are made of unsigned
+// LEB128 varints (with zig-zag encoding for signed deltas) and raw bytes:
+//
+// Kernel chunk: name length, name, work dimensions, global size (x,y,z),
+// local size (x,y,z). All following chunks refer to this kernel.
+//
+// Records chunk: a sequence of memory access records. Each record starts
+// with a flags byte:
+//
+//   bits 0-1  TraceAccessType
+//   bits 2-3  address space
+//   bit  4    work-item differs from the previous record
+//   bit  5    instruction differs from the previous record
+//
+// followed by the zig-zag delta of the work-item's global linear ID (if bit
+// 4 is set), the instruction ID (if bit 5 is set), the zig-zag delta of the
+// address from the previous record in the same address space, and the size
+// in bytes. Delta state starts from zero at the beginning of each chunk, so
+// chunks can be decoded independently. Accesses made by a whole work-group
+// (async copies) use TRACE_NO_WORK_ITEM and instruction ID 0.
+//
+// Instructions chunk: number of entries, then for each entry the
+// instruction ID, its source line (0 if unknown), and the length and text
+// of the instruction.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace oclgrind
+{
+#define TRACE_MAGIC "OCLGTRC"
+#define TRACE_VERSION 1
+#define TRACE_CHUNK_HEADER_SIZE 10
+#define TRACE_NO_WORK_ITEM UINT64_MAX
+
+enum TraceChunkType
+{
+  TraceChunkKernel = 1,
+  TraceChunkRecords = 2,
+  TraceChunkInstructions = 3,
+};
+
+enum TraceCompression
+{
+  TraceCompressionNone = 0,
+  TraceCompressionZlib = 1,
+};
+
+enum TraceAccessType
+{
+  TraceLoad = 0,
+  TraceStore = 1,
+  TraceAtomicLoad = 2,
+  TraceAtomicStore = 3,
+};
+
+#define TRACE_FLAG_WORK_ITEM 0x10
+#define TRACE_FLAG_INSTRUCTION 0x20
+
+inline void traceWriteVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    out.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((uint8_t)value);
+}
+
+inline void traceWriteDelta(std::vector<uint8_t>& out, uint64_t value,
+                            uint64_t previous)
+{
+  int64_t delta = (int64_t)(value - previous);
+  traceWriteVarint(out, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+}
+
+inline void traceWriteString(std::vector<uint8_t>& out, const std::string& str)
+{
+  traceWriteVarint(out, str.size());
+  out.insert(out.end(), str.begin(), str.end());
+}
+
+inline void traceWriteUInt32(uint8_t* out, uint32_t value)
+{
+  for (unsigned i = 0; i < 4; i++)
+    out[i] = (uint8_t)(value >> (i * 8));
+}
+
+inline uint32_t traceReadUInt32(const uint8_t* in)
+{
+  uint32_t value = 0;
+  for (unsigned i = 0; i < 4; i++)
+    value |= (uint32_t)in[i] << (i * 8);
+  return value;
+}
+} // namespace oclgrind
@@ -0,0 +1,185 @@
+// TraceReader.cpp (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#include "config.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "TraceReader.h"
+
+using namespace oclgrind;
+using namespace std;
+
+TraceReader::TraceReader(const string& filename)
+{
+  m_file.open(filename, ios::in | ios::binary);
+  if (!m_file.good())
+    throw runtime_error("Unable to open trace file '" + filename + "'");
+
+  uint8_t header[12];
+  m_file.read((char*)header, sizeof(header));
+  if (m_file.gcount() != sizeof(header) ||
+      memcmp(header, TRACE_MAGIC, 8) != 0)
+    throw runtime_error("'" + filename + "' is not an Oclgrind trace file");
+  if (traceReadUInt32(header + 8) != TRACE_VERSION)
+    throw runtime_error("Unsupported trace file version");
+
+  m_chunkType = 0;
+  m_offset = 0;
+  m_remaining = 0;
+}
+
+bool TraceReader::next(Entry& entry)
+{
+  // Move on to the next non-empty chunk
+  while (m_offset >= m_chunk.size() ||
+         (m_chunkType == TraceChunkInstructions && !m_remaining))
+  {
+    if (!readChunk())
+      return false;
+  }
+
+  switch (m_chunkType)
+  {
+  case TraceChunkKernel:
+  {
+    entry.type = KERNEL;
+    entry.kernelName = readString();
+    entry.workDim = readVarint();
+    for (unsigned i = 0; i < 3; i++)
+      entry.globalSize[i] = readVarint();
+    for (unsigned i = 0; i < 3; i++)
+      entry.localSize[i] = readVarint();
+    m_offset = m_chunk.size();
+    break;
+  }
+  case TraceChunkRecords:
+  {
+    uint8_t flags = m_chunk[m_offset++];
+    entry.type = RECORD;
+    entry.accessType = (TraceAccessType)(flags & 0x3);
+    entry.addressSpace = (flags >> 2) & 0x3;
+    if (flags & TRACE_FLAG_WORK_ITEM)
+      m_workItem = readDelta(m_workItem);
+    if (flags & TRACE_FLAG_INSTRUCTION)
+      m_instruction = readVarint();
+    m_addresses[entry.addressSpace] =
+      readDelta(m_addresses[entry.addressSpace]);
+    entry.workItem = m_workItem;
+    entry.instruction = m_instruction;
+    entry.address = m_addresses[entry.addressSpace];
+    entry.size = readVarint();
+    break;
+  }
+  case TraceChunkInstructions:
+  {
+    entry.type = INSTRUCTION;
+    entry.instruction = readVarint();
+    entry.line = readVarint();
+    entry.text = readString();
+    m_remaining--;
+    break;
+  }
+  }
+
+  return true;
+}
+
+bool TraceReader::readChunk()
+{
+  uint8_t header[TRACE_CHUNK_HEADER_SIZE];
+  m_file.read((char*)header, sizeof(header));
+  if (m_file.gcount() == 0)
+    return false;
+  if (m_file.gcount() != sizeof(header))
+    throw runtime_error("Truncated trace chunk header");
+
+  m_chunkType = header[0];
+  uint8_t compression = header[1];
+  uint32_t rawSize = traceReadUInt32(header + 2);
+  uint32_t storedSize = traceReadUInt32(header + 6);
+  if (m_chunkType < TraceChunkKernel || m_chunkType > TraceChunkInstructions)
+    throw runtime_error("Invalid trace chunk type");
+
+  vector<uint8_t> stored(storedSize);
+  m_file.read((char*)stored.data(), storedSize);
+  if ((uint32_t)m_file.gcount() != storedSize)
+    throw runtime_error("Truncated trace chunk");
+
+  switch (compression)
+  {
+  case TraceCompressionNone:
+    m_chunk.swap(stored);
+    break;
+  case TraceCompressionZlib:
+  {
+#if HAVE_ZLIB
+    m_chunk.resize(rawSize);
+    uLongf size = rawSize;
+    if (uncompress(m_chunk.data(), &size, stored.data(), storedSize) !=
+          Z_OK ||
+        size != rawSize)
+      throw runtime_error("Corrupt compressed trace chunk");
+    break;
+#else
+    throw runtime_error("Trace is compressed but zlib support is disabled");
+#endif
+  }
+  default:
+    throw runtime_error("Unknown trace chunk compression");
+  }
+  if (m_chunk.size() != rawSize)
+    throw runtime_error("Trace chunk size mismatch");
+
+  m_offset = 0;
+  m_workItem = 0;
+  m_instruction = 0;
+  for (unsigned i = 0; i < 4; i++)
+    m_addresses[i] = 0;
+  if (m_chunkType == TraceChunkInstructions)
+    m_remaining = m_chunk.empty() ? 0 : readVarint();
+
+  return true;
+}
+
+uint64_t TraceReader::readDelta(uint64_t previous)
+{
+  uint64_t value = readVarint();
+  return previous + ((value >> 1) ^ (~(value & 1) + 1));
+}
+
+string TraceReader::readString()
+{
+  uint64_t length = readVarint();
+  if (length > m_chunk.size() - m_offset)
+    throw runtime_error("Truncated string in trace chunk");
+  string str((const char*)m_chunk.data() + m_offset, length);
+  m_offset += length;
+  return str;
+}
+
+uint64_t TraceReader::readVarint()
+{
+  uint64_t value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7)
+  {
+    if (m_offset >= m_chunk.size())
+      throw runtime_error("Truncated varint in trace chunk");
+
+    uint8_t byte = m_chunk[m_offset++];
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return value;
+  }
+  throw runtime_error("Invalid varint in trace chunk");
+}
@@ -0,0 +1,87 @@
+// TraceReader.h (Oclgrind)
+// Copyright (c) 2013-2019, James Price and Simon McIntosh-Smith,
+// University of Bristol. All rights reserved.
+//
+// This program is provided under a three-clause BSD license. For full
+// license terms please see the LICENSE file distributed with this
+// source code.
+
+#pragma once
+
+#include "trace/TraceFormat.h"
+
+#include <fstream>
+
+namespace oclgrind
+{
+// Decodes memory access traces written by the MemoryTrace plugin.
+//
+//   TraceReader reader("oclgrind.trace");
+//   TraceReader::Entry entry;
+//   while (reader.next(entry))
+//   {
+//     if (entry.type == TraceReader::RECORD)
+//       ...
+//   }
+//
+// Errors in the trace file are reported by throwing std::runtime_error.
+class TraceReader
+{
+public:
+  enum EntryType
+  {
+    KERNEL,
+    RECORD,
+    INSTRUCTION,
+  };
+
+  struct Entry
+  {
+    EntryType type;
+
+    // KERNEL
+    std::string kernelName;
+    unsigned workDim;
+    size_t globalSize[3];
+    size_t localSize[3];
+
+    // RECORD
+    TraceAccessType accessType;
+    unsigned addressSpace;
+    uint64_t workItem; // TRACE_NO_WORK_ITEM for work-group copies
+    uint64_t address;
+    uint64_t size;
+
+    // RECORD and INSTRUCTION (0 if no instruction)
+    uint32_t instruction;
+
+    // INSTRUCTION
+    unsigned line;
+    std::string text;
+  };
+
+  TraceReader(const std::string& filename);
+
+  // Read the next entry, returning false at the end of the trace
+  bool next(Entry& entry);
+
+private:
+  std::ifstream m_file;
+
+  // Current chunk
+  uint8_t m_chunkType;
+  std::vector<uint8_t> m_chunk;
+  size_t m_offset;
+  uint64_t m_remaining;
+
+  // Delta decoding state for records
+  uint64_t m_workItem;
+  uint32_t m_instruction;
+  uint64_t m_addresses[4];
+
+  bool readChunk();
+  uint64_t readDelta(uint64_t previous);
+  std::string readString();
+  uint64_t readVarint();
+};
+} // namespace oclgrind
@@ -0,0 +1,44 @@
+#define TILE 8
+#define NUM_TILES 4
+
+kernel void async_copy_tiles(global const int *a, global const int *b,
+                             global int *out, local int *la, local int *lb,
+                             local int *results)
+{
+  int l = get_local_id(0);
+  int n = get_local_size(0);
+
+  // Fetch the first tile of a and of the first column of b
+  event_t events[2];
+  events[0] = async_work_group_copy(la, a, TILE, 0);
+  events[0] = async_work_group_strided_copy(lb, b, TILE, 2, events[0]);
+
+  int sum = 0;
+  for (int t = 0; t < NUM_TILES; t++)
+  {
+    int cur = t % 2;
+    int next = 1 - cur;
+
+    // Prefetch the next tiles while this one is processed
+    if (t + 1 < NUM_TILES)
+    {
+      events[next] = async_work_group_copy(la + next*TILE, a + (t+1)*TILE,
+                                           TILE, 0);
+      events[next] = async_work_group_strided_copy(
+        lb + next*TILE, b + (t+1)*TILE*2, TILE, 2, events[next]);
+    }
+
+    wait_group_events(1, events + cur);
+    for (int k = l; k < TILE; k += n)
+    {
+      sum += la[cur*TILE + k] * lb[cur*TILE + k];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  // Write the results to every other element of the output
+  results[l] = sum;
+  barrier(CLK_LOCAL_MEM_FENCE);
+  event_t event = async_work_group_strided_copy(out, results, n, 2, 0);
+  wait_group_events(1, &event);
+}
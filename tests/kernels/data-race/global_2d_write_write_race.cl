@@ -0,0 +1,4 @@
+kernel void global_2d_write_write_race(global int *data)
+{
+  data[get_global_id(0)] = get_global_id(1);
+}
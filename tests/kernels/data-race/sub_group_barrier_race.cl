@@ -0,0 +1,13 @@
+kernel void sub_group_barrier_race(global int *output, local int *scratch)
+{
+  int l = get_local_id(0);
+  scratch[l] = l;
+  sub_group_barrier(CLK_LOCAL_MEM_FENCE);
+
+  // Work-items in the same sub-group are synchronized, but the first
+  // work-item also reads a value written by the second sub-group
+  int x = scratch[l ^ 1];
+  if (l == 0)
+    x += scratch[32];
+  output[l] = x;
+}
@@ -0,0 +1,11 @@
+struct S
+{
+  int a[2];
+  int b;
+};
+
+kernel void static_array_global_struct(global struct S *s, global int *output)
+{
+  int i = get_global_id(0);
+  output[i] = s[0].a[i] + s[i].b;
+}
@@ -0,0 +1,18 @@
+kernel void conversions(global float *input, global int *output)
+{
+  int i = get_global_id(0);
+  float x = input[i];
+  global int *out = output + i * 8;
+
+  // Float to integer with each rounding mode and saturation
+  out[0] = convert_int_sat_rte(x);
+  out[1] = convert_int_sat_rtz(x);
+  out[2] = convert_int_sat_rtp(x);
+  out[3] = convert_int_sat_rtn(x);
+  out[4] = convert_uchar_sat(x);
+  out[5] = convert_char_sat_rte(x);
+
+  // Integer to float, where only even values are representable
+  out[6] = (int)convert_float_rtp(16777216 + i);
+  out[7] = (int)convert_float_rtn(16777216 + i);
+}
@@ -0,0 +1,32 @@
+kernel void group_collectives(global int *output)
+{
+  int lid = get_local_id(0);
+
+  int sum = sub_group_reduce_add(lid);
+  int smin = sub_group_scan_inclusive_min(35 - lid);
+  int bcast = sub_group_broadcast(lid, 1);
+  int any = sub_group_any(lid == 33);
+  int wmax = work_group_reduce_max(lid);
+  int scan = work_group_scan_exclusive_add(1);
+  int all = work_group_all(lid < 36);
+
+  if (lid == 0)
+  {
+    output[0] = sum;
+    output[1] = smin;
+    output[2] = bcast;
+    output[3] = any;
+    output[4] = get_num_sub_groups();
+  }
+  else if (lid == 35)
+  {
+    output[5] = sum;
+    output[6] = smin;
+    output[7] = bcast;
+    output[8] = any;
+    output[9] = get_sub_group_size();
+    output[10] = wmax;
+    output[11] = scan;
+    output[12] = all;
+  }
+}
@@ -0,0 +1,11 @@
+kernel void half_conversions(global float *input, global half *tmp,
+                             global int *output)
+{
+  float16 v = vload16(0, input);
+
+  // Round trip through half precision with different rounding modes
+  vstore_half16_rtn(v, 0, tmp);
+  vstore_half16_rtp(v, 1, tmp);
+  vstore16(convert_int16(vload_half16(0, tmp)), 0, output);
+  vstore16(convert_int16(vload_half16(1, tmp)), 1, output);
+}
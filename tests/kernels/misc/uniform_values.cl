@@ -0,0 +1,25 @@
+kernel void uniform_values(global int *output, int n)
+{
+  int lid = get_local_id(0);
+  int gid = get_group_id(0);
+  int lsz = get_local_size(0);
+  int base = gid * lsz * 2;
+
+  // Uniform values computed by a subset of work-items
+  if (lid % 2)
+  {
+    output[base + lid] = base + n;
+  }
+  else
+  {
+    output[base + lid] = gid * n;
+  }
+
+  // Uniform loop bound
+  int sum = 0;
+  for (int i = 0; i < n + gid; i++)
+  {
+    sum += i;
+  }
+  output[base + lsz + lid] = sum;
+}
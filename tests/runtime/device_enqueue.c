@@ -0,0 +1,100 @@
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define N 16
+#define LOCAL_SIZE 4
+
+const char* KERNEL_SOURCE =
+  "kernel void parent(global int *out, int n)                           \n"
+  "{                                                                    \n"
+  "  queue_t queue = get_default_queue();                               \n"
+  "  int scale = 3;                                                     \n"
+  "  clk_event_t event;                                                 \n"
+  "  int err = enqueue_kernel(queue, CLK_ENQUEUE_FLAGS_WAIT_KERNEL,     \n"
+  "    ndrange_1D(n), 0, NULL, &event,                                  \n"
+  "    ^{ out[get_global_id(0)] = get_global_id(0) * scale; });         \n"
+  "  release_event(event);                                              \n"
+  "  err |= enqueue_kernel(queue, CLK_ENQUEUE_FLAGS_NO_WAIT,            \n"
+  "    ndrange_1D(n, 4),                                                \n"
+  "    ^(local int *tmp)                                                \n"
+  "    {                                                                \n"
+  "      size_t lid = get_local_id(0);                                  \n"
+  "      tmp[lid] = lid;                                                \n"
+  "      barrier(CLK_LOCAL_MEM_FENCE);                                  \n"
+  "      out[n + get_global_id(0)] = tmp[(lid + 1) % 4];                \n"
+  "    }, 4 * sizeof(int));                                             \n"
+  "  out[2 * n] = err;                                                  \n"
+  "}                                                                    \n";
+
+int main(int argc, char* argv[])
+{
+  cl_int err;
+  cl_kernel kernel;
+  cl_command_queue deviceQueue;
+  cl_mem output;
+  cl_int h_output[2 * N + 1];
+  cl_uint queueSize;
+  cl_int n = N;
+  size_t global = 1;
+
+  Context cl = createContext(KERNEL_SOURCE, "-cl-std=CL2.0");
+
+  // Create the default device queue
+  cl_queue_properties properties[] = {
+    CL_QUEUE_PROPERTIES,
+    CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE |
+      CL_QUEUE_ON_DEVICE_DEFAULT,
+    0};
+  deviceQueue = clCreateCommandQueueWithProperties(cl.context, cl.device,
+                                                   properties, &err);
+  checkError(err, "creating device queue");
+  err = clGetCommandQueueInfo(deviceQueue, CL_QUEUE_SIZE, sizeof(cl_uint),
+                              &queueSize, NULL);
+  checkError(err, "getting device queue size");
+  if (queueSize > 0)
+    printf("OK\n");
+
+  kernel = clCreateKernel(cl.program, "parent", &err);
+  checkError(err, "creating kernel");
+
+  output = clCreateBuffer(cl.context, CL_MEM_WRITE_ONLY, sizeof(h_output),
+                          NULL, &err);
+  checkError(err, "creating output buffer");
+
+  err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &output);
+  err |= clSetKernelArg(kernel, 1, sizeof(cl_int), &n);
+  checkError(err, "setting kernel arguments");
+
+  err = clEnqueueNDRangeKernel(cl.queue, kernel, 1, NULL, &global, NULL, 0,
+                               NULL, NULL);
+  checkError(err, "enqueuing kernel");
+
+  // Child kernels must have completed when the parent completes
+  err = clEnqueueReadBuffer(cl.queue, output, CL_TRUE, 0, sizeof(h_output),
+                            h_output, 0, NULL, NULL);
+  checkError(err, "reading output");
+
+  unsigned errors = 0;
+  for (unsigned i = 0; i < N; i++)
+  {
+    if (h_output[i] != (cl_int)i * 3)
+      errors++;
+    if (h_output[N + i] != (cl_int)(i + 1) % LOCAL_SIZE)
+      errors++;
+  }
+  if (h_output[2 * N] != 0)
+    errors++;
+  if (errors)
+    printf("%u errors detected\n", errors);
+  else
+    printf("OK\n");
+
+  clReleaseMemObject(output);
+  clReleaseKernel(kernel);
+  clReleaseCommandQueue(deviceQueue);
+  releaseContext(cl);
+
+  return 0;
+}
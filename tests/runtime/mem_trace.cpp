@@ -0,0 +1,155 @@
+extern "C"
+{
+#include "common.h"
+}
+
+#include "trace/TraceReader.h"
+
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define N 16
+#define TRACE_FILE "mem_trace.trace"
+
+const char* KERNEL_SOURCE = "kernel void vecadd(global float *a, \n"
+                            "                   global float *b, \n"
+                            "                   global float *c) \n"
+                            "{                                   \n"
+                            "  int i = get_global_id(0);         \n"
+                            "  c[i] = a[i] + b[i];               \n"
+                            "}                                   \n";
+
+static void fail(const char* message)
+{
+  fprintf(stderr, "%s\n", message);
+  exit(1);
+}
+
+// Run a vecadd kernel with memory tracing enabled
+static void runKernel()
+{
+  cl_int err;
+  cl_mem a, b, c;
+  cl_kernel kernel;
+  size_t global = N;
+  float data[N] = {0};
+
+#if defined(_WIN32)
+  _putenv_s("OCLGRIND_MEM_TRACE", TRACE_FILE);
+#else
+  setenv("OCLGRIND_MEM_TRACE", TRACE_FILE, 1);
+#endif
+
+  Context cl = createContext(KERNEL_SOURCE, "");
+
+  kernel = clCreateKernel(cl.program, "vecadd", &err);
+  checkError(err, "creating kernel");
+
+  a = clCreateBuffer(cl.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                     sizeof(data), data, &err);
+  checkError(err, "creating buffer a");
+  b = clCreateBuffer(cl.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                     sizeof(data), data, &err);
+  checkError(err, "creating buffer b");
+  c = clCreateBuffer(cl.context, CL_MEM_WRITE_ONLY, sizeof(data), NULL, &err);
+  checkError(err, "creating buffer c");
+
+  err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &a);
+  err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &b);
+  err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &c);
+  checkError(err, "setting kernel args");
+
+  err = clEnqueueNDRangeKernel(cl.queue, kernel, 1, NULL, &global, NULL, 0,
+                               NULL, NULL);
+  checkError(err, "enqueuing kernel");
+
+  err = clFinish(cl.queue);
+  checkError(err, "running kernel");
+
+  // The trace is completed when the context is destroyed
+  clReleaseMemObject(a);
+  clReleaseMemObject(b);
+  clReleaseMemObject(c);
+  clReleaseKernel(kernel);
+  releaseContext(cl);
+}
+
+// Read the trace back and check it describes the kernel's accesses
+static void checkTrace()
+{
+  unsigned numKernels = 0, numLoads = 0, numStores = 0;
+  std::map<uint32_t, uint64_t> bases;
+  std::set<uint32_t> instructions;
+
+  oclgrind::TraceReader reader(TRACE_FILE);
+  oclgrind::TraceReader::Entry entry;
+  while (reader.next(entry))
+  {
+    switch (entry.type)
+    {
+    case oclgrind::TraceReader::KERNEL:
+      if (entry.kernelName != "vecadd" || entry.workDim != 1 ||
+          entry.globalSize[0] != N)
+        fail("Unexpected kernel entry");
+      numKernels++;
+      break;
+    case oclgrind::TraceReader::RECORD:
+    {
+      if (!numKernels)
+        fail("Record before kernel entry");
+      if (entry.addressSpace != 1 || entry.size != sizeof(float))
+        fail("Unexpected access address space or size");
+      if (entry.workItem >= N || !entry.instruction)
+        fail("Unexpected access work-item or instruction");
+
+      if (entry.accessType == oclgrind::TraceLoad)
+        numLoads++;
+      else if (entry.accessType == oclgrind::TraceStore)
+        numStores++;
+      else
+        fail("Unexpected access type");
+
+      // Each instruction accesses consecutive elements of one buffer
+      uint64_t base = entry.address - entry.workItem * sizeof(float);
+      if (!bases.insert(std::make_pair(entry.instruction, base)).second &&
+          bases[entry.instruction] != base)
+        fail("Unexpected access address");
+      break;
+    }
+    case oclgrind::TraceReader::INSTRUCTION:
+      if (entry.text.empty())
+        fail("Instruction entry without text");
+      instructions.insert(entry.instruction);
+      break;
+    }
+  }
+
+  if (numKernels != 1)
+    fail("Expected a single kernel entry");
+  if (numLoads != 2 * N || numStores != N)
+    fail("Unexpected number of loads or stores");
+  for (auto& base : bases)
+  {
+    if (!instructions.count(base.first))
+      fail("Access instruction missing from instruction entries");
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  runKernel();
+
+  try
+  {
+    checkTrace();
+  }
+  catch (std::runtime_error& err)
+  {
+    fail(err.what());
+  }
+
+  return 0;
+}
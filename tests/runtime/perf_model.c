@@ -0,0 +1,112 @@
+#include "common.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define N 4096
+
+// Bytes of global memory moved per work-item
+#define BYTES_PER_ITEM (3 * sizeof(cl_float))
+
+const char* KERNEL_SOURCE = "kernel void vecadd(global float *a, \n"
+                            "                   global float *b, \n"
+                            "                   global float *c) \n"
+                            "{                                   \n"
+                            "  int i = get_global_id(0);         \n"
+                            "  c[i] = a[i] + b[i];               \n"
+                            "}                                   \n";
+
+static void setEnv(const char* name, const char* value)
+{
+#if defined(_WIN32)
+  _putenv_s(name, value);
+#else
+  setenv(name, value, 1);
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+  cl_int err;
+  cl_mem a, b, c;
+  cl_kernel kernel;
+  cl_command_queue queue;
+  cl_event event;
+  size_t global = N;
+
+  // Use a device whose compute time is negligible next to moving the
+  // kernel's data at 1 GB/s, so the estimate is one nanosecond per byte
+  setEnv("OCLGRIND_PERF_MODEL", "1");
+  setEnv("OCLGRIND_COMPUTE_UNITS", "1");
+  setEnv("OCLGRIND_PERF_LANES", "64");
+  setEnv("OCLGRIND_PERF_CLOCK", "1000000");
+  setEnv("OCLGRIND_PERF_BANDWIDTH", "1");
+  setEnv("OCLGRIND_PERF_GLOBAL_LATENCY", "0");
+  setEnv("OCLGRIND_PERF_LOCAL_LATENCY", "0");
+  setEnv("OCLGRIND_PERF_BARRIER_LATENCY", "0");
+
+  Context cl = createContext(KERNEL_SOURCE, "");
+
+  queue = clCreateCommandQueue(cl.context, cl.device,
+                               CL_QUEUE_PROFILING_ENABLE, &err);
+  checkError(err, "creating profiling queue");
+
+  kernel = clCreateKernel(cl.program, "vecadd", &err);
+  checkError(err, "creating kernel");
+
+  a = clCreateBuffer(cl.context, CL_MEM_READ_ONLY, N * sizeof(cl_float), NULL,
+                     &err);
+  checkError(err, "creating buffer a");
+  b = clCreateBuffer(cl.context, CL_MEM_READ_ONLY, N * sizeof(cl_float), NULL,
+                     &err);
+  checkError(err, "creating buffer b");
+  c = clCreateBuffer(cl.context, CL_MEM_WRITE_ONLY, N * sizeof(cl_float),
+                     NULL, &err);
+  checkError(err, "creating buffer c");
+
+  cl_float zero = 0.f;
+  err = clEnqueueFillBuffer(queue, a, &zero, sizeof(zero), 0,
+                            N * sizeof(cl_float), 0, NULL, NULL);
+  err |= clEnqueueFillBuffer(queue, b, &zero, sizeof(zero), 0,
+                             N * sizeof(cl_float), 0, NULL, NULL);
+  checkError(err, "filling buffers");
+
+  err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &a);
+  err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &b);
+  err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &c);
+  checkError(err, "setting kernel args");
+
+  err = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &global, NULL, 0, NULL,
+                               &event);
+  checkError(err, "enqueuing kernel");
+  err = clFinish(queue);
+  checkError(err, "running kernel");
+
+  cl_ulong start, end;
+  err = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START,
+                                sizeof(start), &start, NULL);
+  err |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end),
+                                 &end, NULL);
+  checkError(err, "getting profiling info");
+
+  // Event times are stored as doubles, so allow for rounding
+  double expected = N * BYTES_PER_ITEM;
+  double elapsed = (double)(end - start);
+  if (fabs(elapsed - expected) > expected * 0.01)
+  {
+    fprintf(stderr, "Kernel took %.0f ns, expected %.0f ns\n", elapsed,
+            expected);
+    exit(1);
+  }
+
+  clReleaseEvent(event);
+  clReleaseMemObject(a);
+  clReleaseMemObject(b);
+  clReleaseMemObject(c);
+  clReleaseKernel(kernel);
+  clReleaseCommandQueue(queue);
+  releaseContext(cl);
+
+  return 0;
+}
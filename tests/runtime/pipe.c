@@ -0,0 +1,117 @@
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N 64
+#define LOCAL_SIZE 16
+
+const char* KERNEL_SOURCE =
+  "kernel void producer(write_only pipe int p)                   \n"
+  "{                                                             \n"
+  "  int i = get_global_id(0);                                   \n"
+  "  write_pipe(p, &i);                                          \n"
+  "}                                                             \n"
+  "                                                              \n"
+  "kernel void group_producer(write_only pipe int p)             \n"
+  "{                                                             \n"
+  "  int i = get_global_size(0) + get_global_id(0);              \n"
+  "  reserve_id_t id =                                           \n"
+  "    work_group_reserve_write_pipe(p, get_local_size(0));      \n"
+  "  if (is_valid_reserve_id(id))                                \n"
+  "    write_pipe(p, id, get_local_id(0), &i);                   \n"
+  "  work_group_commit_write_pipe(p, id);                        \n"
+  "}                                                             \n"
+  "                                                              \n"
+  "kernel void consumer(read_only pipe int p, global int *out)   \n"
+  "{                                                             \n"
+  "  int value;                                                  \n"
+  "  if (read_pipe(p, &value))                                   \n"
+  "    value = -1;                                               \n"
+  "  out[get_global_id(0)] = value;                              \n"
+  "}                                                             \n";
+
+int main(int argc, char* argv[])
+{
+  cl_int err;
+  cl_mem pipe, output;
+  cl_kernel producer, group_producer, consumer;
+  cl_uint packetSize, maxPackets;
+  cl_int h_output[2 * N + 1];
+  unsigned count[2 * N];
+  size_t global = N;
+  size_t local = LOCAL_SIZE;
+
+  Context cl = createContext(KERNEL_SOURCE, "-cl-std=CL2.0");
+
+  producer = clCreateKernel(cl.program, "producer", &err);
+  checkError(err, "creating producer kernel");
+  group_producer = clCreateKernel(cl.program, "group_producer", &err);
+  checkError(err, "creating group_producer kernel");
+  consumer = clCreateKernel(cl.program, "consumer", &err);
+  checkError(err, "creating consumer kernel");
+
+  pipe = clCreatePipe(cl.context, 0, sizeof(cl_int), 2 * N, NULL, &err);
+  checkError(err, "creating pipe");
+  output = clCreateBuffer(cl.context, CL_MEM_WRITE_ONLY, sizeof(h_output),
+                          NULL, &err);
+  checkError(err, "creating output buffer");
+
+  err = clGetPipeInfo(pipe, CL_PIPE_PACKET_SIZE, sizeof(cl_uint), &packetSize,
+                      NULL);
+  err |= clGetPipeInfo(pipe, CL_PIPE_MAX_PACKETS, sizeof(cl_uint),
+                       &maxPackets, NULL);
+  checkError(err, "getting pipe info");
+  if (packetSize == sizeof(cl_int) && maxPackets == 2 * N)
+    printf("OK\n");
+
+  // Fill pipe using individual and reserved writes
+  err = clSetKernelArg(producer, 0, sizeof(cl_mem), &pipe);
+  err |= clSetKernelArg(group_producer, 0, sizeof(cl_mem), &pipe);
+  checkError(err, "setting producer arguments");
+  err = clEnqueueNDRangeKernel(cl.queue, producer, 1, NULL, &global, &local,
+                               0, NULL, NULL);
+  checkError(err, "enqueuing producer kernel");
+  err = clEnqueueNDRangeKernel(cl.queue, group_producer, 1, NULL, &global,
+                               &local, 0, NULL, NULL);
+  checkError(err, "enqueuing group_producer kernel");
+
+  // Drain pipe, with one extra read that should fail
+  global = 2 * N + 1;
+  err = clSetKernelArg(consumer, 0, sizeof(cl_mem), &pipe);
+  err |= clSetKernelArg(consumer, 1, sizeof(cl_mem), &output);
+  checkError(err, "setting consumer arguments");
+  err = clEnqueueNDRangeKernel(cl.queue, consumer, 1, NULL, &global, NULL, 0,
+                               NULL, NULL);
+  checkError(err, "enqueuing consumer kernel");
+
+  err = clEnqueueReadBuffer(cl.queue, output, CL_TRUE, 0, sizeof(h_output),
+                            h_output, 0, NULL, NULL);
+  checkError(err, "reading output");
+
+  // Every packet should have been read exactly once
+  unsigned errors = 0;
+  unsigned failed = 0;
+  memset(count, 0, sizeof(count));
+  for (unsigned i = 0; i < 2 * N + 1; i++)
+  {
+    if (h_output[i] == -1)
+      failed++;
+    else if (h_output[i] < 0 || h_output[i] >= 2 * N || count[h_output[i]]++)
+      errors++;
+  }
+  if (errors || failed != 1)
+    printf("%u errors detected, %u reads failed\n", errors, failed);
+  else
+    printf("OK\n");
+
+  clReleaseMemObject(pipe);
+  clReleaseMemObject(output);
+  clReleaseKernel(producer);
+  clReleaseKernel(group_producer);
+  clReleaseKernel(consumer);
+  releaseContext(cl);
+
+  return 0;
+}
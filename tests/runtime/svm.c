@@ -0,0 +1,226 @@
+#include "common.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TOL 1e-8
+#define MAX_ERRORS 8
+#define N 64
+
+const char* KERNEL_SOURCE = "kernel void vecadd(global float *a, \n"
+                            "                   global float *b, \n"
+                            "                   global float *c) \n"
+                            "{                                   \n"
+                            "  int i = get_global_id(0);         \n"
+                            "  c[i] = a[i] + b[i];               \n"
+                            "}                                   \n"
+                            "                                    \n"
+                            "typedef struct node                 \n"
+                            "{                                   \n"
+                            "  global struct node *next;         \n"
+                            "  int value;                        \n"
+                            "} node;                             \n"
+                            "                                    \n"
+                            "kernel void sum_list(global node *n,\n"
+                            "                     global int *sum)\n"
+                            "{                                   \n"
+                            "  int total = 0;                    \n"
+                            "  for (; n; n = n->next)            \n"
+                            "    total += n->value;              \n"
+                            "  sum[get_global_id(0)] = total;    \n"
+                            "}                                   \n";
+
+struct node
+{
+  struct node* next;
+  cl_int value;
+};
+
+unsigned checkLinkedList(Context cl);
+
+unsigned checkResults(float* a, float* b, float* results, size_t num);
+
+int main(int argc, char* argv[])
+{
+  cl_int err;
+  cl_kernel kernel;
+  float *a, *b, *c;
+  float h_c[N];
+  size_t global = N;
+
+  Context cl = createContext(KERNEL_SOURCE, "");
+
+  kernel = clCreateKernel(cl.program, "vecadd", &err);
+  checkError(err, "creating kernel");
+
+  // Fine-grained allocations are accessed by the host directly
+  cl_svm_mem_flags flags = CL_MEM_READ_WRITE | CL_MEM_SVM_FINE_GRAIN_BUFFER;
+  a = clSVMAlloc(cl.context, flags, N * sizeof(float), 0);
+  b = clSVMAlloc(cl.context, flags, N * sizeof(float), 0);
+  c = clSVMAlloc(cl.context, CL_MEM_READ_WRITE, N * sizeof(float), 0);
+  if (!a || !b || !c)
+  {
+    fprintf(stderr, "Failed to allocate SVM buffers\n");
+    exit(1);
+  }
+  for (unsigned i = 0; i < N; i++)
+  {
+    a[i] = i;
+    b[i] = 2 * i;
+  }
+
+  err = clSetKernelArgSVMPointer(kernel, 0, a);
+  err |= clSetKernelArgSVMPointer(kernel, 1, b);
+  err |= clSetKernelArgSVMPointer(kernel, 2, c);
+  checkError(err, "setting kernel args");
+
+  err = clEnqueueNDRangeKernel(cl.queue, kernel, 1, NULL, &global, NULL, 0,
+                               NULL, NULL);
+  checkError(err, "enqueuing kernel");
+
+  // Read coarse-grained results through a map
+  err = clEnqueueSVMMap(cl.queue, CL_TRUE, CL_MAP_READ, c, N * sizeof(float),
+                        0, NULL, NULL);
+  checkError(err, "mapping c");
+  if (!checkResults(a, b, c, N))
+    printf("OK\n");
+  err = clEnqueueSVMUnmap(cl.queue, c, 0, NULL, NULL);
+  checkError(err, "unmapping c");
+
+  // Run on second half of the allocations only
+  global = N / 2;
+  err = clSetKernelArgSVMPointer(kernel, 0, a + N / 2);
+  err |= clSetKernelArgSVMPointer(kernel, 1, a + N / 2);
+  err |= clSetKernelArgSVMPointer(kernel, 2, c + N / 2);
+  checkError(err, "setting kernel args");
+  err = clEnqueueNDRangeKernel(cl.queue, kernel, 1, NULL, &global, NULL, 0,
+                               NULL, NULL);
+  checkError(err, "enqueuing kernel");
+
+  // Copy results to host memory
+  err = clEnqueueSVMMemcpy(cl.queue, CL_TRUE, h_c, c, N * sizeof(float), 0,
+                           NULL, NULL);
+  checkError(err, "copying c");
+  if (!checkResults(a, b, h_c, N / 2) &&
+      !checkResults(a + N / 2, a + N / 2, h_c + N / 2, N / 2))
+    printf("OK\n");
+
+  // Fill allocation and copy between allocations
+  float zero = 0.f;
+  err = clEnqueueSVMMemFill(cl.queue, b, &zero, sizeof(float),
+                            N * sizeof(float), 0, NULL, NULL);
+  checkError(err, "filling b");
+  err = clEnqueueSVMMemcpy(cl.queue, CL_TRUE, c, a, N * sizeof(float), 0, NULL,
+                           NULL);
+  checkError(err, "copying a to c");
+  err = clEnqueueSVMMap(cl.queue, CL_TRUE, CL_MAP_READ, c, N * sizeof(float),
+                        0, NULL, NULL);
+  checkError(err, "mapping c");
+  if (!checkResults(a, b, c, N))
+    printf("OK\n");
+  err = clEnqueueSVMUnmap(cl.queue, c, 0, NULL, NULL);
+  checkError(err, "unmapping c");
+
+  if (!checkLinkedList(cl))
+    printf("OK\n");
+
+  void* pointers[] = {b, c};
+  err = clEnqueueSVMFree(cl.queue, 2, pointers, NULL, NULL, 0, NULL, NULL);
+  checkError(err, "freeing b and c");
+  err = clFinish(cl.queue);
+  checkError(err, "running queue");
+
+  clSVMFree(cl.context, a);
+  clReleaseKernel(kernel);
+  releaseContext(cl);
+
+  return 0;
+}
+
+unsigned checkResults(float* a, float* b, float* results, size_t num)
+{
+  // Check results
+  unsigned errors = 0;
+  for (unsigned i = 0; i < num; i++)
+  {
+    float ref = a[i] + b[i];
+    if (fabs(ref - results[i]) > TOL)
+    {
+      if (errors < MAX_ERRORS)
+      {
+        fprintf(stderr, "%4d: %.4f != %.4f\n", i, results[i], ref);
+      }
+      errors++;
+    }
+  }
+  if (errors)
+    printf("%d errors detected\n", errors);
+
+  return errors;
+}
+
+// Walk a linked list built by the host, with nodes spread across two
+// allocations, so that the kernel follows host pointers stored in SVM
+unsigned checkLinkedList(Context cl)
+{
+  cl_int err;
+  cl_kernel kernel;
+  struct node *even, *odd;
+  cl_int* sum;
+  size_t global = 4;
+
+  kernel = clCreateKernel(cl.program, "sum_list", &err);
+  checkError(err, "creating kernel");
+
+  cl_svm_mem_flags flags = CL_MEM_READ_WRITE | CL_MEM_SVM_FINE_GRAIN_BUFFER;
+  even = clSVMAlloc(cl.context, flags, N * sizeof(struct node), 0);
+  odd = clSVMAlloc(cl.context, flags, N * sizeof(struct node), 0);
+  sum = clSVMAlloc(cl.context, flags, global * sizeof(cl_int), 0);
+  if (!even || !odd || !sum)
+  {
+    fprintf(stderr, "Failed to allocate SVM buffers\n");
+    exit(1);
+  }
+
+  // Link node i of one allocation to node i of the other, and back to
+  // node i+1 of the first, in reverse order
+  cl_int ref = 0;
+  for (unsigned i = 0; i < N; i++)
+  {
+    even[i].value = 2 * i;
+    even[i].next = odd + i;
+    odd[i].value = 2 * i + 1;
+    odd[i].next = i ? even + i - 1 : NULL;
+    ref += 4 * i + 1;
+  }
+
+  err = clSetKernelArgSVMPointer(kernel, 0, even + N - 1);
+  err |= clSetKernelArgSVMPointer(kernel, 1, sum);
+  checkError(err, "setting kernel args");
+  err = clEnqueueNDRangeKernel(cl.queue, kernel, 1, NULL, &global, NULL, 0,
+                               NULL, NULL);
+  checkError(err, "enqueuing kernel");
+  err = clFinish(cl.queue);
+  checkError(err, "running kernel");
+
+  unsigned errors = 0;
+  for (unsigned i = 0; i < global; i++)
+  {
+    if (sum[i] != ref)
+    {
+      fprintf(stderr, "%4d: %d != %d\n", i, sum[i], ref);
+      errors++;
+    }
+  }
+  if (errors)
+    printf("%d errors detected\n", errors);
+
+  clSVMFree(cl.context, even);
+  clSVMFree(cl.context, odd);
+  clSVMFree(cl.context, sum);
+  clReleaseKernel(kernel);
+
+  return errors;
+}